@@ -13,4 +13,3 @@
 #include <network/protocol/http/request.hpp>
 #include <network/protocol/http/client/connection_manager.ipp>
 #include <network/protocol/http/client/client_connection.ipp>
-#include <network/protocol/http/impl/access.ipp>
@@ -1,5 +1,4 @@
-// Copyright 2010 Dean Michael Berris. 
-// Copyright 2012 Google, Inc.
+// Copyright 2013 Google, Inc.
 // Distributed under the Boost Software License, Version 1.0.
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
@@ -8,5 +7,4 @@
 #undef NETWORK_NO_LIB
 #endif
 
-#include <network/protocol/http/server/impl/parsers.ipp>
-
+#include <network/protocol/http/client/pooled_connection_manager.ipp>
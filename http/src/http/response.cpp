@@ -10,6 +10,7 @@
 
 #include <network/protocol/http/response/response_base.ipp>
 #include <network/protocol/http/response/response.ipp>
+#include <network/protocol/http/impl/access.ipp>
 
 #include <network/protocol/http/message/wrappers/status.ipp>
 #include <network/protocol/http/message/wrappers/status_message.ipp>
@@ -0,0 +1,103 @@
+// Copyright 2013 (c) Google, Inc.
+// Copyright 2013 (c) Dean Michael Berris <dberris@google.com>
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <http/server/default_connection_manager.hpp>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace network {
+namespace http {
+
+struct default_connection_manager::state {
+  state() : next_id(0), draining(false) {}
+
+  void remove(std::uint64_t id) {
+    std::function<void()> drained;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      connections.erase(id);
+      if (draining && connections.empty()) {
+        draining = false;
+        swap(drained, done);
+      }
+    }
+    if (drained)
+      drained();
+  }
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::uint64_t, std::function<void()>> connections;
+  std::uint64_t next_id;
+  bool draining;
+  std::function<void()> done;
+};
+
+default_connection_manager::default_connection_manager()
+    : state_(std::make_shared<state>()) {}
+
+std::shared_ptr<void> default_connection_manager::add(
+    std::function<void()> close) {
+  std::uint64_t id;
+  bool draining;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    id = state_->next_id++;
+    draining = state_->draining;
+    state_->connections.insert(std::make_pair(id, draining ? nullptr : close));
+  }
+  // The handle keeps the state alive, as connections may outlive the
+  // manager.
+  std::shared_ptr<state> tracked = state_;
+  std::shared_ptr<void> handle(static_cast<void*>(tracked.get()),
+                               [tracked, id](void*) { tracked->remove(id); });
+  if (draining && close)
+    close();
+  return handle;
+}
+
+void default_connection_manager::drain(std::function<void()> done) {
+  std::vector<std::function<void()>> closes;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    // A drain with nothing to wait for is done right away.
+    state_->draining = !state_->connections.empty();
+    if (state_->draining) {
+      state_->done = done;
+      done = nullptr;
+    }
+    for (auto& connection : state_->connections) {
+      if (connection.second)
+        closes.push_back(std::move(connection.second));
+      connection.second = nullptr;
+    }
+  }
+  // Closing a connection may release it, which takes the lock again.
+  for (auto& close : closes)
+    close();
+  if (done)
+    done();
+}
+
+void default_connection_manager::resume() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->draining = false;
+  state_->done = nullptr;
+}
+
+std::size_t default_connection_manager::size() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->connections.size();
+}
+
+bool default_connection_manager::draining() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->draining;
+}
+
+}  // namespace http
+}  // namespace network
@@ -7,10 +7,46 @@
 #ifndef NETWORK_HTTP_SERVER_DEFAULT_CONNECTION_MANAGER_20130408
 #define NETWORK_HTTP_SERVER_DEFAULT_CONNECTION_MANAGER_20130408
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+
 namespace network {
 namespace http {
 
+// Keeps track of a server's open connections so that the server can be
+// drained: every connection is asked to close once it has answered the
+// request it is handling, and the server is told when they are all gone.
 struct default_connection_manager {
+  default_connection_manager();
+  default_connection_manager(const default_connection_manager&) = delete;
+  default_connection_manager(default_connection_manager&&) = delete;
+  default_connection_manager& operator=(const default_connection_manager&) =
+      delete;
+  default_connection_manager& operator=(default_connection_manager&&) =
+      delete;
+
+  // Tracks a connection until the returned handle is released, which may
+  // happen after the manager is gone. close is called at most once, when
+  // the connections are drained, and should close the connection as soon as
+  // it is done with the request it is handling.
+  std::shared_ptr<void> add(std::function<void()> close);
+
+  // Asks every connection, including the ones added until the drain is
+  // done, to close. done is called once all of them have been released,
+  // right away if there are none.
+  void drain(std::function<void()> done);
+
+  // Ends a drain that hasn't finished, without calling its done. The
+  // connections added from now on are kept open.
+  void resume();
+
+  std::size_t size() const;
+  bool draining() const;
+
+ private:
+  struct state;
+  std::shared_ptr<state> state_;
 };
 
 }  // namespace http
@@ -4,55 +4,350 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <future>
+#include <cctype>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
 #include <boost/asio/strand.hpp>
-#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/range/algorithm/find_first_of.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/logic/tribool.hpp>
 #include <network/uri.hpp>
 #include <network/config.hpp>
 #include <network/http/v2/client/client.hpp>
 #include <network/http/v2/method.hpp>
 #include <network/http/v2/client/request.hpp>
 #include <network/http/v2/client/response.hpp>
+#include <network/http/v2/client/response_parser.hpp>
+#include <network/http/v2/client/chunked_decoder.hpp>
 #include <network/http/v2/client/connection/tcp_resolver.hpp>
-#include <network/http/v2/client/connection/normal_connection.hpp>
+#include <network/http/v2/client/connection/connection_factory.hpp>
+#include <network/http/v2/client/connection/connection_pool.hpp>
 
 namespace network {
   namespace http {
     namespace v2 {
       using boost::asio::ip::tcp;
 
+      struct request_helper;
+
+      // A persistent connection on which several requests are written
+      // back to back, before their responses arrive. The responses are
+      // read in the same order by the requests themselves, so all the
+      // requests of a pipeline share its strand.
+      struct request_pipeline {
+
+        request_pipeline(boost::asio::io_service &io_service, std::string key)
+          : strand_(io_service)
+          , key_(std::move(key))
+          , driver_(nullptr)
+          , written_(0)
+          , responses_(0)
+          , is_writing_(false)
+          , is_reading_(false)
+          , is_abandoned_(false) { }
+
+        boost::asio::io_service::strand strand_;
+        std::string key_;
+
+        // set once the first request has connected
+        std::unique_ptr<client_connection::async_connection> connection_;
+        boost::asio::streambuf response_buffer_;
+
+        // the request that is establishing the connection
+        request_helper *driver_;
+
+        // guarded by the client's pipeline mutex, because requests on
+        // other threads join the pipeline
+        std::vector<std::shared_ptr<request_helper>> members_;
+
+        // used only on the strand: requests waiting to be written, and
+        // requests that have been written (the first written_ of them
+        // completely) in the order in which they are answered
+        std::deque<std::shared_ptr<request_helper>> queued_;
+        std::deque<std::shared_ptr<request_helper>> in_flight_;
+        std::size_t written_;
+        std::size_t responses_;
+        std::vector<boost::asio::const_buffer> write_buffers_;
+        bool is_writing_;
+        bool is_reading_;
+        bool is_abandoned_;
+
+      };
+
       struct request_helper {
 
         std::unique_ptr<client_connection::async_connection> connection_;
 
         client::request request_;
         client::request_options options_;
+        client::request_options::body_handler_type body_handler_;
 
         std::promise<client::response> response_promise_;
 
         boost::asio::streambuf request_buffer_;
         boost::asio::streambuf response_buffer_;
 
-        // TODO configure deadline timer for timeouts
+        // the request body is written straight from the byte source,
+        // together with the request head and chunk framing, using a
+        // single gather write for each piece
+        std::shared_ptr<client_message::byte_source> body_;
+        boost::optional<std::size_t> body_remaining_;
+        bool is_body_started_;
+        std::string chunk_header_;
+        std::vector<boost::asio::const_buffer> write_buffers_;
+
+        // the host and port are kept so that a stale pooled connection
+        // can be replaced
+        std::string host_;
+        std::uint16_t port_;
+        std::string connection_key_;
+        bool is_reused_;
+        bool keep_alive_;
+        bool close_requested_;
+
+        // the response head is parsed in place in response_buffer_;
+        // parsed_ is the number of bytes already seen by the parser,
+        // token_ the offset at which the current token begins
+        response_parser parser_;
+        std::size_t parsed_;
+        std::size_t token_;
+        std::pair<std::size_t, std::size_t> header_name_;
+
+        // the number of body bytes still to be read, if the response
+        // body is delimited by a Content-Length header
+        boost::optional<std::size_t> remaining_;
+
+        // set if the response body is sent with chunked transfer
+        // coding, which takes precedence over Content-Length
+        bool is_chunked_;
+        chunked_decoder chunked_decoder_;
+
+        // all handlers of a request run on its own strand, so that
+        // different requests can be processed on different threads
+        boost::asio::io_service::strand strand_;
+
+        // one timer for the current phase (resolve, connect, write or
+        // read) and one for the whole request
+        boost::asio::steady_timer timer_;
+        boost::asio::steady_timer total_timer_;
+        bool is_done_;
+
+        // set if the request is pipelined; the client is told when the
+        // request is done, and whether a response was received
+        std::shared_ptr<request_pipeline> pipeline_;
+        std::function<void (bool)> pipeline_done_;
 
         request_helper(boost::asio::io_service &io_service,
+                       boost::asio::io_service::strand strand,
                        client::request request,
                        client::request_options options)
-          // TODO factory based on HTTP or HTTPS
-          : connection_(new client_connection::normal_connection(io_service))
-          , request_(request)
-          , options_(options) { }
+          : request_(request)
+          , options_(options)
+          , body_handler_(options.body_handler())
+          , is_body_started_(false)
+          , port_(0)
+          , is_reused_(false)
+          , keep_alive_(false)
+          , close_requested_(false)
+          , parsed_(0)
+          , token_(0)
+          , is_chunked_(false)
+          , strand_(strand)
+          , timer_(io_service)
+          , total_timer_(io_service)
+          , is_done_(false) { }
+
+        void set_value(client::response res) {
+          if (is_done_) {
+            return;
+          }
+          is_done_ = true;
+          cancel_timers();
+          response_promise_.set_value(std::move(res));
+          leave_pipeline(true);
+        }
+
+        void set_exception(std::exception_ptr e) {
+          if (is_done_) {
+            return;
+          }
+          is_done_ = true;
+          cancel_timers();
+          response_promise_.set_exception(e);
+          leave_pipeline(false);
+        }
+
+        void leave_pipeline(bool has_response) {
+          if (pipeline_done_) {
+            auto pipeline_done = std::move(pipeline_done_);
+            pipeline_done_ = nullptr;
+            pipeline_done(has_response);
+          }
+        }
+
+        client_connection::async_connection &connection() {
+          return pipeline_? *pipeline_->connection_ : *connection_;
+        }
+
+        boost::asio::streambuf &response_buffer() {
+          return pipeline_? pipeline_->response_buffer_ : response_buffer_;
+        }
+
+        void cancel_timers() {
+          boost::system::error_code ignore;
+          timer_.cancel(ignore);
+          total_timer_.cancel(ignore);
+        }
 
       };
 
+      namespace {
+        // the response buffer is grown by at least this much before
+        // each read, so that large responses aren't read in small
+        // pieces
+        const std::size_t read_buffer_size = 8192;
+
+        // the request body is sent in pieces of at most this size
+        const std::size_t body_chunk_size = 65536;
+
+        std::string to_hex(std::size_t number) {
+          static const char digits[] = "0123456789abcdef";
+          std::string hex;
+          do {
+            hex.insert(hex.begin(), digits[number & 0xf]);
+            number >>= 4;
+          } while (number != 0);
+          return hex;
+        }
+
+        boost::string_ref trimmed(boost::string_ref token) {
+          while (!token.empty() && std::isspace(static_cast<unsigned char>(token.front()))) {
+            token.remove_prefix(1);
+          }
+          while (!token.empty() && std::isspace(static_cast<unsigned char>(token.back()))) {
+            token.remove_suffix(1);
+          }
+          return token;
+        }
+
+        std::size_t to_number(boost::string_ref token) {
+          std::size_t number = 0;
+          for (auto c : token) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) {
+              break;
+            }
+            number = (number * 10) + (c - '0');
+          }
+          return number;
+        }
+
+        // Content-Length is a list of the same number when the header was
+        // combined or repeated. Anything else, including a number that
+        // doesn't fit, leaves the body's length unknown and the response
+        // is rejected.
+        bool add_content_length(boost::string_ref value,
+                                boost::optional<std::size_t> &length) {
+          while (true) {
+            auto comma = value.find(',');
+            auto token = trimmed(value.substr(0, comma));
+            if (token.empty()) {
+              return false;
+            }
+            std::size_t number = 0;
+            for (auto c : token) {
+              if (!std::isdigit(static_cast<unsigned char>(c))) {
+                return false;
+              }
+              std::size_t digit = c - '0';
+              if (number > (std::numeric_limits<std::size_t>::max() - digit) / 10) {
+                return false;
+              }
+              number = (number * 10) + digit;
+            }
+            if (length && (*length != number)) {
+              return false;
+            }
+            length = number;
+            if (comma == boost::string_ref::npos) {
+              return true;
+            }
+            value.remove_prefix(comma + 1);
+          }
+        }
+
+        response_parser::state_t next_stop_state(response_parser::state_t state) {
+          switch (state) {
+          case response_parser::http_version_done:
+          case response_parser::http_status_digit:
+            return response_parser::http_status_done;
+          case response_parser::http_status_done:
+          case response_parser::http_status_message_char:
+          case response_parser::http_status_message_cr:
+            return response_parser::http_status_message_done;
+          case response_parser::http_status_message_done:
+          case response_parser::http_header_name_char:
+          case response_parser::http_header_line_done:
+            return response_parser::http_header_colon;
+          case response_parser::http_header_colon:
+          case response_parser::http_header_value_char:
+          case response_parser::http_header_line_cr:
+            return response_parser::http_header_line_done;
+          case response_parser::http_headers_end_cr:
+            return response_parser::http_headers_done;
+          default:
+            return response_parser::http_version_done;
+          }
+        }
+      } // namespace
+
       struct client::impl {
 
 	explicit impl(client_options options);
 
 	~impl() noexcept;
 
-	std::future<response> do_request(std::shared_ptr<request_helper> helper);
+	std::future<response> do_request(request req, request_options options);
+
+        void start_request(std::shared_ptr<request_helper> helper);
+
+        void resolve(std::shared_ptr<request_helper> helper);
+
+        bool can_pipeline(const request &req) const;
+
+        std::shared_ptr<request_helper> join_pipeline(const std::string &key,
+                                                      request req, request_options options,
+                                                      bool &is_driver);
+
+        void write_pipelined(std::shared_ptr<request_helper> helper);
+
+        void flush_pipeline(std::shared_ptr<request_pipeline> pipeline);
+
+        void read_pipelined(std::shared_ptr<request_pipeline> pipeline);
+
+        void leave_pipeline(std::shared_ptr<request_pipeline> pipeline,
+                            request_helper *helper,
+                            bool has_response);
+
+        void close_pipeline(std::shared_ptr<request_pipeline> pipeline,
+                            request_helper *helper);
+
+        void abandon_pipeline(std::shared_ptr<request_pipeline> pipeline,
+                              bool is_closed_by_server);
+
+        void retry_unpipelined(std::shared_ptr<request_helper> helper);
+
+        bool reconnect_stale(std::shared_ptr<request_helper> helper);
+
+        void start_timer(boost::asio::steady_timer &timer,
+                         std::uint64_t timeout,
+                         std::shared_ptr<request_helper> helper);
+
+        void handle_timeout(const boost::system::error_code &ec,
+                            boost::asio::steady_timer &timer,
+                            std::shared_ptr<request_helper> helper);
 
         void connect(const boost::system::error_code &ec,
                      tcp::resolver::iterator endpoint_iterator,
@@ -61,14 +356,16 @@ namespace network {
         void write_request(const boost::system::error_code &ec,
                            std::shared_ptr<request_helper> helper);
 
+        bool prepare_body(std::shared_ptr<request_helper> helper);
+
+        void write_body(std::shared_ptr<request_helper> helper);
+
         void read_response(const boost::system::error_code &ec,
                            std::size_t bytes_written,
                            std::shared_ptr<request_helper> helper);
 
-        void read_response_status(const boost::system::error_code &ec,
-                                  std::size_t bytes_written,
-                                  std::shared_ptr<request_helper> helper,
-                                  std::shared_ptr<response> res);
+        boost::logic::tribool parse_response_headers(std::shared_ptr<request_helper> helper,
+                                                     std::shared_ptr<response> res);
 
         void read_response_headers(const boost::system::error_code &ec,
                                    std::size_t bytes_read,
@@ -80,44 +377,88 @@ namespace network {
                                 std::shared_ptr<request_helper> helper,
                                 std::shared_ptr<response> res);
 
+        bool append_body(std::shared_ptr<request_helper> helper,
+                         std::shared_ptr<response> res,
+                         const char *data,
+                         std::size_t length);
+
+        void read_chunked_body(bool eof,
+                               std::shared_ptr<request_helper> helper,
+                               std::shared_ptr<response> res);
+
+        void read_more_body(std::shared_ptr<request_helper> helper,
+                            std::shared_ptr<response> res);
+
+        void finish_response(std::shared_ptr<request_helper> helper,
+                             std::shared_ptr<response> res);
+
 	client_options options_;
-	boost::asio::io_service io_service_;
+        std::unique_ptr<boost::asio::io_service> owned_io_service_;
+	boost::asio::io_service &io_service_;
 	std::unique_ptr<boost::asio::io_service::work> sentinel_;
-        boost::asio::io_service::strand strand_;
         std::unique_ptr<client_connection::async_resolver> resolver_;
-	std::thread lifetime_thread_;
+        client_connection::connection_factory connections_;
+        client_connection::connection_pool pool_;
+        std::vector<std::thread> threads_;
+
+        // open pipelines, and the hosts that have closed a pipelined
+        // connection, by connection key
+        std::mutex pipelines_mutex_;
+        std::unordered_map<std::string, std::vector<std::shared_ptr<request_pipeline>>> pipelines_;
+        std::unordered_set<std::string> unpipelined_;
 
       };
 
       client::impl::impl(client_options options)
 	: options_(options)
-	, sentinel_(new boost::asio::io_service::work(io_service_))
-        , strand_(io_service_)
-	, resolver_(new client_connection::tcp_resolver(io_service_, options_.cache_resolved()))
-	, lifetime_thread_([=] () { io_service_.run(); }) {
-
+        , owned_io_service_(options_.io_service()? nullptr : new boost::asio::io_service)
+        , io_service_(options_.io_service()? *options_.io_service() : *owned_io_service_)
+	, resolver_(new client_connection::tcp_resolver(io_service_,
+                                                        options_.cache_resolved(),
+                                                        options_.max_cache_resolved(),
+                                                        options_.cache_resolved_ttl()))
+        , connections_(io_service_,
+                       options_.connection_attempt_delay(),
+                       options_.openssl_certificate_paths(),
+                       options_.openssl_verify_paths())
+        , pool_(options_.max_idle_connections(),
+                options_.max_idle_connections_per_host(),
+                options_.idle_timeout()) {
+        // an io_service supplied by the application is run by the
+        // application
+        if (owned_io_service_) {
+          sentinel_.reset(new boost::asio::io_service::work(io_service_));
+          auto num_threads = std::max<std::size_t>(options_.num_threads(), 1);
+          for (std::size_t i = 0; i < num_threads; ++i) {
+            threads_.emplace_back([=] () { io_service_.run(); });
+          }
+        }
       }
 
       client::impl::~impl() noexcept {
 	sentinel_.reset();
-	lifetime_thread_.join();
+        for (auto &thread : threads_) {
+          thread.join();
+        }
       }
 
-      std::future<client::response> client::impl::do_request(std::shared_ptr<request_helper> helper) {
-        std::future<client::response> res = helper->response_promise_.get_future();
-
+      std::future<client::response> client::impl::do_request(request req, request_options options) {
         // TODO see linearize.hpp
         // TODO write User-Agent: cpp-netlib/NETLIB_VERSION (if no user-agent is supplied)
 
         // HTTP 1.1
-        auto it = std::find_if(std::begin(helper->request_.headers()),
-                               std::end(helper->request_.headers()),
+        auto it = std::find_if(std::begin(req.headers()),
+                               std::end(req.headers()),
                                [] (const std::pair<uri::string_type, uri::string_type> &header) {
                                  return (boost::iequals(header.first, "host"));
                                });
-        if (it == std::end(helper->request_.headers())) {
+        if (it == std::end(req.headers())) {
           // set error
-          helper->response_promise_.set_value(response());
+          auto helper = std::make_shared<request_helper>(io_service_,
+                                                         boost::asio::io_service::strand(io_service_),
+                                                         req, options);
+          std::future<client::response> res = helper->response_promise_.get_future();
+          helper->set_value(response());
           return res;
         }
 
@@ -129,198 +470,958 @@ namespace network {
         auto auth = builder.uri();
         auto host = auth.host()?
           uri::string_type(std::begin(*auth.host()), std::end(*auth.host())) : uri::string_type();
-        auto port = auth.port<std::uint16_t>()? *auth.port<std::uint16_t>() : 80;
+        auto port = auth.port<std::uint16_t>()?
+          *auth.port<std::uint16_t>() : (req.is_https()? 443 : 80);
+        auto key = client_connection::connection_pool::make_key(req.is_https(), host, port);
+
+        std::shared_ptr<request_helper> helper;
+        bool is_driver = false;
+        if (can_pipeline(req)) {
+          helper = join_pipeline(key, req, options, is_driver);
+        }
+        if (!helper) {
+          helper = std::make_shared<request_helper>(io_service_,
+                                                    boost::asio::io_service::strand(io_service_),
+                                                    req, options);
+        }
+        std::future<client::response> res = helper->response_promise_.get_future();
 
-	resolver_->async_resolve(host, port,
-                                 strand_.wrap(
+        helper->host_ = host;
+        helper->port_ = port;
+        for (const auto &header : helper->request_.headers()) {
+          if (boost::iequals(header.first, "Connection") &&
+              boost::iequals(header.second, "close")) {
+            helper->close_requested_ = true;
+          }
+        }
+        helper->connection_key_ = key;
+
+        start_timer(helper->total_timer_, helper->options_.total_timeout(), helper);
+
+        // only the first request of a pipeline connects, the others are
+        // queued until the connection is established
+        if (helper->pipeline_ && !is_driver) {
+          helper->strand_.post([=] () {
+              write_request(boost::system::error_code(), helper);
+            });
+          return res;
+        }
+
+        start_request(helper);
+	return res;
+      }
+
+      void client::impl::start_request(std::shared_ptr<request_helper> helper) {
+        // reuse a warm connection to the same origin if one is available
+        helper->connection_ = pool_.acquire(helper->connection_key_);
+        if (helper->connection_) {
+          helper->is_reused_ = true;
+          helper->strand_.post([=] () {
+              write_request(boost::system::error_code(), helper);
+            });
+          return;
+        }
+
+        resolve(helper);
+      }
+
+      void client::impl::resolve(std::shared_ptr<request_helper> helper) {
+        try {
+          helper->connection_ = connections_.create(helper->request_.is_https(),
+                                                    helper->host_, helper->port_);
+        }
+        catch (...) {
+          // the SSL context is made for the first HTTPS request, and fails
+          // if a certificate or verify path can't be loaded
+          helper->set_exception(std::current_exception());
+          return;
+        }
+        if (!helper->connection_) {
+          // built without HTTPS support
+          helper->set_exception(
+            std::make_exception_ptr(client_exception(client_error::invalid_url)));
+          return;
+        }
+        start_timer(helper->timer_, helper->options_.resolve_timeout(), helper);
+	resolver_->async_resolve(helper->host_, helper->port_,
+                                 helper->strand_.wrap(
                                    [=](const boost::system::error_code &ec,
                                        tcp::resolver::iterator endpoint_iterator) {
                                      connect(ec, endpoint_iterator, helper);
                                    }));
+      }
 
-	return res;
+      bool client::impl::reconnect_stale(std::shared_ptr<request_helper> helper) {
+        // A pooled connection may have been closed by the server while
+        // it was idle. If nothing has been received yet, the request is
+        // sent again over a new connection.
+        if (!helper->is_reused_ || helper->is_done_ || helper->pipeline_) {
+          return false;
+        }
+
+        // a body that has been partly read from its source can't be
+        // sent again
+        if (helper->is_body_started_) {
+          return false;
+        }
+
+        helper->is_reused_ = false;
+        helper->connection_->close();
+        helper->request_buffer_.consume(helper->request_buffer_.size());
+        helper->response_buffer_.consume(helper->response_buffer_.size());
+        resolve(helper);
+        return true;
+      }
+
+      void client::impl::start_timer(boost::asio::steady_timer &timer,
+                                     std::uint64_t timeout,
+                                     std::shared_ptr<request_helper> helper) {
+        // a timeout of 0 means that this phase is not limited
+        if (timeout == 0) {
+          boost::system::error_code ignore;
+          timer.cancel(ignore);
+          return;
+        }
+
+        timer.expires_from_now(std::chrono::milliseconds(timeout));
+        timer.async_wait(helper->strand_.wrap(
+                           [=, &timer] (const boost::system::error_code &ec) {
+                             handle_timeout(ec, timer, helper);
+                           }));
+      }
+
+      void client::impl::handle_timeout(const boost::system::error_code &ec,
+                                        boost::asio::steady_timer &timer,
+                                        std::shared_ptr<request_helper> helper) {
+        // the timer may have been restarted after this handler was
+        // queued for execution
+        if ((ec == boost::asio::error::operation_aborted) ||
+            (timer.expires_at() > boost::asio::steady_timer::clock_type::now()) ||
+            helper->is_done_) {
+          return;
+        }
+
+        // fail the request first, so that handlers of the cancelled
+        // operations don't report their own errors
+        auto pipeline = helper->pipeline_;
+        helper->set_exception(
+          std::make_exception_ptr(client_exception(client_error::timeout)));
+        if (helper->connection_) {
+          helper->connection_->close();
+        }
+        else if (pipeline) {
+          // a request that joined a pipeline waits on the pipeline's
+          // connection, which is closed; the other requests on it are
+          // sent again
+          abandon_pipeline(pipeline, false);
+        }
       }
 
       void client::impl::connect(const boost::system::error_code &ec,
                                  tcp::resolver::iterator endpoint_iterator,
                                  std::shared_ptr<request_helper> helper) {
+        if (helper->is_done_) {
+          return;
+        }
+
         if (ec) {
           if (endpoint_iterator == tcp::resolver::iterator()) {
-            helper->response_promise_.set_exception(
+            helper->set_exception(
               std::make_exception_ptr(client_exception(client_error::host_not_found)));
             return;
           }
 
-          helper->response_promise_.set_exception(
+          helper->set_exception(
             std::make_exception_ptr(std::system_error(ec.value(), std::system_category())));
           return;
         }
 
-        tcp::endpoint endpoint(*endpoint_iterator);
-        helper->connection_->async_connect(endpoint,
-                                     strand_.wrap(
-                                     [=] (const boost::system::error_code &ec) {
-                                       if (ec && endpoint_iterator != tcp::resolver::iterator()) {
-                                         // copy iterator because it is const after the lambda
-                                         // capture
-                                         auto it = endpoint_iterator;
-                                         boost::system::error_code ignore;
-                                         connect(ignore, ++it, helper);
-                                         return;
-                                       }
-
-                                       write_request(ec, helper);
-                                     }));
+        // all resolved endpoints are tried, in parallel once the
+        // first attempts take too long
+        std::vector<tcp::endpoint> endpoints(endpoint_iterator, tcp::resolver::iterator());
+        start_timer(helper->timer_, options_.timeout().count(), helper);
+        helper->connection_->async_connect(endpoints,
+                                           helper->strand_.wrap(
+                                             [=] (const boost::system::error_code &ec) {
+                                               write_request(ec, helper);
+                                             }));
       }
 
       void client::impl::write_request(const boost::system::error_code &ec,
                                        std::shared_ptr<request_helper> helper) {
+        if (helper->is_done_) {
+          return;
+        }
+
         if (ec) {
-          helper->response_promise_.set_exception(
+          helper->set_exception(
             std::make_exception_ptr(std::system_error(ec.value(), std::system_category())));
           return;
         }
 
+        if (helper->pipeline_ && helper->pipeline_->is_abandoned_) {
+          // the pipeline was abandoned before this request was written
+          helper->pipeline_.reset();
+          helper->pipeline_done_ = nullptr;
+          if (!helper->connection_) {
+            start_request(helper);
+            return;
+          }
+        }
+
+        if (!helper->body_ && helper->request_.body()) {
+          if (!prepare_body(helper)) {
+            helper->set_exception(
+              std::make_exception_ptr(client_exception(client_error::invalid_request)));
+            return;
+          }
+        }
+
         std::ostream request_stream(&helper->request_buffer_);
         request_stream << helper->request_;
         if (!request_stream) {
-          helper->response_promise_.set_exception(
+          helper->set_exception(
             std::make_exception_ptr(client_exception(client_error::invalid_request)));
+          return;
+        }
+
+        if (helper->pipeline_) {
+          write_pipelined(helper);
+          return;
         }
 
-        // TODO write payload to request_buffer_
+        if (helper->body_) {
+          write_body(helper);
+          return;
+        }
 
+        start_timer(helper->timer_, helper->options_.read_timeout(), helper);
         helper->connection_->async_write(helper->request_buffer_,
-                                 strand_.wrap(
+                                 helper->strand_.wrap(
                                    [=] (const boost::system::error_code &ec,
                                         std::size_t bytes_written) {
                                      read_response(ec, bytes_written, helper);
                                    }));
       }
 
+      bool client::impl::prepare_body(std::shared_ptr<request_helper> helper) {
+        helper->body_ = helper->request_.body();
+
+        bool is_framed = false;
+        for (const auto &header : helper->request_.headers()) {
+          if (boost::iequals(header.first, "Transfer-Encoding")) {
+            is_framed = true;
+            helper->body_remaining_ = boost::none;
+            break;
+          }
+          else if (boost::iequals(header.first, "Content-Length")) {
+            is_framed = true;
+            helper->body_remaining_ = to_number(trimmed(header.second));
+          }
+        }
+
+        if (is_framed) {
+          return true;
+        }
+
+        if (auto size = helper->body_->size()) {
+          helper->body_remaining_ = *size;
+          helper->request_.append_header("Content-Length", std::to_string(*size));
+          return true;
+        }
+
+        // chunked transfer coding can't be used with HTTP/1.0 servers
+        if (helper->request_.version() == "1.0") {
+          return false;
+        }
+
+        helper->request_.append_header("Transfer-Encoding", "chunked");
+        return true;
+      }
+
+      void client::impl::write_body(std::shared_ptr<request_helper> helper) {
+        auto &buffers = helper->write_buffers_;
+        buffers.clear();
+        if (helper->request_buffer_.size() != 0) {
+          buffers.push_back(helper->request_buffer_.data());
+        }
+
+        auto length = body_chunk_size;
+        if (helper->body_remaining_) {
+          length = std::min(length, *helper->body_remaining_);
+        }
+
+        const char *data = nullptr;
+        std::size_t bytes_read = 0;
+        if (length != 0) {
+          try {
+            bytes_read = helper->body_->read_in_place(data, length);
+          }
+          catch (...) {
+            helper->set_exception(std::current_exception());
+            helper->connection_->close();
+            return;
+          }
+        }
+
+        if (bytes_read != 0) {
+          helper->is_body_started_ = true;
+        }
+
+        bool is_last = false;
+        if (helper->body_remaining_) {
+          if ((bytes_read == 0) && (*helper->body_remaining_ != 0)) {
+            // the source ended before the length that was sent
+            helper->set_exception(
+              std::make_exception_ptr(client_exception(client_error::invalid_request)));
+            helper->connection_->close();
+            return;
+          }
+
+          *helper->body_remaining_ -= bytes_read;
+          is_last = (*helper->body_remaining_ == 0);
+          if (bytes_read != 0) {
+            buffers.push_back(boost::asio::buffer(data, bytes_read));
+          }
+        }
+        else if (bytes_read != 0) {
+          helper->chunk_header_ = to_hex(bytes_read);
+          helper->chunk_header_.append("\r\n");
+          buffers.push_back(boost::asio::buffer(helper->chunk_header_));
+          buffers.push_back(boost::asio::buffer(data, bytes_read));
+          buffers.push_back(boost::asio::buffer("\r\n", 2));
+        }
+        else {
+          buffers.push_back(boost::asio::buffer("0\r\n\r\n", 5));
+          is_last = true;
+        }
+
+        start_timer(helper->timer_, helper->options_.read_timeout(), helper);
+        helper->connection_->async_write(buffers,
+                                         helper->strand_.wrap(
+                                           [=] (const boost::system::error_code &ec,
+                                                std::size_t bytes_written) {
+                                             if (!ec) {
+                                               helper->request_buffer_.consume(helper->request_buffer_.size());
+                                             }
+
+                                             if (ec || is_last) {
+                                               read_response(ec, bytes_written, helper);
+                                               return;
+                                             }
+
+                                             if (!helper->is_done_) {
+                                               write_body(helper);
+                                             }
+                                           }));
+      }
+
+      bool client::impl::can_pipeline(const request &req) const {
+        // only idempotent requests without a body are pipelined, because
+        // they can be sent again if the server closes the connection
+        // before answering them
+        if (!options_.pipelining() || req.body() || (req.version() != "1.1")) {
+          return false;
+        }
+
+        if ((req.method() != method::get) &&
+            (req.method() != method::head) &&
+            (req.method() != method::options)) {
+          return false;
+        }
+
+        for (const auto &header : req.headers()) {
+          if (boost::iequals(header.first, "Connection") &&
+              boost::iequals(header.second, "close")) {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      std::shared_ptr<request_helper> client::impl::join_pipeline(const std::string &key,
+                                                                  request req,
+                                                                  request_options options,
+                                                                  bool &is_driver) {
+        std::lock_guard<std::mutex> lock(pipelines_mutex_);
+        if (unpipelined_.count(key) != 0) {
+          return std::shared_ptr<request_helper>();
+        }
+
+        auto max_requests = std::max<std::size_t>(options_.max_pipelined_requests(), 1);
+        auto &pipelines = pipelines_[key];
+        auto it = std::find_if(std::begin(pipelines), std::end(pipelines),
+                               [max_requests] (const std::shared_ptr<request_pipeline> &pipeline) {
+                                 return pipeline->members_.size() < max_requests;
+                               });
+        std::shared_ptr<request_pipeline> pipeline;
+        if (it != std::end(pipelines)) {
+          pipeline = *it;
+        }
+        else {
+          pipeline = std::make_shared<request_pipeline>(io_service_, key);
+          pipelines.push_back(pipeline);
+        }
+
+        auto helper = std::make_shared<request_helper>(io_service_, pipeline->strand_, req, options);
+        auto raw_helper = helper.get();
+        helper->pipeline_ = pipeline;
+        helper->pipeline_done_ = [=] (bool has_response) {
+          leave_pipeline(pipeline, raw_helper, has_response);
+        };
+
+        is_driver = pipeline->members_.empty();
+        if (is_driver) {
+          pipeline->driver_ = raw_helper;
+        }
+        pipeline->members_.push_back(helper);
+        return helper;
+      }
+
+      void client::impl::write_pipelined(std::shared_ptr<request_helper> helper) {
+        auto pipeline = helper->pipeline_;
+        if (helper->connection_) {
+          // the first request hands its connection over to the pipeline
+          pipeline->connection_ = std::move(helper->connection_);
+          pipeline->driver_ = nullptr;
+        }
+
+        start_timer(helper->timer_, helper->options_.read_timeout(), helper);
+        pipeline->queued_.push_back(helper);
+        flush_pipeline(pipeline);
+      }
+
+      void client::impl::flush_pipeline(std::shared_ptr<request_pipeline> pipeline) {
+        if (pipeline->is_abandoned_ || pipeline->is_writing_ ||
+            !pipeline->connection_ || pipeline->queued_.empty()) {
+          return;
+        }
+
+        // all the requests queued while the previous write was in
+        // progress are sent together
+        auto &buffers = pipeline->write_buffers_;
+        buffers.clear();
+        for (const auto &queued : pipeline->queued_) {
+          buffers.push_back(queued->request_buffer_.data());
+          pipeline->in_flight_.push_back(queued);
+        }
+        auto count = pipeline->queued_.size();
+        pipeline->queued_.clear();
+
+        pipeline->is_writing_ = true;
+        pipeline->connection_->async_write(buffers,
+                                           pipeline->strand_.wrap(
+                                             [=] (const boost::system::error_code &ec, std::size_t) {
+                                               pipeline->is_writing_ = false;
+                                               if (pipeline->is_abandoned_) {
+                                                 return;
+                                               }
+
+                                               if (ec) {
+                                                 abandon_pipeline(pipeline, false);
+                                                 return;
+                                               }
+
+                                               pipeline->written_ += count;
+                                               read_pipelined(pipeline);
+                                               flush_pipeline(pipeline);
+                                             }));
+      }
+
+      void client::impl::read_pipelined(std::shared_ptr<request_pipeline> pipeline) {
+        // the responses are read one at a time, in the order in which
+        // the requests were written
+        if (pipeline->is_abandoned_ || pipeline->is_reading_ || (pipeline->written_ == 0)) {
+          return;
+        }
+
+        pipeline->is_reading_ = true;
+        read_response(boost::system::error_code(), 0, pipeline->in_flight_.front());
+      }
+
+      void client::impl::leave_pipeline(std::shared_ptr<request_pipeline> pipeline,
+                                        request_helper *helper,
+                                        bool has_response) {
+        if (pipeline->is_abandoned_) {
+          return;
+        }
+
+        auto is_helper = [helper] (const std::shared_ptr<request_helper> &member) {
+          return member.get() == helper;
+        };
+
+        // a request that hasn't been written simply leaves the queue
+        auto queued = std::find_if(std::begin(pipeline->queued_), std::end(pipeline->queued_), is_helper);
+        if (queued != std::end(pipeline->queued_)) {
+          pipeline->queued_.erase(queued);
+          close_pipeline(pipeline, helper);
+          return;
+        }
+
+        bool is_in_flight =
+          std::any_of(std::begin(pipeline->in_flight_), std::end(pipeline->in_flight_), is_helper);
+        if (!is_in_flight && (pipeline->driver_ != helper)) {
+          close_pipeline(pipeline, helper);
+          return;
+        }
+
+        // if any other request fails after it has been written, or
+        // while it is connecting, the remaining requests can't rely on
+        // the connection any more
+        if (!has_response || (pipeline->in_flight_.front().get() != helper)) {
+          abandon_pipeline(pipeline, false);
+          return;
+        }
+
+        pipeline->in_flight_.pop_front();
+        --pipeline->written_;
+        ++pipeline->responses_;
+        pipeline->is_reading_ = false;
+
+        if (!helper->keep_alive_) {
+          abandon_pipeline(pipeline, true);
+          return;
+        }
+
+        close_pipeline(pipeline, helper);
+        read_pipelined(pipeline);
+      }
+
+      void client::impl::close_pipeline(std::shared_ptr<request_pipeline> pipeline,
+                                        request_helper *helper) {
+        {
+          std::lock_guard<std::mutex> lock(pipelines_mutex_);
+          auto &members = pipeline->members_;
+          members.erase(std::remove_if(std::begin(members), std::end(members),
+                                       [helper] (const std::shared_ptr<request_helper> &member) {
+                                         return member.get() == helper;
+                                       }),
+                        std::end(members));
+          if (!members.empty()) {
+            return;
+          }
+
+          auto &pipelines = pipelines_[pipeline->key_];
+          pipelines.erase(std::remove(std::begin(pipelines), std::end(pipelines), pipeline),
+                          std::end(pipelines));
+          if (pipelines.empty()) {
+            pipelines_.erase(pipeline->key_);
+          }
+        }
+
+        // once every request has been answered, the connection is
+        // returned to the pool like any other
+        pipeline->is_abandoned_ = true;
+        if (pipeline->connection_ && !pipeline->is_writing_ &&
+            pipeline->in_flight_.empty() && (pipeline->response_buffer_.size() == 0)) {
+          pool_.release(pipeline->key_, std::move(pipeline->connection_));
+        }
+      }
+
+      void client::impl::abandon_pipeline(std::shared_ptr<request_pipeline> pipeline,
+                                          bool is_closed_by_server) {
+        if (pipeline->is_abandoned_) {
+          return;
+        }
+        pipeline->is_abandoned_ = true;
+
+        {
+          std::lock_guard<std::mutex> lock(pipelines_mutex_);
+          pipeline->members_.clear();
+          auto &pipelines = pipelines_[pipeline->key_];
+          pipelines.erase(std::remove(std::begin(pipelines), std::end(pipelines), pipeline),
+                          std::end(pipelines));
+          if (pipelines.empty()) {
+            pipelines_.erase(pipeline->key_);
+          }
+
+          // a server that closes a pipelined connection probably
+          // doesn't support pipelining
+          if (is_closed_by_server) {
+            unpipelined_.insert(pipeline->key_);
+          }
+        }
+
+        if (pipeline->connection_) {
+          pipeline->connection_->close();
+        }
+
+        // The request whose response is being read is sent again when
+        // its read fails. Requests that haven't been queued yet find the
+        // pipeline abandoned when they are written, and the first
+        // request goes on with its own connection.
+        std::vector<std::shared_ptr<request_helper>> requests(std::begin(pipeline->queued_),
+                                                               std::end(pipeline->queued_));
+        requests.insert(std::end(requests),
+                        std::begin(pipeline->in_flight_) + (pipeline->is_reading_? 1 : 0),
+                        std::end(pipeline->in_flight_));
+        pipeline->queued_.clear();
+        pipeline->in_flight_.clear();
+        for (auto &request : requests) {
+          retry_unpipelined(request);
+        }
+      }
+
+      void client::impl::retry_unpipelined(std::shared_ptr<request_helper> helper) {
+        if (helper->is_done_) {
+          return;
+        }
+
+        helper->pipeline_.reset();
+        helper->pipeline_done_ = nullptr;
+        helper->is_reused_ = false;
+        helper->request_buffer_.consume(helper->request_buffer_.size());
+        helper->response_buffer_.consume(helper->response_buffer_.size());
+        start_request(helper);
+      }
+
       void client::impl::read_response(const boost::system::error_code &ec, std::size_t,
                                        std::shared_ptr<request_helper> helper) {
-        if (ec) {
-          helper->response_promise_.set_exception(
-            std::make_exception_ptr(std::system_error(ec.value(), std::system_category())));
+        if (helper->is_done_) {
           return;
         }
 
-        std::shared_ptr<response> res(new response{});
-        helper->connection_->async_read_until(helper->response_buffer_,
-                                      "\r\n",
-                                      strand_.wrap(
-                                        [=] (const boost::system::error_code &ec,
-                                             std::size_t bytes_read) {
-                                          read_response_status(ec, bytes_read, helper, res);
-                                        }));
-      }
-
-      void client::impl::read_response_status(const boost::system::error_code &ec,
-                                              std::size_t,
-                                              std::shared_ptr<request_helper> helper,
-                                              std::shared_ptr<response> res) {
         if (ec) {
-          helper->response_promise_.set_exception(
+          if (reconnect_stale(helper)) {
+            return;
+          }
+
+          helper->set_exception(
             std::make_exception_ptr(std::system_error(ec.value(), std::system_category())));
           return;
         }
 
-        std::istream is(&helper->response_buffer_);
-        string_type version;
-        is >> version;
-        unsigned int status;
-        is >> status;
-        string_type message;
-        std::getline(is, message);
+        helper->parser_.reset();
+        helper->parsed_ = 0;
+        helper->token_ = 0;
+        helper->remaining_ = boost::none;
+        helper->is_chunked_ = false;
+        helper->chunked_decoder_.reset();
+
+        std::shared_ptr<response> res(new response{});
+        read_response_headers(boost::system::error_code(), 0, helper, res);
+      }
+
+      boost::logic::tribool client::impl::parse_response_headers(std::shared_ptr<request_helper> helper,
+                                                                  std::shared_ptr<response> res) {
+        typedef boost::iterator_range<const char *> range_type;
+
+        // The parser runs directly over the unconsumed data of the
+        // response buffer, which is always contiguous. Tokens are kept
+        // as offsets into the buffer because it can be reallocated
+        // between reads.
+        while (true) {
+          auto data = helper->response_buffer().data();
+          const char *first = boost::asio::buffer_cast<const char *>(data);
+          range_type input(first + helper->parsed_, first + boost::asio::buffer_size(data));
+          if (boost::empty(input)) {
+            return boost::logic::indeterminate;
+          }
+
+          auto state = helper->parser_.state();
+          auto stop_state = next_stop_state(state);
+          boost::logic::tribool parsed_ok;
+          range_type parsed;
+          std::tie(parsed_ok, parsed) = helper->parser_.parse_until(stop_state, input);
+          if (state == response_parser::http_response_begin) {
+            // leading white space is skipped
+            helper->token_ = std::begin(parsed) - first;
+          }
+          helper->parsed_ = std::end(parsed) - first;
+
+          if (helper->parser_.state() == response_parser::http_headers_done) {
+            helper->response_buffer().consume(helper->parsed_);
+            return true;
+          }
 
-        res->set_version(version);
-        res->set_status(network::http::v2::status::code(status));
-        res->set_status_message(boost::trim_copy(message));
+          if (!parsed_ok || boost::logic::indeterminate(parsed_ok)) {
+            return parsed_ok;
+          }
 
-        helper->connection_->async_read_until(helper->response_buffer_,
-                                      "\r\n\r\n",
-                                      strand_.wrap(
-                                        [=] (const boost::system::error_code &ec,
-                                             std::size_t bytes_read) {
-                                          read_response_headers(ec, bytes_read, helper, res);
-                                        }));
+          boost::string_ref token(first + helper->token_, helper->parsed_ - helper->token_);
+          helper->token_ = helper->parsed_;
+          switch (stop_state) {
+          case response_parser::http_version_done:
+            res->set_version(string_type(trimmed(token)));
+            // HTTP/1.1 connections are persistent unless either side
+            // says otherwise, HTTP/1.0 connections only if the server
+            // agrees
+            helper->keep_alive_ = (res->version() == "HTTP/1.1") && !helper->close_requested_;
+            break;
+          case response_parser::http_status_done:
+            res->set_status(network::http::v2::status::code(to_number(trimmed(token))));
+            break;
+          case response_parser::http_status_message_done:
+            res->set_status_message(string_type(trimmed(token)));
+            break;
+          case response_parser::http_header_colon:
+            token.remove_suffix(1);
+            helper->header_name_ = std::make_pair(helper->parsed_ - token.size() - 1, token.size());
+            break;
+          case response_parser::http_header_line_done: {
+            boost::string_ref name(first + helper->header_name_.first, helper->header_name_.second);
+            name = trimmed(name);
+            auto value = trimmed(token);
+            if (boost::iequals(name, "Connection")) {
+              // the value is a list of options, e.g. "close, TE"
+              if (boost::icontains(value, "close")) {
+                helper->keep_alive_ = false;
+              }
+              else if (boost::icontains(value, "keep-alive")) {
+                helper->keep_alive_ = !helper->close_requested_;
+              }
+            }
+            else if (boost::iequals(name, "Content-Length")) {
+              if (!add_content_length(value, helper->remaining_)) {
+                // where the body ends can't be known, so neither can
+                // where the next response starts
+                helper->keep_alive_ = false;
+                return false;
+              }
+            }
+            else if (boost::iequals(name, "Transfer-Encoding")) {
+              // chunked is always the last coding applied
+              helper->is_chunked_ = boost::iends_with(value, "chunked");
+            }
+            res->add_header(string_type(name), string_type(value));
+            break;
+          }
+          default:
+            break;
+          }
+        }
       }
 
       void client::impl::read_response_headers(const boost::system::error_code &ec,
-                                               std::size_t,
+                                               std::size_t bytes_read,
                                                std::shared_ptr<request_helper> helper,
                                                std::shared_ptr<response> res) {
+        if (helper->is_done_) {
+          return;
+        }
+
         if (ec) {
-          helper->response_promise_.set_exception(
+          if (helper->pipeline_ && (helper->response_buffer().size() == 0)) {
+            // nothing of this response has arrived, so the request is
+            // sent again on a connection of its own
+            abandon_pipeline(helper->pipeline_, helper->pipeline_->responses_ != 0);
+            retry_unpipelined(helper);
+            return;
+          }
+
+          if ((helper->response_buffer().size() == 0) && reconnect_stale(helper)) {
+            return;
+          }
+
+          helper->set_exception(
             std::make_exception_ptr(std::system_error(ec.value(), std::system_category())));
           return;
         }
 
-        // fill headers
-        std::istream is(&helper->response_buffer_);
-        string_type header;
-        while (std::getline(is, header) && (header != "\r")) {
-          auto delim = boost::find_first_of(header, ":");
-          string_type key(std::begin(header), delim);
-          while (*++delim == ' ') { }
-          string_type value(delim, std::end(header));
-          res->add_header(key, value);
+        if (bytes_read != 0) {
+          // the server has answered, so the connection is no longer
+          // suspected to be stale
+          helper->is_reused_ = false;
         }
 
-        helper->connection_->async_read(helper->response_buffer_,
-                                strand_.wrap(
-                                  [=] (const boost::system::error_code &ec,
-                                       std::size_t bytes_read) {
-                                    read_response_body(ec, bytes_read, helper, res);
-                                  }));
-      }
+        auto parsed_ok = parse_response_headers(helper, res);
+        if (!parsed_ok) {
+          helper->set_exception(
+            std::make_exception_ptr(client_exception(client_error::invalid_response)));
+          return;
+        }
 
-      namespace {
-        std::istream &getline_with_newline(std::istream &is, std::string &line) {
-          line.clear();
+        if (boost::logic::indeterminate(parsed_ok)) {
+          helper->response_buffer().prepare(read_buffer_size);
+          start_timer(helper->timer_, helper->options_.read_timeout(), helper);
+          helper->connection().async_read(helper->response_buffer(),
+                                          helper->strand_.wrap(
+                                            [=] (const boost::system::error_code &ec,
+                                                 std::size_t bytes_read) {
+                                              read_response_headers(ec, bytes_read, helper, res);
+                                            }));
+          return;
+        }
 
-          std::istream::sentry se(is, true);
-          std::streambuf *sb = is.rdbuf();
+        auto status = static_cast<int>(res->status());
+        if ((status >= 100) && (status < 200) && (status != 101)) {
+          // an interim response (100 Continue, 103 Early Hints) is
+          // followed by the final one on the same connection, which
+          // is what the request is answered with
+          read_response(boost::system::error_code(), 0, helper);
+          return;
+        }
 
-          while (true) {
-            int c = sb->sbumpc();
-            switch (c) {
-            case EOF:
-              if (line.empty()) {
-                is.setstate(std::ios::eofbit);
-              }
-              return is;
-            default:
-              line += static_cast<char>(c);
-            }
-          }
+        if (status == 101) {
+          // the connection now speaks another protocol
+          helper->keep_alive_ = false;
         }
-      } // namespace
+
+        if ((helper->request_.method() == method::head) ||
+            (status == 101) || (status == 204) || (status == 304)) {
+          helper->remaining_ = 0;
+          helper->is_chunked_ = false;
+        }
+        else if (helper->is_chunked_) {
+          helper->remaining_ = boost::none;
+        }
+        else if (!helper->remaining_) {
+          // without any framing, which is only expected from HTTP/1.0
+          // servers, the body is delimited by the server closing the
+          // connection
+          helper->keep_alive_ = false;
+        }
+
+        // part of the body may already have been read with the headers
+        read_response_body(boost::system::error_code(), 0, helper, res);
+      }
 
       void client::impl::read_response_body(const boost::system::error_code &ec,
-                                            std::size_t bytes_read,
+                                            std::size_t,
                                             std::shared_ptr<request_helper> helper,
                                             std::shared_ptr<response> res) {
-        if (bytes_read == 0) {
-          helper->response_promise_.set_value(*res);
+        if (helper->is_done_) {
+          return;
+        }
+
+        bool eof = (ec == boost::asio::error::eof);
+        if (ec && !eof) {
+          helper->set_exception(
+            std::make_exception_ptr(std::system_error(ec.value(), std::system_category())));
+          return;
+        }
+
+        if (helper->is_chunked_) {
+          read_chunked_body(eof, helper, res);
+          return;
+        }
+
+        auto data = helper->response_buffer().data();
+        auto length = boost::asio::buffer_size(data);
+        if (helper->remaining_) {
+          length = std::min(length, *helper->remaining_);
+          *helper->remaining_ -= length;
+        }
+        if (!append_body(helper, res, boost::asio::buffer_cast<const char *>(data), length)) {
           return;
         }
+        helper->response_buffer().consume(length);
 
-        std::istream is(&helper->response_buffer_);
-        string_type line;
-        while (!getline_with_newline(is, line).eof()) {
-          res->append_body(line);
+        if (helper->remaining_ && (*helper->remaining_ == 0)) {
+          finish_response(helper, res);
+          return;
         }
 
-        helper->connection_->async_read(helper->response_buffer_,
-                                strand_.wrap(
+        if (eof) {
+          if (helper->remaining_) {
+            // the connection was closed before the whole body arrived
+            helper->set_exception(
+              std::make_exception_ptr(client_exception(client_error::invalid_response)));
+            return;
+          }
+
+          helper->keep_alive_ = false;
+          finish_response(helper, res);
+          return;
+        }
+
+        read_more_body(helper, res);
+      }
+
+      bool client::impl::append_body(std::shared_ptr<request_helper> helper,
+                                     std::shared_ptr<response> res,
+                                     const char *data,
+                                     std::size_t length) {
+        if (length == 0) {
+          return true;
+        }
+
+        if (!helper->body_handler_) {
+          res->append_body(data, length);
+          return true;
+        }
+
+        // the handler is called before the next read is started, which
+        // stops the body from arriving faster than it is consumed
+        try {
+          helper->body_handler_(data, length);
+        }
+        catch (...) {
+          helper->set_exception(std::current_exception());
+          // a pipelined connection is closed when the pipeline is
+          // abandoned
+          if (helper->connection_) {
+            helper->connection_->close();
+          }
+          return false;
+        }
+        return true;
+      }
+
+      void client::impl::read_chunked_body(bool eof,
+                                           std::shared_ptr<request_helper> helper,
+                                           std::shared_ptr<response> res) {
+        // the chunks are decoded in place, and only the chunk data is
+        // appended to the body
+        auto data = helper->response_buffer().data();
+        const char *first = boost::asio::buffer_cast<const char *>(data);
+        const char *last = first + boost::asio::buffer_size(data);
+        boost::logic::tribool decoded_ok;
+        const char *decoded = first;
+        std::tie(decoded_ok, decoded) =
+          helper->chunked_decoder_.decode(first, last,
+                                          [&] (const char *data_first, const char *data_last) {
+                                            if (!helper->is_done_) {
+                                              append_body(helper, res, data_first, data_last - data_first);
+                                            }
+                                          });
+        if (helper->is_done_) {
+          return;
+        }
+        helper->response_buffer().consume(decoded - first);
+
+        if (decoded_ok) {
+          finish_response(helper, res);
+          return;
+        }
+
+        if (!decoded_ok || eof) {
+          helper->set_exception(
+            std::make_exception_ptr(client_exception(client_error::invalid_response)));
+          return;
+        }
+
+        read_more_body(helper, res);
+      }
+
+      void client::impl::read_more_body(std::shared_ptr<request_helper> helper,
+                                        std::shared_ptr<response> res) {
+        helper->response_buffer().prepare(read_buffer_size);
+        start_timer(helper->timer_, helper->options_.read_timeout(), helper);
+        helper->connection().async_read(helper->response_buffer(),
+                                helper->strand_.wrap(
                                   [=] (const boost::system::error_code &ec,
                                        std::size_t bytes_read) {
                                     read_response_body(ec, bytes_read, helper, res);
                                   }));
       }
 
+      void client::impl::finish_response(std::shared_ptr<request_helper> helper,
+                                         std::shared_ptr<response> res) {
+        if (helper->is_done_) {
+          return;
+        }
+
+        // unread data would be mistaken for the next response; a
+        // pipelined connection is released once all its requests are
+        // done
+        if (!helper->pipeline_ && helper->keep_alive_ && (helper->response_buffer().size() == 0)) {
+          pool_.release(helper->connection_key_, std::move(helper->connection_));
+        }
+
+        helper->set_value(std::move(*res));
+      }
+
       client::client(client_options options)
 	: pimpl_(new impl(options)) {
 
@@ -332,32 +1433,32 @@ namespace network {
 
       std::future<client::response> client::get(request req, request_options options) {
 	req.method(method::get);
-	return pimpl_->do_request(std::make_shared<request_helper>(pimpl_->io_service_, req, options));
+	return pimpl_->do_request(req, options);
       }
 
       std::future<client::response> client::post(request req, request_options options) {
 	req.method(method::post);
-	return pimpl_->do_request(std::make_shared<request_helper>(pimpl_->io_service_, req, options));
+	return pimpl_->do_request(req, options);
       }
 
       std::future<client::response> client::put(request req, request_options options) {
 	req.method(method::put);
-	return pimpl_->do_request(std::make_shared<request_helper>(pimpl_->io_service_, req, options));
+	return pimpl_->do_request(req, options);
       }
 
       std::future<client::response> client::delete_(request req, request_options options) {
 	req.method(method::delete_);
-	return pimpl_->do_request(std::make_shared<request_helper>(pimpl_->io_service_, req, options));
+	return pimpl_->do_request(req, options);
       }
 
       std::future<client::response> client::head(request req, request_options options) {
 	req.method(method::head);
-	return pimpl_->do_request(std::make_shared<request_helper>(pimpl_->io_service_, req, options));
+	return pimpl_->do_request(req, options);
       }
 
       std::future<client::response> client::options(request req, request_options options) {
 	req.method(method::options);
-	return pimpl_->do_request(std::make_shared<request_helper>(pimpl_->io_service_, req, options));
+	return pimpl_->do_request(req, options);
       }
     } // namespace v2
   } // namespace http
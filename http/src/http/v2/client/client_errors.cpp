@@ -41,6 +41,8 @@ namespace network {
 	  return "Invalid HTTP request.";
         case client_error::host_not_found:
 	  return "Unable to resolve host.";
+        case client_error::timeout:
+	  return "Request timed out.";
         case client_error::invalid_response:
 	  return "Invalid HTTP response.";
 	default:
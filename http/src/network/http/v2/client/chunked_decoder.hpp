@@ -0,0 +1,216 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_HTTP_V2_CLIENT_CHUNKED_DECODER_INC
+#define NETWORK_HTTP_V2_CLIENT_CHUNKED_DECODER_INC
+
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <iterator>
+#include <algorithm>
+#include <boost/logic/tribool.hpp>
+
+namespace network {
+  namespace http {
+    namespace v2 {
+
+      /**
+       * \ingroup http_client
+       * \class chunked_decoder chunked_decoder.hpp network/http/v2/client/chunked_decoder.hpp
+       * \brief Decodes a response body sent with
+       *        <tt>Transfer-Encoding: chunked</tt>.
+       *
+       * The decoder is incremental: it can be fed the body in pieces
+       * of any size as they arrive, and passes the chunk data to a
+       * callback without copying it. Chunk extensions and trailers
+       * are skipped.
+       */
+      struct chunked_decoder {
+
+        enum state_t {
+          chunk_size_start,
+          chunk_size,
+          chunk_extension,
+          chunk_size_cr,
+          chunk_data,
+          chunk_data_cr,
+          chunk_data_lf,
+          trailer_start,
+          trailer_char,
+          trailer_cr,
+          chunks_end_cr,
+          chunks_done
+        };
+
+        chunked_decoder()
+          : state_(chunk_size_start), remaining_(0) {}
+
+        ~chunked_decoder() {}
+
+        /**
+         * \brief Decodes as much of the input as possible.
+         * \param first The start of the input.
+         * \param last The end of the input.
+         * \param callback Called with an iterator pair for each piece
+         *        of chunk data.
+         * \returns \c true and the end of the body if the last chunk
+         *          was decoded, \c false if the input is malformed,
+         *          or \c indeterminate and \c last if more input is
+         *          needed.
+         */
+        template <class Iterator, class Callback>
+        std::tuple<boost::logic::tribool, Iterator>
+          decode(Iterator first, Iterator last, Callback callback) {
+          boost::logic::tribool decoded_ok(boost::logic::indeterminate);
+          Iterator current = first;
+          while ((current != last) && boost::logic::indeterminate(decoded_ok)) {
+            switch (state_) {
+            case chunk_size_start:
+              if (is_hex_digit(*current)) {
+                remaining_ = hex_value(*current);
+                state_ = chunk_size;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            case chunk_size:
+              if (is_hex_digit(*current)) {
+                if (remaining_ > (std::numeric_limits<std::uint64_t>::max() >> 4)) {
+                  decoded_ok = false;
+                  break;
+                }
+                remaining_ = (remaining_ << 4) | hex_value(*current);
+                ++current;
+              } else if ((*current == ';') || (*current == ' ') || (*current == '\t')) {
+                state_ = chunk_extension;
+                ++current;
+              } else if (*current == '\r') {
+                state_ = chunk_size_cr;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            case chunk_extension:
+              if (*current == '\r') {
+                state_ = chunk_size_cr;
+              }
+              ++current;
+              break;
+            case chunk_size_cr:
+              if (*current == '\n') {
+                state_ = (remaining_ == 0)? trailer_start : chunk_data;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            case chunk_data: {
+              auto available = static_cast<std::uint64_t>(std::distance(current, last));
+              auto length = std::min(available, remaining_);
+              Iterator data_end = current;
+              std::advance(data_end, length);
+              callback(current, data_end);
+              current = data_end;
+              remaining_ -= length;
+              if (remaining_ == 0) {
+                state_ = chunk_data_cr;
+              }
+              break;
+            }
+            case chunk_data_cr:
+              if (*current == '\r') {
+                state_ = chunk_data_lf;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            case chunk_data_lf:
+              if (*current == '\n') {
+                state_ = chunk_size_start;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            case trailer_start:
+              if (*current == '\r') {
+                state_ = chunks_end_cr;
+              } else {
+                state_ = trailer_char;
+              }
+              ++current;
+              break;
+            case trailer_char:
+              if (*current == '\r') {
+                state_ = trailer_cr;
+              }
+              ++current;
+              break;
+            case trailer_cr:
+              if (*current == '\n') {
+                state_ = trailer_start;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            case chunks_end_cr:
+              if (*current == '\n') {
+                state_ = chunks_done;
+                ++current;
+              } else {
+                decoded_ok = false;
+              }
+              break;
+            default:
+              decoded_ok = false;
+            }
+
+            if (state_ == chunks_done) {
+              decoded_ok = true;
+            }
+          }
+          return std::make_tuple(decoded_ok, current);
+        }
+
+        state_t state() const { return state_; }
+
+        void reset() {
+          state_ = chunk_size_start;
+          remaining_ = 0;
+        }
+
+      private:
+
+        static bool is_hex_digit(char c) {
+          return ((c >= '0') && (c <= '9')) ||
+            ((c >= 'a') && (c <= 'f')) ||
+            ((c >= 'A') && (c <= 'F'));
+        }
+
+        static std::uint64_t hex_value(char c) {
+          if ((c >= '0') && (c <= '9')) {
+            return c - '0';
+          }
+          else if ((c >= 'a') && (c <= 'f')) {
+            return c - 'a' + 10;
+          }
+          return c - 'A' + 10;
+        }
+
+        state_t state_;
+        std::uint64_t remaining_;
+
+      };
+
+    } // namespace v2
+  } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_V2_CLIENT_CHUNKED_DECODER_INC
@@ -45,8 +45,17 @@ namespace network {
           : io_service_(boost::none)
           , follow_redirects_(false)
           , cache_resolved_(false)
+          , max_cache_resolved_(1024)
+          , cache_resolved_ttl_(300000)
           , use_proxy_(false)
-          , timeout_(30000) { }
+          , timeout_(30000)
+          , connection_attempt_delay_(250)
+          , max_idle_connections_(64)
+          , max_idle_connections_per_host_(8)
+          , idle_timeout_(30000)
+          , num_threads_(1)
+          , pipelining_(false)
+          , max_pipelined_requests_(8) { }
 
         /**
          * \brief Copy constructor.
@@ -81,8 +90,17 @@ namespace network {
           std::swap(io_service_, other.io_service_);
           swap(follow_redirects_, other.follow_redirects_);
           swap(cache_resolved_, other.cache_resolved_);
+          swap(max_cache_resolved_, other.max_cache_resolved_);
+          swap(cache_resolved_ttl_, other.cache_resolved_ttl_);
           swap(use_proxy_, other.use_proxy_);
           swap(timeout_, other.timeout_);
+          swap(connection_attempt_delay_, other.connection_attempt_delay_);
+          swap(max_idle_connections_, other.max_idle_connections_);
+          swap(max_idle_connections_per_host_, other.max_idle_connections_per_host_);
+          swap(idle_timeout_, other.idle_timeout_);
+          swap(num_threads_, other.num_threads_);
+          swap(pipelining_, other.pipelining_);
+          swap(max_pipelined_requests_, other.max_pipelined_requests_);
           swap(openssl_certificate_paths_, other.openssl_certificate_paths_);
           swap(openssl_verify_paths_, other.openssl_verify_paths_);
         }
@@ -90,6 +108,10 @@ namespace network {
         /**
          * \brief Overrides the client's I/O service.
          * \param io_service The new io_service object to use.
+         *
+         * The client doesn't start any threads of its own to run an
+         * I/O service supplied by the application, and all requests
+         * must have completed before the client is destroyed.
          */
         client_options &io_service(boost::asio::io_service &io_service) {
           io_service_ = io_service;
@@ -104,6 +126,29 @@ namespace network {
           return io_service_;
         }
 
+        /**
+         * \brief Sets the number of threads that run the client's own
+         *        I/O service.
+         * \param num_threads The number of threads.
+         * \returns \c *this
+         *
+         * Each request is processed on its own strand, so concurrent
+         * requests are spread across all the threads. This is ignored
+         * if the I/O service is supplied by the application.
+         */
+        client_options &num_threads(std::size_t num_threads) {
+          num_threads_ = num_threads;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the number of threads.
+         * \returns The number of threads.
+         */
+        std::size_t num_threads() const {
+          return num_threads_;
+        }
+
         /**
          * \brief Tells the client to follow redirects.
          * \param follow_redirects If \c true, then the client must
@@ -145,6 +190,43 @@ namespace network {
           return cache_resolved_;
         }
 
+        /**
+         * \brief Sets the maximum number of hosts in the cache of
+         *        resolved connections.
+         * \param max_cache_resolved The maximum number of hosts.
+         * \returns \c *this
+         */
+        client_options &max_cache_resolved(std::size_t max_cache_resolved) {
+          max_cache_resolved_ = max_cache_resolved;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the maximum number of cached hosts.
+         * \returns The maximum number of cached hosts.
+         */
+        std::size_t max_cache_resolved() const {
+          return max_cache_resolved_;
+        }
+
+        /**
+         * \brief Sets the time for which a resolved host is cached.
+         * \param cache_resolved_ttl The time to live in milliseconds.
+         * \returns \c *this
+         */
+        client_options &cache_resolved_ttl(std::chrono::milliseconds cache_resolved_ttl) {
+          cache_resolved_ttl_ = cache_resolved_ttl;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the time for which a resolved host is cached.
+         * \returns The time to live in milliseconds.
+         */
+        std::chrono::milliseconds cache_resolved_ttl() const {
+          return cache_resolved_ttl_;
+        }
+
         /**
          * \brief Tells the client to use a proxy.
          * \param use_proxy If \c true, then the client must use a
@@ -166,6 +248,10 @@ namespace network {
 
         /**
          * \brief Sets the client timeout in milliseconds.
+         *
+         * This limits the time taken to establish a connection to a
+         * server. A value of \c 0 disables the timeout.
+         *
          * \param timeout The timeout value in milliseconds.
          */
         client_options &timeout(std::chrono::milliseconds timeout) {
@@ -181,6 +267,132 @@ namespace network {
           return timeout_;
         }
 
+        /**
+         * \brief Sets the time to wait for a connection attempt before
+         *        the next resolved address is tried in parallel.
+         * \param connection_attempt_delay The delay in milliseconds.
+         * \returns \c *this
+         */
+        client_options &connection_attempt_delay(std::chrono::milliseconds connection_attempt_delay) {
+          connection_attempt_delay_ = connection_attempt_delay;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the connection attempt delay.
+         * \returns The delay in milliseconds.
+         */
+        std::chrono::milliseconds connection_attempt_delay() const {
+          return connection_attempt_delay_;
+        }
+
+        /**
+         * \brief Sets the maximum number of idle connections that the
+         *        client keeps alive for reuse.
+         * \param max_idle_connections The maximum number of idle
+         *        connections. If \c 0, connections are never reused.
+         * \returns \c *this
+         */
+        client_options &max_idle_connections(std::size_t max_idle_connections) {
+          max_idle_connections_ = max_idle_connections;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the maximum number of idle connections.
+         * \returns The maximum number of idle connections.
+         */
+        std::size_t max_idle_connections() const {
+          return max_idle_connections_;
+        }
+
+        /**
+         * \brief Sets the maximum number of idle connections that the
+         *        client keeps alive for a single host.
+         * \param max_idle_connections_per_host The maximum number of
+         *        idle connections per host.
+         * \returns \c *this
+         */
+        client_options &max_idle_connections_per_host(std::size_t max_idle_connections_per_host) {
+          max_idle_connections_per_host_ = max_idle_connections_per_host;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the maximum number of idle connections per host.
+         * \returns The maximum number of idle connections per host.
+         */
+        std::size_t max_idle_connections_per_host() const {
+          return max_idle_connections_per_host_;
+        }
+
+        /**
+         * \brief Sets the time after which an idle connection is
+         *        closed.
+         * \param idle_timeout The idle timeout in milliseconds.
+         * \returns \c *this
+         */
+        client_options &idle_timeout(std::chrono::milliseconds idle_timeout) {
+          idle_timeout_ = idle_timeout;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the idle connection timeout.
+         * \returns The idle timeout in milliseconds.
+         */
+        std::chrono::milliseconds idle_timeout() const {
+          return idle_timeout_;
+        }
+
+        /**
+         * \brief Tells the client to pipeline requests.
+         * \param pipelining If \c true, then requests to the same
+         *        host are written back to back on a persistent
+         *        connection without waiting for the previous responses,
+         *        if \c false they aren't.
+         * \returns \c *this
+         *
+         * Only \c GET, \c HEAD and \c OPTIONS requests without a
+         * body are pipelined. If the server closes a pipelined
+         * connection, the unanswered requests are sent again on
+         * connections of their own and requests to that host are no
+         * longer pipelined.
+         */
+        client_options &pipelining(bool pipelining) {
+          pipelining_ = pipelining;
+          return *this;
+        }
+
+        /**
+         * \brief Tests if the client pipelines requests.
+         * \returns \c true if the client pipelines requests, \c false
+         *          otherwise.
+         */
+        bool pipelining() const {
+          return pipelining_;
+        }
+
+        /**
+         * \brief Sets the maximum number of requests that are
+         *        pipelined on a single connection.
+         * \param max_pipelined_requests The maximum number of
+         *        requests.
+         * \returns \c *this
+         */
+        client_options &max_pipelined_requests(std::size_t max_pipelined_requests) {
+          max_pipelined_requests_ = max_pipelined_requests;
+          return *this;
+        }
+
+        /**
+         * \brief Gets the maximum number of pipelined requests.
+         * \returns The maximum number of pipelined requests.
+         */
+        std::size_t max_pipelined_requests() const {
+          return max_pipelined_requests_;
+        }
+
         /**
          * \brief Adds an OpenSSL certificate path.
          * \param path The certificate path.
@@ -220,8 +432,17 @@ namespace network {
         boost::optional<boost::asio::io_service &> io_service_;
         bool follow_redirects_;
         bool cache_resolved_;
+        std::size_t max_cache_resolved_;
+        std::chrono::milliseconds cache_resolved_ttl_;
         bool use_proxy_;
         std::chrono::milliseconds timeout_;
+        std::chrono::milliseconds connection_attempt_delay_;
+        std::size_t max_idle_connections_;
+        std::size_t max_idle_connections_per_host_;
+        std::chrono::milliseconds idle_timeout_;
+        std::size_t num_threads_;
+        bool pipelining_;
+        std::size_t max_pipelined_requests_;
         std::vector<std::string> openssl_certificate_paths_;
         std::vector<std::string> openssl_verify_paths_;
 
@@ -32,6 +32,7 @@ namespace network {
 
         // connection
         host_not_found,
+        timeout,
 
         // response
         invalid_response,
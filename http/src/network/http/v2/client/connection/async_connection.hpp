@@ -13,6 +13,7 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <boost/asio/buffer.hpp>
@@ -66,6 +67,15 @@ namespace network {
           virtual void async_connect(const boost::asio::ip::tcp::endpoint &endpoint,
                                      connect_callback callback) = 0;
 
+          /**
+           * \brief Asynchronously creates a connection to the first of
+           *        several endpoints that accepts it.
+           * \param endpoints The endpoints to which to connect.
+           * \param callback A callback handler.
+           */
+          virtual void async_connect(const std::vector<boost::asio::ip::tcp::endpoint> &endpoints,
+                                     connect_callback callback) = 0;
+
           /**
            * \brief Asynchronously writes data across the connection.
            * \param command_streambuf
@@ -74,6 +84,16 @@ namespace network {
           virtual void async_write(boost::asio::streambuf &command_streambuf,
                                    write_callback callback) = 0;
 
+          /**
+           * \brief Asynchronously writes a sequence of buffers across the
+           *        connection in a single operation.
+           * \param buffers The buffers, which must remain valid until the
+           *        callback is invoked.
+           * \param callback A callback handler.
+           */
+          virtual void async_write(const std::vector<boost::asio::const_buffer> &buffers,
+                                   write_callback callback) = 0;
+
           /**
            * \brief Asynchronously reads some data from the connection.
            * \param command_streambuf
@@ -98,6 +118,18 @@ namespace network {
            */
           virtual void cancel() = 0;
 
+          /**
+           * \brief Tests if the connection is open.
+           * \returns \c true if the underlying socket is open, \c false
+           *          otherwise.
+           */
+          virtual bool is_open() const = 0;
+
+          /**
+           * \brief Closes the connection.
+           */
+          virtual void close() = 0;
+
         };
       } // namespace client_connection
     } // namespace v2
@@ -0,0 +1,120 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_HTTP_V2_CLIENT_CONNECTION_CONNECTION_FACTORY_INC
+#define NETWORK_HTTP_V2_CLIENT_CONNECTION_CONNECTION_FACTORY_INC
+
+/**
+ * \file
+ * \brief
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/asio/io_service.hpp>
+#include <network/config.hpp>
+#include <network/http/v2/client/connection/async_connection.hpp>
+#include <network/http/v2/client/connection/normal_connection.hpp>
+#ifdef NETWORK_ENABLE_HTTPS
+#include <network/http/v2/client/connection/ssl_connection.hpp>
+#endif // NETWORK_ENABLE_HTTPS
+
+namespace network {
+  namespace http {
+    namespace v2 {
+      namespace client_connection {
+        /**
+         * \class connection_factory network/http/v2/client/connection/connection_factory.hpp
+         * \brief Creates the connections of a client.
+         *
+         * HTTPS connections share one TLS context, which is built the
+         * first time one is created.
+         */
+        class connection_factory {
+
+          connection_factory(const connection_factory &) = delete;
+          connection_factory &operator = (const connection_factory &) = delete;
+
+        public:
+
+          /**
+           * \brief Constructor.
+           * \param io_service The I/O service.
+           * \param connection_attempt_delay The time to wait for a
+           *        connection attempt before the next one is started.
+           * \param certificate_paths Files of certificates to verify
+           *        servers with.
+           * \param verify_paths Directories of certificates to verify
+           *        servers with.
+           */
+          connection_factory(boost::asio::io_service &io_service,
+                             std::chrono::milliseconds connection_attempt_delay,
+                             std::vector<std::string> certificate_paths,
+                             std::vector<std::string> verify_paths)
+            : io_service_(io_service)
+            , connection_attempt_delay_(connection_attempt_delay)
+            , certificate_paths_(std::move(certificate_paths))
+            , verify_paths_(std::move(verify_paths)) {
+
+          }
+
+          /**
+           * \brief Creates a connection to a host.
+           * \param is_https Whether the connection is over TLS.
+           * \param host The host.
+           * \param port The port.
+           * \returns The connection, or \c nullptr if HTTPS isn't
+           *          supported.
+           */
+          std::unique_ptr<async_connection> create(bool is_https,
+                                                   const std::string &host,
+                                                   std::uint16_t port) {
+            if (!is_https) {
+              return std::unique_ptr<async_connection>(
+                new normal_connection(io_service_, connection_attempt_delay_));
+            }
+
+#ifdef NETWORK_ENABLE_HTTPS
+            return std::unique_ptr<async_connection>(
+              new ssl_connection(io_service_, ssl_context(), host, port,
+                                 connection_attempt_delay_));
+#else
+            return nullptr;
+#endif // NETWORK_ENABLE_HTTPS
+          }
+
+        private:
+
+#ifdef NETWORK_ENABLE_HTTPS
+          std::shared_ptr<ssl_client_context> ssl_context() {
+            std::lock_guard<std::mutex> lock(ssl_context_mutex_);
+            if (!ssl_context_) {
+              ssl_context_ = std::make_shared<ssl_client_context>(certificate_paths_,
+                                                                  verify_paths_);
+            }
+            return ssl_context_;
+          }
+#endif // NETWORK_ENABLE_HTTPS
+
+          boost::asio::io_service &io_service_;
+          std::chrono::milliseconds connection_attempt_delay_;
+          std::vector<std::string> certificate_paths_;
+          std::vector<std::string> verify_paths_;
+#ifdef NETWORK_ENABLE_HTTPS
+          std::mutex ssl_context_mutex_;
+          std::shared_ptr<ssl_client_context> ssl_context_;
+#endif // NETWORK_ENABLE_HTTPS
+
+        };
+      } // namespace client_connection
+    } // namespace v2
+  } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_V2_CLIENT_CONNECTION_CONNECTION_FACTORY_INC
@@ -0,0 +1,193 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_HTTP_V2_CLIENT_CONNECTION_CONNECTION_POOL_INC
+#define NETWORK_HTTP_V2_CLIENT_CONNECTION_CONNECTION_POOL_INC
+
+/**
+ * \file
+ * \brief
+ */
+
+#include <memory>
+#include <string>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <network/config.hpp>
+#include <network/http/v2/client/connection/async_connection.hpp>
+
+namespace network {
+  namespace http {
+    namespace v2 {
+      namespace client_connection {
+        /**
+         * \class connection_pool network/http/v2/client/connection/connection_pool.hpp
+         * \brief Keeps idle, persistent connections so that they can
+         *        be reused by subsequent requests to the same origin.
+         *
+         * Connections are keyed by scheme, host and port. The most
+         * recently released connection for a key is handed out first,
+         * and connections that have been idle for longer than the
+         * idle timeout are discarded.
+         */
+        class connection_pool {
+
+          connection_pool(const connection_pool &) = delete;
+          connection_pool &operator = (const connection_pool &) = delete;
+
+        public:
+
+          /**
+           * \typedef connection_ptr
+           */
+          typedef std::unique_ptr<async_connection> connection_ptr;
+
+          /**
+           * \typedef clock
+           */
+          typedef std::chrono::steady_clock clock;
+
+          /**
+           * \brief Constructor.
+           * \param max_idle The maximum number of idle connections.
+           * \param max_idle_per_host The maximum number of idle
+           *        connections for a single key.
+           * \param idle_timeout The time after which an idle
+           *        connection is discarded.
+           */
+          connection_pool(std::size_t max_idle,
+                          std::size_t max_idle_per_host,
+                          std::chrono::milliseconds idle_timeout)
+            : max_idle_(max_idle)
+            , max_idle_per_host_(max_idle_per_host)
+            , idle_timeout_(idle_timeout) {
+
+          }
+
+          /**
+           * \brief Destructor.
+           */
+          ~connection_pool() noexcept {
+
+          }
+
+          /**
+           * \brief Creates a key to identify connections to the same
+           *        origin.
+           */
+          static std::string make_key(bool is_https,
+                                      const std::string &host,
+                                      std::uint16_t port) {
+            std::string key(is_https? "https://" : "http://");
+            key.append(host);
+            key.append(":");
+            key.append(std::to_string(port));
+            return key;
+          }
+
+          /**
+           * \brief Takes an idle connection from the pool.
+           * \param key The connection key.
+           * \returns An open connection, or \c nullptr if there are
+           *          no idle connections for the key.
+           */
+          connection_ptr acquire(const std::string &key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expire(clock::now());
+            for (auto it = std::begin(idle_); it != std::end(idle_); ++it) {
+              if (it->key == key) {
+                connection_ptr connection(std::move(it->connection));
+                idle_.erase(it);
+                if (connection->is_open()) {
+                  return connection;
+                }
+                break;
+              }
+            }
+            return connection_ptr();
+          }
+
+          /**
+           * \brief Returns a connection to the pool once a response
+           *        has been completely read.
+           * \param key The connection key.
+           * \param connection The connection.
+           */
+          void release(const std::string &key, connection_ptr connection) {
+            if (!connection || !connection->is_open()) {
+              return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = clock::now();
+            expire(now);
+
+            auto per_host = std::count_if(std::begin(idle_), std::end(idle_),
+                                          [&key] (const entry &e) { return e.key == key; });
+            if (static_cast<std::size_t>(per_host) >= max_idle_per_host_) {
+              // drop the least recently used connection for this host
+              auto it = std::find_if(idle_.rbegin(), idle_.rend(),
+                                     [&key] (const entry &e) { return e.key == key; });
+              if (it != idle_.rend()) {
+                idle_.erase(std::next(it).base());
+              }
+            }
+
+            if (max_idle_per_host_ != 0) {
+              idle_.emplace_front(entry{key, std::move(connection), now});
+            }
+
+            while (idle_.size() > max_idle_) {
+              idle_.pop_back();
+            }
+          }
+
+          /**
+           * \brief Returns the number of idle connections.
+           */
+          std::size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return idle_.size();
+          }
+
+          /**
+           * \brief Closes all idle connections.
+           */
+          void clear() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.clear();
+          }
+
+        private:
+
+          struct entry {
+            std::string key;
+            connection_ptr connection;
+            clock::time_point released;
+          };
+
+          void expire(clock::time_point now) {
+            // the list is ordered from most to least recently used
+            while (!idle_.empty() && (now - idle_.back().released) >= idle_timeout_) {
+              idle_.pop_back();
+            }
+          }
+
+          std::size_t max_idle_;
+          std::size_t max_idle_per_host_;
+          std::chrono::milliseconds idle_timeout_;
+          mutable std::mutex mutex_;
+          std::list<entry> idle_;
+
+        };
+      } // namespace client_connection
+    } // namespace v2
+  } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_V2_CLIENT_CONNECTION_CONNECTION_POOL_INC
@@ -12,7 +12,13 @@
  */
 
 #include <string>
+#include <list>
 #include <unordered_map>
+#include <utility>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <boost/optional.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
 
@@ -20,48 +26,218 @@ namespace network {
   namespace http {
     namespace v2 {
       namespace client_connection {
-
+        /**
+         * \class endpoint_cache network/http/v2/client/connection/endpoint_cache.hpp
+         * \brief A bounded, thread-safe cache of resolved endpoints.
+         *
+         * Each entry expires after its own time to live, and the least
+         * recently used entry is evicted when the cache is full. Failed
+         * lookups are cached too, for a shorter time, so that a host
+         * that can't be resolved isn't looked up for every request.
+         */
         class endpoint_cache {
 
-          typedef boost::asio::ip::tcp::resolver resolver;
+          endpoint_cache(const endpoint_cache &) = delete;
+          endpoint_cache &operator = (const endpoint_cache &) = delete;
 
-          typedef resolver::iterator resolver_iterator;
+        public:
 
-          typedef std::unordered_map<std::string,
-                                     resolver_iterator> cache_type;
+          /**
+           * \typedef resolver_iterator
+           */
+          typedef boost::asio::ip::tcp::resolver::iterator resolver_iterator;
+
+          /**
+           * \typedef clock
+           */
+          typedef std::chrono::steady_clock clock;
+
+          /**
+           * \typedef value_type
+           * \brief The result of a lookup: either an error or the
+           *        resolved endpoints.
+           */
+          typedef std::pair<boost::system::error_code, resolver_iterator> value_type;
+
+          /**
+           * \brief Constructor.
+           * \param max_entries The maximum number of entries.
+           * \param ttl The time for which resolved endpoints are kept.
+           * \param negative_ttl The time for which failed lookups are
+           *        kept.
+           */
+          explicit endpoint_cache(std::size_t max_entries = 1024,
+                                  std::chrono::milliseconds ttl = std::chrono::milliseconds(300000),
+                                  std::chrono::milliseconds negative_ttl = std::chrono::milliseconds(5000))
+            : max_entries_(max_entries)
+            , ttl_(ttl)
+            , negative_ttl_(negative_ttl)
+            , hits_(0)
+            , misses_(0) {
 
-        public:
+          }
 
-          typedef cache_type::iterator iterator;
+          /**
+           * \brief Destructor.
+           */
+          ~endpoint_cache() noexcept {
 
-          cache_type::iterator begin() {
-            return endpoints_.begin();
           }
 
-          cache_type::iterator end() {
-            return endpoints_.end();
+          /**
+           * \brief Creates the key of a host and port. Host names are
+           *        case insensitive.
+           */
+          static std::string make_key(const std::string &host, std::uint16_t port) {
+            std::string key(boost::to_lower_copy(host));
+            key.append(":");
+            key.append(std::to_string(port));
+            return key;
           }
 
-          void insert(const std::string &host,
+          /**
+           * \brief Looks up a host.
+           * \param host The host name.
+           * \param port The port.
+           * \returns The cached result, or \c boost::none if the host
+           *          isn't in the cache or its entry has expired.
+           */
+          boost::optional<value_type> find(const std::string &host, std::uint16_t port) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(make_key(host, port));
+            if (it == index_.end()) {
+              ++misses_;
+              return boost::none;
+            }
+
+            if (it->second->expires <= clock::now()) {
+              entries_.erase(it->second);
+              index_.erase(it);
+              ++misses_;
+              return boost::none;
+            }
+
+            // move the entry to the front of the LRU list
+            entries_.splice(entries_.begin(), entries_, it->second);
+            ++hits_;
+            return it->second->value;
+          }
+
+          /**
+           * \brief Adds resolved endpoints to the cache.
+           * \param host The host name.
+           * \param port The port.
+           * \param endpoint_iterator The resolved endpoints.
+           */
+          void insert(const std::string &host, std::uint16_t port,
                       resolver_iterator endpoint_iterator) {
-            endpoints_.insert(std::make_pair(host, endpoint_iterator));
+            insert(host, port, value_type(boost::system::error_code(), endpoint_iterator), ttl_);
+          }
+
+          /**
+           * \brief Adds resolved endpoints to the cache.
+           * \param host The host name.
+           * \param port The port.
+           * \param endpoint_iterator The resolved endpoints.
+           * \param ttl The time for which this entry is kept.
+           */
+          void insert(const std::string &host, std::uint16_t port,
+                      resolver_iterator endpoint_iterator,
+                      std::chrono::milliseconds ttl) {
+            insert(host, port, value_type(boost::system::error_code(), endpoint_iterator), ttl);
           }
 
-          iterator find(const std::string &host) {
-            return endpoints_.find(boost::to_lower_copy(host));
+          /**
+           * \brief Records that a host couldn't be resolved.
+           * \param host The host name.
+           * \param port The port.
+           * \param ec The resolver error.
+           */
+          void insert_error(const std::string &host, std::uint16_t port,
+                            const boost::system::error_code &ec) {
+            insert(host, port, value_type(ec, resolver_iterator()), negative_ttl_);
           }
 
+          /**
+           * \brief Removes all entries.
+           */
           void clear() {
-            endpoint_cache().swap(*this);
+            std::lock_guard<std::mutex> lock(mutex_);
+            index_.clear();
+            entries_.clear();
+          }
+
+          /**
+           * \brief Returns the number of entries, including those that
+           *        have expired but haven't been removed yet.
+           */
+          std::size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return entries_.size();
           }
 
-          void swap(endpoint_cache &other) noexcept {
-            endpoints_.swap(other.endpoints_);
+          /**
+           * \brief Returns the number of lookups that were found in the
+           *        cache.
+           */
+          std::uint64_t hits() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return hits_;
+          }
+
+          /**
+           * \brief Returns the number of lookups that weren't found in
+           *        the cache.
+           */
+          std::uint64_t misses() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return misses_;
           }
 
         private:
 
-          cache_type endpoints_;
+          struct entry {
+            std::string key;
+            value_type value;
+            clock::time_point expires;
+          };
+
+          void insert(const std::string &host, std::uint16_t port,
+                      value_type value, std::chrono::milliseconds ttl) {
+            if (max_entries_ == 0) {
+              return;
+            }
+
+            auto key = make_key(host, port);
+            auto expires = clock::now() + ttl;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end()) {
+              it->second->value = std::move(value);
+              it->second->expires = expires;
+              entries_.splice(entries_.begin(), entries_, it->second);
+              return;
+            }
+
+            entries_.emplace_front(entry{key, std::move(value), expires});
+            index_.insert(std::make_pair(std::move(key), entries_.begin()));
+
+            while (entries_.size() > max_entries_) {
+              index_.erase(entries_.back().key);
+              entries_.pop_back();
+            }
+          }
+
+          std::size_t max_entries_;
+          std::chrono::milliseconds ttl_;
+          std::chrono::milliseconds negative_ttl_;
+          mutable std::mutex mutex_;
+          // ordered from most to least recently used
+          std::list<entry> entries_;
+          std::unordered_map<std::string, std::list<entry>::iterator> index_;
+          std::uint64_t hits_;
+          std::uint64_t misses_;
 
         };
       } // namespace client_connection
@@ -0,0 +1,243 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_HTTP_V2_CLIENT_CONNECTION_HAPPY_EYEBALLS_CONNECTOR_INC
+#define NETWORK_HTTP_V2_CLIENT_CONNECTION_HAPPY_EYEBALLS_CONNECTOR_INC
+
+/**
+ * \file
+ * \brief
+ */
+
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/error.hpp>
+#include <network/config.hpp>
+
+namespace network {
+  namespace http {
+    namespace v2 {
+      namespace client_connection {
+        /**
+         * \class happy_eyeballs_connector network/http/v2/client/connection/happy_eyeballs_connector.hpp
+         * \brief Connects to the first of several endpoints to accept a
+         *        connection.
+         *
+         * Connection attempts are started one after another, separated
+         * by the connection attempt delay, without waiting for the
+         * previous attempts to fail (RFC 8305). An attempt that fails
+         * starts the next one immediately. The first socket to connect
+         * is handed to the callback and all other attempts are
+         * cancelled.
+         */
+        class happy_eyeballs_connector
+          : public std::enable_shared_from_this<happy_eyeballs_connector> {
+
+          happy_eyeballs_connector(const happy_eyeballs_connector &) = delete;
+          happy_eyeballs_connector &operator = (const happy_eyeballs_connector &) = delete;
+
+        public:
+
+          /**
+           * \typedef socket_ptr
+           */
+          typedef std::unique_ptr<boost::asio::ip::tcp::socket> socket_ptr;
+
+          /**
+           * \typedef connect_callback
+           */
+          typedef std::function<void (const boost::system::error_code &,
+                                      socket_ptr)> connect_callback;
+
+          /**
+           * \brief Constructor.
+           * \param io_service The I/O service.
+           * \param attempt_delay The time to wait for an attempt before
+           *        the next one is started.
+           */
+          happy_eyeballs_connector(boost::asio::io_service &io_service,
+                                   std::chrono::milliseconds attempt_delay)
+            : io_service_(io_service)
+            , strand_(io_service)
+            , timer_(io_service)
+            , attempt_delay_(attempt_delay)
+            , next_(0)
+            , pending_(0)
+            , is_done_(false) {
+
+          }
+
+          /**
+           * \brief Destructor.
+           */
+          ~happy_eyeballs_connector() noexcept {
+
+          }
+
+          /**
+           * \brief Orders endpoints so that IPv6 and IPv4 addresses
+           *        alternate, starting with the family of the first.
+           */
+          static std::vector<boost::asio::ip::tcp::endpoint>
+          interleave(const std::vector<boost::asio::ip::tcp::endpoint> &endpoints) {
+            std::vector<boost::asio::ip::tcp::endpoint> first_family, other_family;
+            for (const auto &endpoint : endpoints) {
+              if (endpoint.address().is_v6() == endpoints.front().address().is_v6()) {
+                first_family.push_back(endpoint);
+              }
+              else {
+                other_family.push_back(endpoint);
+              }
+            }
+
+            std::vector<boost::asio::ip::tcp::endpoint> interleaved;
+            interleaved.reserve(endpoints.size());
+            for (std::size_t i = 0; i < std::max(first_family.size(), other_family.size()); ++i) {
+              if (i < first_family.size()) {
+                interleaved.push_back(first_family[i]);
+              }
+              if (i < other_family.size()) {
+                interleaved.push_back(other_family[i]);
+              }
+            }
+            return interleaved;
+          }
+
+          /**
+           * \brief Starts connecting to the endpoints.
+           * \param endpoints The endpoints, in the order in which they
+           *        are tried.
+           * \param callback Called once, with the connected socket or
+           *        with the error of the last attempt to fail.
+           */
+          void async_connect(std::vector<boost::asio::ip::tcp::endpoint> endpoints,
+                             connect_callback callback) {
+            auto self = shared_from_this();
+            strand_.post([=] () {
+                if (self->is_done_) {
+                  callback(boost::asio::error::operation_aborted, socket_ptr());
+                  return;
+                }
+
+                self->endpoints_ = endpoints;
+                self->callback_ = callback;
+                if (self->endpoints_.empty()) {
+                  self->finish(boost::asio::error::host_not_found, socket_ptr());
+                  return;
+                }
+                self->start_next();
+              });
+          }
+
+          /**
+           * \brief Cancels all connection attempts. The callback is
+           *        called with \c operation_aborted if no attempt has
+           *        succeeded yet.
+           */
+          void cancel() {
+            auto self = shared_from_this();
+            strand_.post([=] () {
+                self->finish(boost::asio::error::operation_aborted, socket_ptr());
+              });
+          }
+
+        private:
+
+          void start_next() {
+            auto attempt = next_++;
+            sockets_.emplace_back(new boost::asio::ip::tcp::socket(io_service_));
+            ++pending_;
+            auto self = shared_from_this();
+            sockets_.back()->async_connect(endpoints_[attempt],
+                                           strand_.wrap(
+                                             [=] (const boost::system::error_code &ec) {
+                                               self->handle_connect(ec, attempt);
+                                             }));
+
+            if (next_ < endpoints_.size()) {
+              timer_.expires_from_now(attempt_delay_);
+              timer_.async_wait(strand_.wrap(
+                                  [=] (const boost::system::error_code &ec) {
+                                    self->handle_attempt_delay(ec, attempt);
+                                  }));
+            }
+          }
+
+          void handle_attempt_delay(const boost::system::error_code &ec, std::size_t attempt) {
+            // the next attempt may already have been started because
+            // this one failed
+            if (is_done_ || ec || (next_ != attempt + 1) || (next_ == endpoints_.size())) {
+              return;
+            }
+            start_next();
+          }
+
+          void handle_connect(const boost::system::error_code &ec, std::size_t attempt) {
+            --pending_;
+            if (is_done_) {
+              return;
+            }
+
+            if (!ec) {
+              finish(ec, std::move(sockets_[attempt]));
+              return;
+            }
+
+            boost::system::error_code ignore;
+            sockets_[attempt]->close(ignore);
+            if (next_ < endpoints_.size()) {
+              timer_.cancel(ignore);
+              start_next();
+            }
+            else if (pending_ == 0) {
+              finish(ec, socket_ptr());
+            }
+          }
+
+          void finish(const boost::system::error_code &ec, socket_ptr socket) {
+            if (is_done_) {
+              return;
+            }
+            is_done_ = true;
+
+            boost::system::error_code ignore;
+            timer_.cancel(ignore);
+            for (auto &attempt : sockets_) {
+              if (attempt) {
+                attempt->close(ignore);
+              }
+            }
+
+            auto callback = std::move(callback_);
+            if (callback) {
+              callback(ec, std::move(socket));
+            }
+          }
+
+          boost::asio::io_service &io_service_;
+          boost::asio::io_service::strand strand_;
+          boost::asio::steady_timer timer_;
+          std::chrono::milliseconds attempt_delay_;
+          std::vector<boost::asio::ip::tcp::endpoint> endpoints_;
+          std::vector<socket_ptr> sockets_;
+          connect_callback callback_;
+          std::size_t next_;
+          std::size_t pending_;
+          bool is_done_;
+
+        };
+      } // namespace client_connection
+    } // namespace v2
+  } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_V2_CLIENT_CONNECTION_HAPPY_EYEBALLS_CONNECTOR_INC
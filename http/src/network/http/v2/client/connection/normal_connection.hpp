@@ -11,6 +11,8 @@
  * \brief
  */
 
+#include <memory>
+#include <mutex>
 #include <boost/asio/write.hpp>
 #include <boost/asio/read.hpp>
 #include <boost/asio/read_until.hpp>
@@ -18,6 +20,7 @@
 #include <boost/asio/io_service.hpp>
 #include <network/config.hpp>
 #include <network/http/v2/client/connection/async_connection.hpp>
+#include <network/http/v2/client/connection/happy_eyeballs_connector.hpp>
 
 namespace network {
   namespace http {
@@ -30,8 +33,11 @@ namespace network {
 
         public:
 
-          explicit normal_connection(boost::asio::io_service &io_service)
-            : io_service_(io_service) {
+          explicit normal_connection(boost::asio::io_service &io_service,
+                                     std::chrono::milliseconds connection_attempt_delay =
+                                       std::chrono::milliseconds(250))
+            : io_service_(io_service)
+            , connection_attempt_delay_(connection_attempt_delay) {
 
           }
 
@@ -46,11 +52,34 @@ namespace network {
             socket_->async_connect(endpoint, callback);
           }
 
+          virtual void async_connect(const std::vector<boost::asio::ip::tcp::endpoint> &endpoints,
+                                     connect_callback callback) {
+            connector_ = std::make_shared<happy_eyeballs_connector>(io_service_,
+                                                                    connection_attempt_delay_);
+            connector_->async_connect(happy_eyeballs_connector::interleave(endpoints),
+                                      [this, callback] (const boost::system::error_code &ec,
+                                                        happy_eyeballs_connector::socket_ptr socket) {
+                                        {
+                                          // the connection may be closed concurrently
+                                          std::lock_guard<std::mutex> lock(mutex_);
+                                          if (connector_) {
+                                            socket_ = std::move(socket);
+                                          }
+                                        }
+                                        callback(ec);
+                                      });
+          }
+
           virtual void async_write(boost::asio::streambuf &command_streambuf,
                                    write_callback callback) {
             boost::asio::async_write(*socket_, command_streambuf, callback);
           }
 
+          virtual void async_write(const std::vector<boost::asio::const_buffer> &buffers,
+                                   write_callback callback) {
+            boost::asio::async_write(*socket_, buffers, callback);
+          }
+
           virtual void async_read_until(boost::asio::streambuf &command_streambuf,
                                         const std::string &delim,
                                         read_callback callback) {
@@ -67,9 +96,30 @@ namespace network {
             socket_->cancel();
           }
 
+          virtual bool is_open() const {
+            return socket_ && socket_->is_open();
+          }
+
+          virtual void close() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (connector_) {
+              connector_->cancel();
+              connector_.reset();
+            }
+
+            if (socket_) {
+              boost::system::error_code ignore;
+              socket_->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore);
+              socket_->close(ignore);
+            }
+          }
+
         private:
 
           boost::asio::io_service &io_service_;
+          std::chrono::milliseconds connection_attempt_delay_;
+          std::mutex mutex_;
+          std::shared_ptr<happy_eyeballs_connector> connector_;
           std::unique_ptr<boost::asio::ip::tcp::socket> socket_;
 
         };
@@ -0,0 +1,207 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_HTTP_V2_CLIENT_CONNECTION_SSL_CLIENT_CONTEXT_INC
+#define NETWORK_HTTP_V2_CLIENT_CONNECTION_SSL_CLIENT_CONTEXT_INC
+
+/**
+ * \file
+ * \brief A TLS context shared by the connections of a client.
+ */
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio/ssl.hpp>
+#include <network/config.hpp>
+
+namespace network {
+  namespace http {
+    namespace v2 {
+      namespace client_connection {
+        /**
+         * \class ssl_client_context network/http/v2/client/connection/ssl_client_context.hpp
+         * \brief The TLS state shared by the connections of a client.
+         *
+         * The SSL context is built once, rather than for each connection,
+         * and the last session of each host is kept so that later
+         * connections to the host resume it instead of performing a full
+         * handshake. Connections offer \c http/1.1 with ALPN.
+         */
+        class ssl_client_context {
+
+          ssl_client_context(const ssl_client_context &) = delete;
+          ssl_client_context &operator = (const ssl_client_context &) = delete;
+
+          typedef std::list<std::pair<std::string, SSL_SESSION *>> session_list;
+
+        public:
+
+          /**
+           * \brief Constructor.
+           * \param certificate_paths Files of certificates to verify
+           *        servers with.
+           * \param verify_paths Directories of certificates to verify
+           *        servers with.
+           * \param max_sessions The maximum number of hosts whose
+           *        session is kept.
+           *
+           * Servers are only verified if there are certificate or verify
+           * paths.
+           */
+          ssl_client_context(const std::vector<std::string> &certificate_paths,
+                             const std::vector<std::string> &verify_paths,
+                             std::size_t max_sessions = 256)
+            : context_(boost::asio::ssl::context::sslv23)
+            , verify_peer_(!certificate_paths.empty() || !verify_paths.empty())
+            , max_sessions_(max_sessions) {
+            if (verify_peer_) {
+              for (const auto &path : certificate_paths) {
+                context_.load_verify_file(path);
+              }
+              for (const auto &path : verify_paths) {
+                context_.add_verify_path(path);
+              }
+              context_.set_verify_mode(boost::asio::ssl::context::verify_peer);
+            }
+            else {
+              context_.set_default_verify_paths();
+              context_.set_verify_mode(boost::asio::ssl::context::verify_none);
+            }
+
+            auto ctx = context_.native_handle();
+
+            // OpenSSL doesn't look sessions up for clients, it only hands
+            // them to new_session; TLS 1.3 servers send them after the
+            // handshake
+            SSL_CTX_set_ex_data(ctx, context_index(), this);
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                                SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(ctx, &ssl_client_context::new_session);
+
+            // the client only speaks HTTP/1.1
+            static const unsigned char protocols[] = "\x08http/1.1";
+            SSL_CTX_set_alpn_protos(ctx, protocols, sizeof(protocols) - 1);
+          }
+
+          /**
+           * \brief Destructor.
+           */
+          ~ssl_client_context() noexcept {
+            for (auto &session : sessions_) {
+              SSL_SESSION_free(session.second);
+            }
+          }
+
+          /**
+           * \brief Returns the SSL context.
+           */
+          boost::asio::ssl::context &context() {
+            return context_;
+          }
+
+          /**
+           * \brief Tests if servers are verified.
+           */
+          bool verify_peer() const {
+            return verify_peer_;
+          }
+
+          /**
+           * \brief Offers the last session of a host on a connection, and
+           *        keeps the sessions the server hands out on it.
+           * \param ssl The connection, before its handshake.
+           * \param key The host and port, which must outlive \c ssl.
+           */
+          void resume(SSL *ssl, const std::string &key) {
+            SSL_set_ex_data(ssl, key_index(), const_cast<std::string *>(&key));
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto &session : sessions_) {
+              if (session.first == key) {
+                SSL_set_session(ssl, session.second);
+                return;
+              }
+            }
+          }
+
+          /**
+           * \brief Drops the session of a host, after a failed handshake.
+           * \param key The host and port.
+           */
+          void forget(const std::string &key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            erase(key);
+          }
+
+          /**
+           * \brief Returns the number of hosts whose session is kept.
+           */
+          std::size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return sessions_.size();
+          }
+
+        private:
+
+          static int context_index() {
+            static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+            return index;
+          }
+
+          static int key_index() {
+            static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+            return index;
+          }
+
+          static int new_session(SSL *ssl, SSL_SESSION *session) {
+            auto self = static_cast<ssl_client_context *>(
+              SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+            auto key = static_cast<std::string *>(SSL_get_ex_data(ssl, key_index()));
+            if (!self || !key) {
+              return 0;
+            }
+
+            // the session's reference now belongs to the context
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            self->erase(*key);
+            if (self->max_sessions_ == 0) {
+              return 0;
+            }
+            if (self->sessions_.size() >= self->max_sessions_) {
+              SSL_SESSION_free(self->sessions_.back().second);
+              self->sessions_.pop_back();
+            }
+            self->sessions_.emplace_front(*key, session);
+            return 1;
+          }
+
+          void erase(const std::string &key) {
+            for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+              if (it->first == key) {
+                SSL_SESSION_free(it->second);
+                sessions_.erase(it);
+                return;
+              }
+            }
+          }
+
+          boost::asio::ssl::context context_;
+          bool verify_peer_;
+          std::size_t max_sessions_;
+          mutable std::mutex mutex_;
+
+          // the most recently stored sessions are at the front
+          session_list sessions_;
+
+        };
+      } // namespace client_connection
+    } // namespace v2
+  } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_V2_CLIENT_CONNECTION_SSL_CLIENT_CONTEXT_INC
@@ -11,66 +11,109 @@
  * \brief
  */
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
+#include <boost/asio/write.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ssl.hpp>
-#include <boost/asio/placeholders.hpp>
 #include <network/config.hpp>
-#include <network/http/v2/client/connection/connection.hpp>
-#include <network/http/v2/client/client.hpp>
+#include <network/http/v2/client/connection/async_connection.hpp>
+#include <network/http/v2/client/connection/happy_eyeballs_connector.hpp>
+#include <network/http/v2/client/connection/ssl_client_context.hpp>
 
 namespace network {
   namespace http {
     namespace v2 {
       namespace client_connection {
-        class ssl_connection
-          : public connection, std::enable_shared_from_this<ssl_connection> {
+        /**
+         * \class ssl_connection network/http/v2/client/connection/ssl_connection.hpp
+         * \brief A connection over TLS.
+         *
+         * The handshake is performed as part of connecting, resuming the
+         * last session with the same host if the client context has one.
+         */
+        class ssl_connection : public async_connection {
 
           ssl_connection(const ssl_connection &) = delete;
           ssl_connection &operator = (const ssl_connection &) = delete;
 
+          typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> stream_type;
+
         public:
 
-          ssl_connection(boost::asio::io_service &io_service, const client_options &options)
+          /**
+           * \brief Constructor.
+           * \param io_service The I/O service.
+           * \param context The TLS state shared by the client's
+           *        connections.
+           * \param host The host name, which is sent to the server and
+           *        which its certificate is verified against.
+           * \param port The port, which together with the host
+           *        identifies the session to resume.
+           * \param connection_attempt_delay The time to wait for a
+           *        connection attempt before the next one is started.
+           */
+          ssl_connection(boost::asio::io_service &io_service,
+                         std::shared_ptr<ssl_client_context> context,
+                         std::string host,
+                         std::uint16_t port,
+                         std::chrono::milliseconds connection_attempt_delay =
+                           std::chrono::milliseconds(250))
             : io_service_(io_service)
-            , options_(options) {
+            , context_(std::move(context))
+            , host_(std::move(host))
+            , key_(host_ + ":" + std::to_string(port))
+            , connection_attempt_delay_(connection_attempt_delay) {
 
           }
 
           virtual ~ssl_connection() noexcept {
-
+            // keeps the session resumable without a close_notify
+            if (socket_) {
+              SSL_set_shutdown(socket_->native_handle(), SSL_SENT_SHUTDOWN);
+            }
           }
 
           virtual void async_connect(const boost::asio::ip::tcp::endpoint &endpoint,
                                      connect_callback callback) {
-            context_.reset(new boost::asio::ssl::context(boost::asio::ssl::context::sslv23));
-            std::vector<std::string> const& certificate_paths =
-              options_.openssl_certificate_paths();
-            std::vector<std::string> const& verifier_paths =
-              options_.openssl_verify_paths();
-            bool use_default_verification = certificate_paths.empty() && verifier_paths.empty();
-            if (!use_default_verification) {
-              for (auto path : certificate_paths) {
-                context_->load_verify_file(path);
-              }
-              for (auto path : verifier_paths) {
-                context_->add_verify_path(path);
-              }
-              context_->set_verify_mode(boost::asio::ssl::context::verify_peer);
-              //context_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
-            }
-            else {
-              context_->set_default_verify_paths();
-              context_->set_verify_mode(boost::asio::ssl::context::verify_none);
-            }
-            socket_.reset(new boost::asio::ssl::stream<
-                            boost::asio::ip::tcp::socket>(io_service_, *context_));
+            init_socket();
+            socket_->lowest_layer().async_connect(endpoint,
+                                                  [this, callback] (const boost::system::error_code &ec) {
+                                                    handshake(ec, callback);
+                                                  });
+          }
 
-            using namespace std::placeholders;
-            socket_->lowest_layer()
-              .async_connect(endpoint, callback);
+          virtual void async_connect(const std::vector<boost::asio::ip::tcp::endpoint> &endpoints,
+                                     connect_callback callback) {
+            init_socket();
+            connector_ = std::make_shared<happy_eyeballs_connector>(io_service_,
+                                                                    connection_attempt_delay_);
+            connector_->async_connect(happy_eyeballs_connector::interleave(endpoints),
+                                      [this, callback] (const boost::system::error_code &ec,
+                                                        happy_eyeballs_connector::socket_ptr socket) {
+                                        bool is_closed = false;
+                                        {
+                                          // the connection may be closed concurrently
+                                          std::lock_guard<std::mutex> lock(mutex_);
+                                          is_closed = !connector_;
+                                          if (!is_closed && socket) {
+                                            // the handshake is performed over the socket that won
+                                            socket_->next_layer() = std::move(*socket);
+                                          }
+                                        }
+                                        if (is_closed && !ec) {
+                                          callback(boost::asio::error::operation_aborted);
+                                          return;
+                                        }
+                                        handshake(ec, callback);
+                                      });
           }
 
           virtual void async_write(boost::asio::streambuf &command_streambuf,
@@ -78,22 +121,128 @@ namespace network {
             boost::asio::async_write(*socket_, command_streambuf, callback);
           }
 
-          virtual void async_read_some(const boost::asio::mutable_buffers_1 &read_buffer,
-                                       read_callback callback) {
-            socket_->async_read_some(read_buffer, callback);
+          virtual void async_write(const std::vector<boost::asio::const_buffer> &buffers,
+                                   write_callback callback) {
+            boost::asio::async_write(*socket_, buffers, callback);
+          }
+
+          virtual void async_read_until(boost::asio::streambuf &command_streambuf,
+                                        const std::string &delim,
+                                        read_callback callback) {
+            boost::asio::async_read_until(*socket_, command_streambuf, delim,
+                                          [callback] (const boost::system::error_code &ec,
+                                                      std::size_t bytes_read) {
+                                            callback(translate(ec), bytes_read);
+                                          });
+          }
+
+          virtual void async_read(boost::asio::streambuf &command_streambuf,
+                                  read_callback callback) {
+            boost::asio::async_read(*socket_, command_streambuf,
+                                    boost::asio::transfer_at_least(1),
+                                    [callback] (const boost::system::error_code &ec,
+                                                std::size_t bytes_read) {
+                                      callback(translate(ec), bytes_read);
+                                    });
           }
 
           virtual void cancel() {
-            //socket_->cancel();
+            socket_->lowest_layer().cancel();
+          }
+
+          virtual bool is_open() const {
+            return socket_ && socket_->lowest_layer().is_open();
+          }
+
+          virtual void close() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (connector_) {
+              connector_->cancel();
+              connector_.reset();
+            }
+
+            if (socket_) {
+              boost::system::error_code ignore;
+              socket_->lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore);
+              socket_->lowest_layer().close(ignore);
+            }
+          }
+
+          /**
+           * \brief Returns the protocol agreed on with ALPN.
+           * \returns The protocol, or an empty string if the server
+           *          didn't pick one.
+           */
+          std::string negotiated_protocol() const {
+            if (!socket_) {
+              return std::string();
+            }
+            const unsigned char *protocol = nullptr;
+            unsigned int length = 0;
+            SSL_get0_alpn_selected(socket_->native_handle(), &protocol, &length);
+            return std::string(reinterpret_cast<const char *>(protocol), length);
+          }
+
+          /**
+           * \brief Tests if the handshake resumed an earlier session.
+           */
+          bool is_resumed() const {
+            return socket_ && SSL_session_reused(socket_->native_handle());
           }
 
         private:
 
+          void init_socket() {
+            socket_.reset(new stream_type(io_service_, context_->context()));
+            auto ssl = socket_->native_handle();
+
+            // server names are sent, addresses aren't
+            boost::system::error_code is_name;
+            boost::asio::ip::address::from_string(host_, is_name);
+            if (is_name) {
+              SSL_set_tlsext_host_name(ssl, host_.c_str());
+            }
+            if (context_->verify_peer()) {
+              socket_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host_));
+            }
+            context_->resume(ssl, key_);
+          }
+
+          void handshake(const boost::system::error_code &ec, connect_callback callback) {
+            if (ec) {
+              callback(ec);
+              return;
+            }
+
+            // no Nagle delay between the handshake and the request
+            boost::system::error_code ignore;
+            socket_->lowest_layer().set_option(boost::asio::ip::tcp::no_delay(true), ignore);
+            socket_->async_handshake(boost::asio::ssl::stream_base::client,
+                                     [this, callback] (const boost::system::error_code &ec) {
+                                       if (ec) {
+                                         context_->forget(key_);
+                                       }
+                                       callback(ec);
+                                     });
+          }
+
+          static boost::system::error_code translate(const boost::system::error_code &ec) {
+            // servers often close the connection without a close_notify,
+            // which ends a response the same way as for a plain connection
+            if (ec == boost::asio::ssl::error::stream_truncated) {
+              return boost::asio::error::eof;
+            }
+            return ec;
+          }
+
           boost::asio::io_service &io_service_;
-          client_options options_;
-          std::unique_ptr<boost::asio::ssl::context> context_;
-          std::unique_ptr<
-            boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> socket_;
+          std::shared_ptr<ssl_client_context> context_;
+          std::string host_;
+          std::string key_;
+          std::chrono::milliseconds connection_attempt_delay_;
+          std::mutex mutex_;
+          std::shared_ptr<happy_eyeballs_connector> connector_;
+          std::unique_ptr<stream_type> socket_;
 
         };
       } // namespace client_connection
@@ -16,6 +16,10 @@
 #include <stdexcept>
 #include <cstdint>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/exception/all.hpp>
@@ -44,10 +48,17 @@ namespace network {
 
           /**
            * \brief Constructor.
+           * \param service The I/O service.
+           * \param cache_resolved If \c true, resolved hosts are cached.
+           * \param max_entries The maximum number of cached hosts.
+           * \param ttl The time for which a resolved host is cached.
            */
-          tcp_resolver(boost::asio::io_service &service, bool cache_resolved = false)
+          tcp_resolver(boost::asio::io_service &service, bool cache_resolved = false,
+                       std::size_t max_entries = 1024,
+                       std::chrono::milliseconds ttl = std::chrono::milliseconds(300000))
             : resolver_(service)
-            , cache_resolved_(cache_resolved) {
+            , cache_resolved_(cache_resolved)
+            , endpoint_cache_(max_entries, ttl) {
 
           }
 
@@ -61,26 +72,46 @@ namespace network {
           virtual void async_resolve(const std::string &host, std::uint16_t port,
                                      resolve_callback handler) {
             if (cache_resolved_) {
-              auto it = endpoint_cache_.find(host);
-              if (it != endpoint_cache_.end()) {
-                boost::system::error_code ec;
-                handler(ec, it->second);
+              if (auto cached = endpoint_cache_.find(host, port)) {
+                handler(cached->first, cached->second);
                 return;
               }
             }
 
+            // concurrent lookups of the same host share a single query
+            auto key = endpoint_cache::make_key(host, port);
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto &handlers = pending_[key];
+            handlers.push_back(handler);
+            if (handlers.size() > 1) {
+              return;
+            }
+
             resolver::query query(host, std::to_string(port));
             resolver_.async_resolve(query,
-                                    [host, handler, this](const boost::system::error_code &ec,
-                                                          resolver_iterator endpoint_iterator) {
-                                      if (ec) {
-                                        handler(ec, resolver_iterator());
+                                    [host, port, key, this](const boost::system::error_code &ec,
+                                                            resolver_iterator endpoint_iterator) {
+                                      if (cache_resolved_ && (ec != boost::asio::error::operation_aborted)) {
+                                        if (ec) {
+                                          endpoint_cache_.insert_error(host, port, ec);
+                                        }
+                                        else {
+                                          endpoint_cache_.insert(host, port, endpoint_iterator);
+                                        }
                                       }
-                                      else {
-                                        if (cache_resolved_) {
-                                          endpoint_cache_.insert(host, endpoint_iterator);
+
+                                      std::vector<resolve_callback> handlers;
+                                      {
+                                        std::lock_guard<std::mutex> lock(mutex_);
+                                        auto it = pending_.find(key);
+                                        if (it != pending_.end()) {
+                                          handlers.swap(it->second);
+                                          pending_.erase(it);
                                         }
-                                        handler(ec, endpoint_iterator);
+                                      }
+
+                                      for (auto &handler : handlers) {
+                                        handler(ec, ec? resolver_iterator() : endpoint_iterator);
                                       }
                                     });
           }
@@ -89,11 +120,22 @@ namespace network {
             endpoint_cache_.clear();
           }
 
+          /**
+           * \brief Gets the cache of resolved hosts.
+           */
+          const endpoint_cache &resolved_cache() const {
+            return endpoint_cache_;
+          }
+
         private:
 
           resolver resolver_;
           bool cache_resolved_;
           endpoint_cache endpoint_cache_;
+          // guards the resolver and the pending lookups, which are
+          // shared by requests on different threads
+          std::mutex mutex_;
+          std::unordered_map<std::string, std::vector<resolve_callback>> pending_;
 
         };
       } // namespace client_connection
@@ -0,0 +1,133 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_HTTP_V2_CLIENT_FILE_BYTE_SOURCE_INC
+#define NETWORK_HTTP_V2_CLIENT_FILE_BYTE_SOURCE_INC
+
+/**
+ * \file
+ * \brief Contains a byte source that reads a request body from a
+ *        file.
+ */
+
+#include <string>
+#include <algorithm>
+#include <system_error>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <network/config.hpp>
+#include <network/http/v2/client/request.hpp>
+
+namespace network {
+  namespace http {
+    namespace v2 {
+      namespace client_message {
+        /**
+         * \ingroup http_client
+         * \class file_byte_source network/http/v2/client/file_byte_source.hpp
+         * \brief A byte source that maps a file into memory.
+         *
+         * The file is sent directly from the mapped pages, so that
+         * large files can be uploaded without being copied into a
+         * string first. The file must not be truncated while the
+         * request is in flight: reading pages past its new end raises
+         * SIGBUS.
+         */
+        class file_byte_source : public byte_source {
+
+          file_byte_source(const file_byte_source &) = delete;
+          file_byte_source &operator = (const file_byte_source &) = delete;
+
+        public:
+
+          /**
+           * \brief Constructor.
+           * \param path The path of the file.
+           * \throws std::system_error if the file can't be opened or
+           *         mapped, or isn't a regular file.
+           */
+          explicit file_byte_source(const std::string &path)
+            : data_(nullptr), size_(0), position_(0) {
+            // opening a FIFO for reading would block until it has a
+            // writer
+            int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+            if (fd == -1) {
+              throw std::system_error(errno, std::system_category());
+            }
+
+            struct stat status;
+            if (::fstat(fd, &status) == -1) {
+              int error = errno;
+              ::close(fd);
+              throw std::system_error(error, std::system_category());
+            }
+
+            // only a regular file has a size that says how much there
+            // is to send
+            if (!S_ISREG(status.st_mode)) {
+              ::close(fd);
+              throw std::system_error(EINVAL, std::system_category());
+            }
+
+            size_ = static_cast<size_type>(status.st_size);
+            if (size_ != 0) {
+              void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+              if (data == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::system_category());
+              }
+              ::madvise(data, size_, MADV_SEQUENTIAL);
+              data_ = static_cast<const char *>(data);
+            }
+
+            // the mapping stays valid after the file is closed
+            ::close(fd);
+          }
+
+          /**
+           * \brief Destructor.
+           */
+          virtual ~file_byte_source() noexcept {
+            if (data_) {
+              ::munmap(const_cast<char *>(data_), size_);
+            }
+          }
+
+          virtual size_type read(string_type &source, size_type length) {
+            const char *data = nullptr;
+            auto bytes_read = read_in_place(data, length);
+            source.append(data, bytes_read);
+            return bytes_read;
+          }
+
+          virtual size_type read_in_place(const char *&data, size_type length) {
+            auto bytes_read = std::min(length, size_ - position_);
+            data = data_ + position_;
+            position_ += bytes_read;
+            return bytes_read;
+          }
+
+          virtual boost::optional<size_type> size() const {
+            return size_ - position_;
+          }
+
+        private:
+
+          const char *data_;
+          size_type size_;
+          size_type position_;
+
+        };
+      } // namespace client_message
+    } // namespace v2
+  } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_V2_CLIENT_FILE_BYTE_SOURCE_INC
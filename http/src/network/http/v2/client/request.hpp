@@ -22,9 +22,11 @@
 #include <algorithm>
 #include <sstream>
 #include <iterator>
+#include <functional>
 #include <boost/range/iterator_range.hpp>
 #include <boost/range/algorithm/equal.hpp>
 #include <boost/range/as_literal.hpp>
+#include <boost/optional.hpp>
 #include <network/config.hpp>
 #include <network/http/v2/method.hpp>
 #include <network/http/v2/client/client_errors.hpp>
@@ -43,6 +45,13 @@ namespace network {
 
         public:
 
+          /**
+           * \typedef body_handler_type
+           * \brief The type of the function that receives the response
+           *        body as it arrives.
+           */
+          typedef std::function<void (const char *, std::size_t)> body_handler_type;
+
           /**
            * \brief Constructor.
            */
@@ -82,31 +91,64 @@ namespace network {
             swap(resolve_timeout_, other.resolve_timeout_);
             swap(read_timeout_, other.read_timeout_);
             swap(total_timeout_, other.total_timeout_);
+            swap(max_redirects_, other.max_redirects_);
+            swap(body_handler_, other.body_handler_);
           }
 
+          /**
+           * \brief Sets the time allowed to resolve the host name.
+           * \param resolve_timeout The timeout in milliseconds, or \c 0 for no
+           *        timeout.
+           * \returns \c *this
+           */
           request_options &resolve_timeout(std::uint64_t resolve_timeout) {
             resolve_timeout_ = resolve_timeout;
             return *this;
           }
 
+          /**
+           * \brief Gets the resolve timeout.
+           * \returns The timeout in milliseconds.
+           */
           std::uint64_t resolve_timeout() const {
             return resolve_timeout_;
           }
 
+          /**
+           * \brief Sets the time allowed for each write to, or read from,
+           *        the connection.
+           * \param read_timeout The timeout in milliseconds, or \c 0 for no
+           *        timeout.
+           * \returns \c *this
+           */
           request_options &read_timeout(std::uint64_t read_timeout) {
             read_timeout_ = read_timeout;
             return *this;
           }
 
+          /**
+           * \brief Gets the read timeout.
+           * \returns The timeout in milliseconds.
+           */
           std::uint64_t read_timeout() const {
             return read_timeout_;
           }
 
+          /**
+           * \brief Sets the time allowed for the whole request.
+           * \param total_timeout The timeout in milliseconds, or \c 0 for no
+           *        timeout.
+           * \returns \c *this
+           */
           request_options &total_timeout(std::uint64_t total_timeout) {
             total_timeout_ = total_timeout;
             return *this;
           }
 
+          /**
+           * \brief Gets the total timeout.
+           * \returns The timeout in milliseconds.
+           */
           std::uint64_t total_timeout() const {
             return total_timeout_;
           }
@@ -120,12 +162,41 @@ namespace network {
             return max_redirects_;
           }
 
+          /**
+           * \brief Streams the response body to a function instead of
+           *        storing it in the response.
+           *
+           * The function is called with each piece of the body as soon
+           * as it has been read from the connection, and the next read
+           * is only started once it has returned, so a slow consumer
+           * limits the rate at which the body is received. The data
+           * is only valid for the duration of the call. If the
+           * function throws, the request fails with that exception.
+           *
+           * \param body_handler The function that receives the body.
+           * \returns \c *this
+           */
+          request_options &body_handler(body_handler_type body_handler) {
+            body_handler_ = body_handler;
+            return *this;
+          }
+
+          /**
+           * \brief Gets the function that receives the response body.
+           * \returns The body handler, which is empty if the body is
+           *          stored in the response.
+           */
+          body_handler_type body_handler() const {
+            return body_handler_;
+          }
+
         private:
 
           std::uint64_t resolve_timeout_;
           std::uint64_t read_timeout_;
           std::uint64_t total_timeout_;
           int max_redirects_;
+          body_handler_type body_handler_;
 
         };
 
@@ -164,9 +235,47 @@ namespace network {
           /**
            * \brief Allows the request to read the data into a local
            *        copy of it's source string.
+           * \param source The string to which up to \c length bytes
+           *        are appended.
+           * \param length The maximum number of bytes to read.
+           * \returns The number of bytes read, or \c 0 at the end of
+           *          the source.
            */
           virtual size_type read(string_type &source, size_type length) = 0;
 
+          /**
+           * \brief Reads data without copying it into a string owned by
+           *        the caller.
+           * \param data Set to the start of the data, which remains
+           *        valid until the next read.
+           * \param length The maximum number of bytes to read.
+           * \returns The number of bytes read, or \c 0 at the end of
+           *          the source.
+           *
+           * The default implementation reads into a buffer owned by
+           * the byte source. Sources that already hold their data in
+           * memory should return a pointer to it instead.
+           */
+          virtual size_type read_in_place(const char *&data, size_type length) {
+            buffer_.clear();
+            auto bytes_read = read(buffer_, length);
+            data = buffer_.data();
+            return bytes_read;
+          }
+
+          /**
+           * \brief Gets the number of bytes that remain to be read.
+           * \returns The number of bytes, or \c boost::none if it isn't
+           *          known in advance.
+           */
+          virtual boost::optional<size_type> size() const {
+            return boost::none;
+          }
+
+        private:
+
+          string_type buffer_;
+
         };
 
         /**
@@ -181,18 +290,36 @@ namespace network {
           /**
            * \brief Constructor.
            */
-          explicit string_byte_source(string_type source);
+          explicit string_byte_source(string_type source)
+            : source_(std::move(source)), position_(0) { }
 
           /**
            * \brief Destructor.
            */
-          virtual ~string_byte_source() {}
+          virtual ~string_byte_source() noexcept {}
 
-          virtual size_type read(string_type &source, size_type length);
+          virtual size_type read(string_type &source, size_type length) {
+            const char *data = nullptr;
+            auto bytes_read = read_in_place(data, length);
+            source.append(data, bytes_read);
+            return bytes_read;
+          }
+
+          virtual size_type read_in_place(const char *&data, size_type length) {
+            auto bytes_read = std::min(length, source_.size() - position_);
+            data = source_.data() + position_;
+            position_ += bytes_read;
+            return bytes_read;
+          }
+
+          virtual boost::optional<size_type> size() const {
+            return source_.size() - position_;
+          }
 
         private:
 
           string_type source_;
+          size_type position_;
 
         };
 
@@ -378,11 +505,30 @@ namespace network {
             return version_;
           }
 
+          /**
+           * \brief Sets the request body.
+           * \param byte_source The source from which the body is read
+           *        while the request is sent.
+           * \returns *this
+           *
+           * If the size of the source is known, a Content-Length header
+           * is sent with the request, otherwise the body is sent using
+           * chunked transfer coding.
+           */
           request &body(std::shared_ptr<byte_source> byte_source) {
             byte_source_ = byte_source;
             return *this;
           }
 
+          /**
+           * \brief Gets the request body.
+           * \returns The byte source, or \c nullptr if the request has
+           *          no body.
+           */
+          std::shared_ptr<byte_source> body() const {
+            return byte_source_;
+          }
+
           /**
            * \brief Appends a header to the request.
            * \param name The header name.
@@ -180,8 +180,7 @@ namespace network {
           }
 
           void append_body(const char *body, std::size_t length) {
-            body_.reserve(body_.size() + length);
-            body_.append(body);
+            body_.append(body, length);
           }
 
           void append_body(string_type body) {
@@ -10,6 +10,7 @@
 #define NETWORK_HTTP_V2_CLIENT_RESPONSE_PARSER_INC
 
 #include <utility>
+#include <tuple>
 #include <boost/range.hpp>
 #include <boost/logic/tribool.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -221,7 +222,11 @@ namespace network {
                 }
                 break;
               case http_header_colon:
-                if (boost::algorithm::is_space()(*current)) {
+                if (*current == '\r') {
+                  // the header value is empty
+                  state_ = http_header_line_cr;
+                  ++current;
+                } else if (boost::algorithm::is_space()(*current)) {
                   ++current;
                 } else if (boost::algorithm::is_alnum()(*current) ||
                            boost::algorithm::is_punct()(*current)) {
@@ -25,6 +25,9 @@ struct client_base {
   typedef std::function<
       void(boost::iterator_range<char const*> const&,
            boost::system::error_code const&)> body_callback_function_type;
+  typedef std::function<
+      void(boost::system::error_code const&,
+           response const&)> response_callback_function_type;
 
   client_base();
   explicit client_base(client_options const& options);
@@ -34,6 +37,14 @@ struct client_base {
                                   bool get_body,
                                   body_callback_function_type callback,
                                   request_options const& options);
+  // Sends the request and returns right away; the callback is called on the
+  // client's io_service once the whole response has been read, or the
+  // request has failed.
+  void async_request_skeleton(request const& request_,
+                              std::string const& method,
+                              bool get_body,
+                              response_callback_function_type callback,
+                              request_options const& options);
   void clear_resolved_cache();
  private:
   client_base_pimpl* pimpl;
@@ -16,6 +16,10 @@
 #include <network/protocol/http/client/connection_manager.hpp>
 #include <network/protocol/http/client/simple_connection_manager.hpp>
 #include <network/protocol/http/request.hpp>
+#include <network/protocol/http/response.hpp>
+#include <network/protocol/http/impl/access.hpp>
+#include <network/protocol/http/impl/response_state.hpp>
+#include <boost/system/system_error.hpp>
 #include <network/detail/debug.hpp>
 
 namespace network {
@@ -25,12 +29,19 @@ struct client_base_pimpl {
   typedef std::function<
       void(boost::iterator_range<char const*> const&,
            boost::system::error_code const&)> body_callback_function_type;
+  typedef client_base::response_callback_function_type
+      response_callback_function_type;
   client_base_pimpl(client_options const& options);
   response const request_skeleton(request const& request_,
                                   std::string const& method,
                                   bool get_body,
                                   body_callback_function_type callback,
                                   request_options const& options);
+  void async_request_skeleton(request const& request_,
+                              std::string const& method,
+                              bool get_body,
+                              response_callback_function_type callback,
+                              request_options const& options);
   void clear_resolved_cache();
   ~client_base_pimpl();
  private:
@@ -63,6 +74,16 @@ response const client_base::request_skeleton(
   return pimpl->request_skeleton(request_, method, get_body, callback, options);
 }
 
+void client_base::async_request_skeleton(
+    request const& request_,
+    std::string const& method,
+    bool get_body,
+    response_callback_function_type callback,
+    request_options const& options) {
+  NETWORK_MESSAGE("client_base::async_request_skeleton(...)");
+  pimpl->async_request_skeleton(request_, method, get_body, callback, options);
+}
+
 client_base::~client_base() {
   NETWORK_MESSAGE("client_base::~client_base()");
   delete pimpl;
@@ -124,6 +145,48 @@ response const client_base_pimpl::request_skeleton(
                                    options);
 }
 
+void client_base_pimpl::async_request_skeleton(
+    request const& request_,
+    std::string const& method,
+    bool get_body,
+    response_callback_function_type callback,
+    request_options const& options) {
+  NETWORK_MESSAGE("client_base_pimpl::async_request_skeleton(...)");
+  response response_ = request_skeleton(
+      request_, method, get_body, body_callback_function_type(), options);
+  impl::setter_access accessor;
+  std::shared_ptr<impl::response_state> state = accessor.get_state(response_);
+  // The handler only holds on to the state weakly, or the state would never
+  // go away if it isn't completed. Whoever completes it holds on to it.
+  std::weak_ptr<impl::response_state> weak_state(state);
+  boost::asio::io_service* service = service_ptr;
+  state->when_complete([weak_state, service, callback](std::exception_ptr e) {
+    response completed;
+    impl::setter_access().set_state(completed, weak_state.lock());
+    boost::system::error_code ec;
+    if (e) {
+      try {
+        std::rethrow_exception(e);
+      } catch (boost::system::system_error const& error) {
+        ec = error.code();
+      } catch (...) {
+        // Anything else means the response couldn't be parsed; getting its
+        // parts throws the actual error.
+        ec = boost::system::errc::make_error_code(
+            boost::system::errc::bad_message);
+      }
+    }
+    // The callback doesn't run on the connection's strand, so that it can
+    // take its time without holding up the connection. A stopped io_service
+    // won't run it, which is when a pending request is dropped, so it is
+    // called right away.
+    if (service->stopped())
+      callback(ec, completed);
+    else
+      service->post([callback, ec, completed]() { callback(ec, completed); });
+  });
+}
+
 void client_base_pimpl::clear_resolved_cache() {
   NETWORK_MESSAGE("client_base_pimpl::clear_resolved_cache()");
   connection_manager_->clear_resolved_cache();
@@ -8,6 +8,7 @@
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CLIENT_CONNECTION_HPP_20111103
 
 #include <functional>
+#include <memory>
 #include <boost/range/iterator_range.hpp>
 #include <boost/asio/error.hpp>
 
@@ -22,6 +23,8 @@ class request_options;
 struct client_connection {
   typedef std::function<void(boost::iterator_range<char const*> const&,
                              boost::system::error_code const&)> callback_type;
+  typedef std::function<void(std::shared_ptr<client_connection>)>
+      release_callback_type;
   virtual response send_request(std::string const& method,
                                 request const& request,
                                 bool get_body,
@@ -29,6 +32,11 @@ struct client_connection {
                                 request_options const& options) = 0;
   virtual client_connection* clone() const = 0;
   virtual void reset() = 0;
+  // Sets the function called once a response has been read. Connections
+  // that are still open and can send another request pass themselves to it,
+  // the others pass a null pointer. The default implementation never calls
+  // it.
+  virtual void on_release(release_callback_type callback);
   virtual ~client_connection() = 0;
 };
 
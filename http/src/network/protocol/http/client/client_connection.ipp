@@ -19,6 +19,11 @@ client_connection::~client_connection() {
   // Do nothing here.
 }
 
+void client_connection::on_release(release_callback_type callback) {
+  NETWORK_MESSAGE("client_connection::on_release(...)");
+  // Connections are not reused by default.
+}
+
 client_connection* client_connection::clone() const {
   NETWORK_MESSAGE("client_connection::clone()");
   // For exposition only.
@@ -32,6 +32,7 @@ struct http_async_connection_pimpl;
 struct http_async_connection : client_connection,
     std::enable_shared_from_this<http_async_connection> {
   using client_connection::callback_type;
+  using client_connection::release_callback_type;
   http_async_connection(
       std::shared_ptr<resolver_delegate> resolver_delegate,
       std::shared_ptr<connection_delegate> connection_delegate,
@@ -44,8 +45,10 @@ struct http_async_connection : client_connection,
                                 callback_type callback,
                                 request_options const& options);  // override
   virtual void reset();                                           // override
+  virtual void on_release(release_callback_type callback);        // override
   virtual ~http_async_connection();
  private:
+  friend struct http_async_connection_pimpl;
   explicit http_async_connection(std::shared_ptr<http_async_connection_pimpl>);
   std::shared_ptr<http_async_connection_pimpl> pimpl;
 };
@@ -7,8 +7,12 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_ASYNC_NORMAL_IPP_20111123
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_ASYNC_NORMAL_IPP_20111123
 
+#include <iterator>
 #include <memory>
 #include <utility>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/buffer.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/placeholders.hpp>
@@ -20,6 +24,7 @@
 #include <network/protocol/http/client/connection/resolver_delegate.hpp>
 #include <network/protocol/http/algorithms/linearize.hpp>
 #include <network/protocol/http/impl/access.hpp>
+#include <network/protocol/http/impl/response_state.hpp>
 #include <network/detail/debug.hpp>
 #ifdef NETWORK_ENABLE_HTTPS
 #include <boost/asio/ssl/error.hpp>
@@ -31,6 +36,7 @@ namespace http {
 struct http_async_connection_pimpl
     : std::enable_shared_from_this<http_async_connection_pimpl> {
   typedef http_async_connection::callback_type body_callback_function_type;
+  typedef http_async_connection::release_callback_type release_callback_type;
   typedef resolver_delegate::resolver_iterator resolver_iterator;
   typedef resolver_delegate::iterator_pair resolver_iterator_pair;
   typedef http_async_connection_pimpl this_type;
@@ -43,11 +49,28 @@ struct http_async_connection_pimpl
       : follow_redirect_(follow_redirect),
         request_strand_(io_service),
         resolver_delegate_(resolver_delegate),
-        connection_delegate_(connection_delegate) {
+        connection_delegate_(connection_delegate),
+        connected_(false),
+        reused_(false),
+        response_started_(false),
+        keep_alive_(false),
+        status_(0),
+        body_read_(0),
+        port_(0) {
     NETWORK_MESSAGE(
         "http_async_connection_pimpl::http_async_connection_pimpl(...)");
   }
 
+  // The pending handlers are all that keep a connection alive while it
+  // handles a request, so a connection only goes away in the middle of a
+  // response when they are dropped, as when its io_service is destroyed.
+  // The response fails then, instead of never completing.
+  ~http_async_connection_pimpl() {
+    if (this->state_)
+      this->state_->set_error(std::make_exception_ptr(
+          boost::system::system_error(boost::asio::error::operation_aborted)));
+  }
+
   // This is the main entry point for the connection/request pipeline. We're
   // overriding async_connection_base<...>::start(...) here which is called
   // by the client.
@@ -58,32 +81,33 @@ struct http_async_connection_pimpl
                  request_options const& options) {
     NETWORK_MESSAGE("http_async_connection_pimpl::start(...)");
     response response_;
+    this->reset_response_state();
     this->init_response(response_);
     // Use HTTP/1.1 -- at some point we might want to implement a different
     // connection type just for HTTP/1.0.
     // TODO: Implement a different connection type and factory for HTTP/1.0.
-    linearize(request,
-              method,
-              1,
-              1,
-              std::ostreambuf_iterator<char>(&command_streambuf));
+    // The request is kept until it has been written, in case it has to be
+    // sent again on a new connection.
+    command_.clear();
+    linearize(request, method, 1, 1, std::back_inserter(command_));
     this->method = method;
     NETWORK_MESSAGE("method: " << this->method);
-    boost::uint16_t port_ = port(request);
-    NETWORK_MESSAGE("port: " << port_);
+    this->port_ = port(request);
+    NETWORK_MESSAGE("port: " << this->port_);
     this->host_ = host(request);
 
-    resolver_delegate_->resolve(
-        this->host_,
-        port_,
-        request_strand_.wrap(
-            boost::bind(&this_type::handle_resolved,
-                        this_type::shared_from_this(),
-                        port_,
-                        get_body,
-                        callback,
-                        boost::asio::placeholders::error,
-                        boost::asio::placeholders::bytes_transferred)));
+    reused_ = connected_;
+    if (reused_) {
+      NETWORK_MESSAGE("reusing the connection kept open after the last "
+                      "response");
+      request_strand_.post(boost::bind(&this_type::handle_connected,
+                                       this_type::shared_from_this(),
+                                       get_body,
+                                       callback,
+                                       boost::system::error_code()));
+    } else {
+      resolve(get_body, callback);
+    }
     return response_;
   }
 
@@ -99,35 +123,111 @@ struct http_async_connection_pimpl
     // FIXME Perform the actual re-set of the internal state and pending stuff.
   }
 
+  void on_release(release_callback_type callback) {
+    release_callback_ = callback;
+  }
+
  private:
 
   http_async_connection_pimpl(http_async_connection_pimpl const&);  // = delete
 
+  // A connection that is kept open sends several requests, each of which
+  // gets a response of its own.
+  void reset_response_state() {
+    this->state_ = std::make_shared<impl::response_state>();
+    this->response_parser_.reset();
+    this->partial_parsed.clear();
+    this->content_length_ = boost::none;
+    this->response_started_ = false;
+    this->keep_alive_ = false;
+    this->status_ = 0;
+    this->body_read_ = 0;
+  }
+
+  void resolve(bool get_body, body_callback_function_type callback) {
+    resolver_delegate_->resolve(
+        this->host_,
+        this->port_,
+        request_strand_.wrap(
+            boost::bind(&this_type::handle_resolved,
+                        this_type::shared_from_this(),
+                        this->port_,
+                        get_body,
+                        callback,
+                        boost::asio::placeholders::error,
+                        boost::asio::placeholders::bytes_transferred)));
+  }
+
+  // A connection that was kept open may have been closed by the server while
+  // it was idle, which only shows once the request is sent. If none of the
+  // response has arrived yet, an idempotent request is sent again on a new
+  // connection.
+  bool retry_on_new_connection(bool get_body,
+                               body_callback_function_type callback) {
+    if (!reused_ || response_started_ || !is_idempotent(this->method))
+      return false;
+    NETWORK_MESSAGE("kept-alive connection was closed; reconnecting...");
+    reused_ = connected_ = false;
+    resolve(get_body, callback);
+    return true;
+  }
+
+  static bool is_idempotent(std::string const& method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" ||
+           method == "DELETE" || method == "OPTIONS" || method == "TRACE";
+  }
+
+  // Completes the response once the body has been read. The connection is
+  // released first, so that it can be reused by the time the response is
+  // complete; from then on it may be sending another request, so the
+  // response state is moved out of it.
+  void finish_response(bool reusable, boost::optional<std::string> body) {
+    std::shared_ptr<impl::response_state> state(std::move(this->state_));
+    this->part.assign('\0');
+    this->response_parser_.reset();
+    release(reusable);
+    // TODO set the destination value somewhere!
+    if (body)
+      state->set_body(*body);
+  }
+
+  // Tells a body callback that the whole body has been passed to it, the
+  // same way it's told when the server closes the connection.
+  void finish_callback_body(body_callback_function_type const& callback) {
+    finish_response(keep_alive_, boost::none);
+    buffer_type::const_iterator empty = 0;
+    callback(boost::make_iterator_range(empty, empty),
+             boost::asio::error::eof);
+  }
+
+  // Hands the connection to whoever manages it once it is done with a
+  // response. The connection is only handed back when it can send another
+  // request: the whole response has been read and the server keeps the
+  // connection open.
+  void release(bool reusable) {
+    connected_ = reusable;
+    if (!release_callback_)
+      return;
+    std::shared_ptr<client_connection> connection;
+    if (reusable)
+      connection.reset(new http_async_connection(this_type::shared_from_this()));
+    release_callback_(connection);
+  }
+
   void init_response(response& r) {
     NETWORK_MESSAGE("http_async_connection_pimpl::init_response(...)");
     impl::setter_access accessor;
-    accessor.set_source_promise(r, this->source_promise);
-    accessor.set_destination_promise(r, this->destination_promise);
-    accessor.set_headers_promise(r, this->headers_promise);
-    accessor.set_body_promise(r, this->body_promise);
-    accessor.set_version_promise(r, this->version_promise);
-    accessor.set_status_promise(r, this->status_promise);
-    accessor.set_status_message_promise(r, this->status_message_promise);
-    NETWORK_MESSAGE("futures and promises lined up.");
+    accessor.set_state(r, this->state_);
+    NETWORK_MESSAGE("response state shared.");
   }
 
   void set_errors(boost::system::error_code const& ec) {
     NETWORK_MESSAGE("http_async_connection_pimpl::set_errors(...)");
     NETWORK_MESSAGE("error: " << ec);
     boost::system::system_error error(ec);
-    this->version_promise.set_exception(std::make_exception_ptr(error));
-    this->status_promise.set_exception(std::make_exception_ptr(error));
-    this->status_message_promise.set_exception(std::make_exception_ptr(error));
-    this->headers_promise.set_exception(std::make_exception_ptr(error));
-    this->source_promise.set_exception(std::make_exception_ptr(error));
-    this->destination_promise.set_exception(std::make_exception_ptr(error));
-    this->body_promise.set_exception(std::make_exception_ptr(error));
-    NETWORK_MESSAGE("promise+future exceptions set.");
+    state_->set_error(std::make_exception_ptr(error));
+    NETWORK_MESSAGE("response error set.");
+    release(false);
   }
 
   void handle_resolved(boost::uint16_t port,
@@ -139,21 +239,26 @@ struct http_async_connection_pimpl
     if (!ec && !boost::empty(endpoint_range)) {
       // Here we deal with the case that there was no error encountered.
       NETWORK_MESSAGE("resolved endpoint successfully");
-      resolver_iterator iter = boost::begin(endpoint_range);
-      NETWORK_MESSAGE("trying connection to: " << iter->endpoint().address()
-                                               << ":" << port);
-      boost::asio::ip::tcp::endpoint endpoint(iter->endpoint().address(), port);
+      std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+      for (resolver_iterator iter = boost::begin(endpoint_range);
+           iter != boost::end(endpoint_range); ++iter) {
+        NETWORK_MESSAGE("will try connection to: "
+                        << iter->endpoint().address() << ":" << port);
+        endpoints.push_back(
+            boost::asio::ip::tcp::endpoint(iter->endpoint().address(), port));
+      }
 
+      // The delegate starts connecting to the next endpoint while the
+      // earlier attempts are still pending, so that an unreachable address
+      // doesn't stall the request.
       connection_delegate_->connect(
-          endpoint,
+          endpoints,
           this->host_,
           request_strand_.wrap(
               boost::bind(&this_type::handle_connected,
                           this_type::shared_from_this(),
-                          port,
                           get_body,
                           callback,
-                          std::make_pair(++iter, resolver_iterator()),
                           boost::asio::placeholders::error)));
     } else {
       NETWORK_MESSAGE("error encountered while resolving.");
@@ -161,16 +266,18 @@ struct http_async_connection_pimpl
     }
   }
 
-  void handle_connected(boost::uint16_t port,
-                        bool get_body,
+  void handle_connected(bool get_body,
                         body_callback_function_type callback,
-                        resolver_iterator_pair endpoint_range,
                         boost::system::error_code const& ec) {
     NETWORK_MESSAGE("http_async_connection_pimpl::handle_connected(...)");
     if (!ec) {
       NETWORK_MESSAGE("connected successfully");
       BOOST_ASSERT(connection_delegate_.get() != 0);
       NETWORK_MESSAGE("scheduling write...");
+      command_streambuf.consume(command_streambuf.size());
+      command_streambuf.commit(
+          boost::asio::buffer_copy(command_streambuf.prepare(command_.size()),
+                                   boost::asio::buffer(command_)));
 
       connection_delegate_->write(
           command_streambuf,
@@ -183,27 +290,7 @@ struct http_async_connection_pimpl
                           boost::asio::placeholders::bytes_transferred)));
     } else {
       NETWORK_MESSAGE("connection unsuccessful");
-      if (!boost::empty(endpoint_range)) {
-        resolver_iterator iter = boost::begin(endpoint_range);
-        NETWORK_MESSAGE("trying: " << iter->endpoint().address() << ":"
-                                   << port);
-        boost::asio::ip::tcp::endpoint endpoint(iter->endpoint().address(),
-                                                port);
-
-        connection_delegate_->connect(
-            endpoint,
-            this->host_,
-            request_strand_.wrap(
-                boost::bind(&this_type::handle_connected,
-                            this_type::shared_from_this(),
-                            port,
-                            get_body,
-                            callback,
-                            std::make_pair(++iter, resolver_iterator()),
-                            boost::asio::placeholders::error)));
-      } else {
-        set_errors(ec ? ec : boost::asio::error::host_not_found);
-      }
+      set_errors(ec);
     }
   }
 
@@ -234,7 +321,7 @@ struct http_async_connection_pimpl
                           callback,
                           boost::asio::placeholders::error,
                           boost::asio::placeholders::bytes_transferred)));
-    } else {
+    } else if (!retry_on_new_connection(get_body, callback)) {
       NETWORK_MESSAGE("request sent unsuccessfully; setting errors");
       set_errors(ec);
     }
@@ -258,7 +345,17 @@ struct http_async_connection_pimpl
 #else
     constexpr bool is_short_read_error = false;
 #endif
-    if (!ec || ec == boost::asio::error::eof || is_short_read_error) {
+    if (bytes_transferred != 0)
+      response_started_ = true;
+    // A connection closed before the body would otherwise have the parser
+    // wait for more data forever.
+    bool closed_early =
+        state != body && bytes_transferred == 0 &&
+        (ec == boost::asio::error::eof || is_short_read_error);
+    if ((ec || closed_early) && retry_on_new_connection(get_body, callback))
+      return;
+    if ((!ec || ec == boost::asio::error::eof || is_short_read_error) &&
+        !closed_early) {
       NETWORK_MESSAGE("processing data chunk, no error encountered so far...");
       boost::logic::tribool parsed_ok;
 
@@ -329,11 +426,8 @@ struct http_async_connection_pimpl
             // We short-circuit here because the user does not
             // want to get the body (in the case of a HEAD
             // request).
-            this->body_promise.set_value("");
-            this->destination_promise.set_value("");
-            this->source_promise.set_value("");
-            this->part.assign('\0');
-            this->response_parser_.reset();
+            finish_response(keep_alive_ && this->method == "HEAD",
+                            std::string());
             NETWORK_MESSAGE("processing done.");
             return;
           }
@@ -349,15 +443,21 @@ struct http_async_connection_pimpl
             buffer_type::const_iterator end = begin;
             std::advance(end, std::min(bytes_transferred, remainder));
 
-            // We're setting the body promise here to an empty string because
-            // this can be used as a signaling mechanism for the user to
-            // determine that the body is now ready for processing, even
-            // though the callback is already provided.
-            this->body_promise.set_value("");
+            // We're setting the body here to an empty string because this
+            // can be used as a signaling mechanism for the user to determine
+            // that the body is now ready for processing, even though the
+            // callback is already provided.
+            std::string empty_body;
+            this->state_->set_body(empty_body);
 
             // The invocation of the callback is synchronous to allow us to
             // wait before scheduling another read.
             callback(boost::make_iterator_range(begin, end), ec);
+            body_read_ = std::distance(begin, end);
+            if (content_length_ && body_read_ >= *content_length_) {
+              finish_callback_body(callback);
+              return;
+            }
 
             connection_delegate_->read_some(
                 boost::asio::mutable_buffers_1(this->part.c_array(),
@@ -408,13 +508,9 @@ struct http_async_connection_pimpl
               std::string body_string;
               std::swap(body_string, this->partial_parsed);
               body_string.append(this->part.begin(), bytes_transferred);
-              this->body_promise.set_value(body_string);
+              this->state_->set_body(body_string);
             }
-            // TODO set the destination value somewhere!
-            this->destination_promise.set_value("");
-            this->source_promise.set_value("");
-            this->part.assign('\0');
-            this->response_parser_.reset();
+            finish_response(false, boost::none);
           } else {
             NETWORK_MESSAGE("connection still active...");
             // This means the connection has not been closed yet and we want to get more
@@ -428,6 +524,11 @@ struct http_async_connection_pimpl
               buffer_type::const_iterator end = begin;
               std::advance(end, bytes_transferred);
               callback(boost::make_iterator_range(begin, end), ec);
+              body_read_ += bytes_transferred;
+              if (content_length_ && body_read_ >= *content_length_) {
+                finish_callback_body(callback);
+                return;
+              }
               connection_delegate_->read_some(
                   boost::asio::mutable_buffers_1(this->part.c_array(),
                                                  this->part.size()),
@@ -441,42 +542,17 @@ struct http_async_connection_pimpl
                       boost::asio::placeholders::bytes_transferred)));
             } else {
               NETWORK_MESSAGE("no callback provided, appending to body...");
-              bool get_more = true;
-              if (content_length_) {
-                buffer_type::const_iterator begin = this->part.begin();
-                buffer_type::const_iterator end = begin;
-                std::advance(end, bytes_transferred);
-                get_more = (end - begin) < *content_length_;
-                NETWORK_MESSAGE("content_length = "
-                                << *content_length_ << ", bytes read = "
-                                << (end - begin) << ", read more = "
-                                << get_more);
-              }
-              // Here we don't have a body callback. Let's
-              // make sure that we deal with the remainder
-              // from the headers part in case we do have data
-              // that's still in the buffer.
-              if (get_more) {
-                this->parse_body(request_strand_.wrap(
-                    boost::bind(&this_type::handle_received_data,
-                                this_type::shared_from_this(),
-                                body,
-                                get_body,
-                                callback,
-                                boost::asio::placeholders::error,
-                                boost::asio::placeholders::bytes_transferred)),
-                                 bytes_transferred);
-              } else {
-                std::string body_string;
-                std::swap(body_string, this->partial_parsed);
-                body_string.append(this->part.begin(), bytes_transferred);
-                this->body_promise.set_value(body_string);
-                // TODO set the destination value somewhere!
-                this->destination_promise.set_value("");
-                this->source_promise.set_value("");
-                this->part.assign('\0');
-                this->response_parser_.reset();
-              }
+              // Here we don't have a body callback, so the body is
+              // collected until it's complete.
+              this->parse_body(request_strand_.wrap(
+                  boost::bind(&this_type::handle_received_data,
+                              this_type::shared_from_this(),
+                              body,
+                              get_body,
+                              callback,
+                              boost::asio::placeholders::error,
+                              boost::asio::placeholders::bytes_transferred)),
+                               bytes_transferred);
             }
           }
           return;
@@ -487,24 +563,8 @@ struct http_async_connection_pimpl
       boost::system::system_error error(ec);
       NETWORK_MESSAGE("error encountered: " << error.what() << " (" << ec
                                             << ")");
-      this->source_promise.set_exception(std::make_exception_ptr(error));
-      this->destination_promise.set_exception(std::make_exception_ptr(error));
-      switch (state) {
-        case version:
-          this->version_promise.set_exception(std::make_exception_ptr(error));
-        case status:
-          this->status_promise.set_exception(std::make_exception_ptr(error));
-        case status_message:
-          this->status_message_promise.set_exception(
-              std::make_exception_ptr(error));
-        case headers:
-          this->headers_promise.set_exception(std::make_exception_ptr(error));
-        case body:
-          this->body_promise.set_exception(std::make_exception_ptr(error));
-          break;
-        default:
-          BOOST_ASSERT(false && "Bug, report this to the developers!");
-      }
+      this->state_->set_error(std::make_exception_ptr(error));
+      release(false);
     }
   }
 
@@ -557,7 +617,9 @@ struct http_async_connection_pimpl
       std::swap(version, partial_parsed);
       version.append(boost::begin(result_range), boost::end(result_range));
       boost::algorithm::trim(version);
-      version_promise.set_value(version);
+      // HTTP/1.1 connections stay open unless the server says otherwise.
+      keep_alive_ = version == "HTTP/1.1";
+      version_ = version;
       part_begin = boost::end(result_range);
     } else if (parsed_ok == false) {
 #ifdef NETWORK_DEBUG
@@ -568,13 +630,8 @@ struct http_async_connection_pimpl
                                  << "] buffer contents: \"" << escaped << "\"");
 #endif
       std::runtime_error error("Invalid Version Part.");
-      version_promise.set_exception(std::make_exception_ptr(error));
-      status_promise.set_exception(std::make_exception_ptr(error));
-      status_message_promise.set_exception(std::make_exception_ptr(error));
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
+      state_->set_error(std::make_exception_ptr(error));
+      release(false);
     } else {
       partial_parsed.append(boost::begin(result_range),
                             boost::end(result_range));
@@ -602,8 +659,7 @@ struct http_async_connection_pimpl
       std::swap(status, partial_parsed);
       status.append(boost::begin(result_range), boost::end(result_range));
       boost::trim(status);
-      boost::uint16_t status_int = boost::lexical_cast<boost::uint16_t>(status);
-      status_promise.set_value(status_int);
+      status_ = boost::lexical_cast<boost::uint16_t>(status);
       part_begin = boost::end(result_range);
     } else if (parsed_ok == false) {
 #ifdef NETWORK_DEBUG
@@ -614,12 +670,8 @@ struct http_async_connection_pimpl
                                  << "] buffer contents: \"" << escaped << "\"");
 #endif
       std::runtime_error error("Invalid status part.");
-      status_promise.set_exception(std::make_exception_ptr(error));
-      status_message_promise.set_exception(std::make_exception_ptr(error));
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
+      state_->set_error(std::make_exception_ptr(error));
+      release(false);
     } else {
       partial_parsed.append(boost::begin(result_range),
                             boost::end(result_range));
@@ -648,7 +700,7 @@ struct http_async_connection_pimpl
       status_message.append(boost::begin(result_range),
                             boost::end(result_range));
       boost::algorithm::trim(status_message);
-      status_message_promise.set_value(status_message);
+      status_message_ = status_message;
       part_begin = boost::end(result_range);
     } else if (parsed_ok == false) {
 #ifdef NETWORK_DEBUG
@@ -659,11 +711,8 @@ struct http_async_connection_pimpl
                                  << "] buffer contents: \"" << escaped << "\"");
 #endif
       std::runtime_error error("Invalid status message part.");
-      status_message_promise.set_exception(std::make_exception_ptr(error));
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
+      state_->set_error(std::make_exception_ptr(error));
+      release(false);
     } else {
       partial_parsed.append(boost::begin(result_range),
                             boost::end(result_range));
@@ -705,24 +754,33 @@ struct http_async_connection_pimpl
       boost::trim(header_pair.second);
       headers.insert(header_pair);
     }
-    // Set content length
+    // Set content length. Header names are case-insensitive.
     content_length_ = boost::none;
-    auto it = headers.find("Content-Length");
-    if (it != headers.end()) {
-      try {
-        content_length_ = std::stoul(it->second);
-        NETWORK_MESSAGE("Content-Length: " << *content_length_);
-      }
-      catch (const std::invalid_argument&) {
-        NETWORK_MESSAGE("invalid argument exception while interpreting "
-                        << it->second << " as content length");
-      }
-      catch (const std::out_of_range&) {
-        NETWORK_MESSAGE("out of range exception while interpreting "
-                        << it->second << " as content length");
+    for (auto const& header : headers) {
+      if (boost::iequals(header.first, "Connection")) {
+        if (boost::icontains(header.second, "close"))
+          keep_alive_ = false;
+        else if (boost::icontains(header.second, "keep-alive"))
+          keep_alive_ = true;
+      } else if (boost::iequals(header.first, "Content-Length")) {
+        try {
+          content_length_ = std::stoul(header.second);
+          NETWORK_MESSAGE("Content-Length: " << *content_length_);
+        }
+        catch (const std::invalid_argument&) {
+          NETWORK_MESSAGE("invalid argument exception while interpreting "
+                          << header.second << " as content length");
+        }
+        catch (const std::out_of_range&) {
+          NETWORK_MESSAGE("out of range exception while interpreting "
+                          << header.second << " as content length");
+        }
       }
     }
-    headers_promise.set_value(headers);
+    // Responses that can't have a body are complete after the headers.
+    if (status_ == 204 || status_ == 304)
+      content_length_ = 0;
+    state_->set_headers(version_, status_, status_message_, headers);
   }
 
   boost::fusion::tuple<boost::logic::tribool, size_t> parse_headers(
@@ -756,10 +814,8 @@ struct http_async_connection_pimpl
                                  << boost::distance(result_range));
 #endif
       std::runtime_error error("Invalid header part.");
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
+      state_->set_error(std::make_exception_ptr(error));
+      release(false);
     } else {
       partial_parsed.append(boost::begin(result_range),
                             boost::end(result_range));
@@ -780,6 +836,16 @@ struct http_async_connection_pimpl
     // buffer.
     partial_parsed.append(part_begin, bytes);
     part_begin = part.begin();
+    if (content_length_ && partial_parsed.size() >= *content_length_) {
+      // The whole body is here, there's no need to wait for the server to
+      // close the connection.
+      bool reusable = keep_alive_ && partial_parsed.size() == *content_length_;
+      std::string body_string;
+      std::swap(body_string, partial_parsed);
+      body_string.resize(*content_length_);
+      finish_response(reusable, body_string);
+      return;
+    }
     connection_delegate_->read_some(
         boost::asio::mutable_buffers_1(part.c_array(), part.size()),
         callback);
@@ -789,22 +855,23 @@ struct http_async_connection_pimpl
   boost::asio::io_service::strand request_strand_;
   std::shared_ptr<resolver_delegate> resolver_delegate_;
   std::shared_ptr<connection_delegate> connection_delegate_;
+  release_callback_type release_callback_;
+  std::string command_;
   boost::asio::streambuf command_streambuf;
   std::string method;
   response_parser response_parser_;
-  std::promise<std::string> version_promise;
-  std::promise<boost::uint16_t> status_promise;
-  std::promise<std::string> status_message_promise;
-  std::promise<std::multimap<std::string, std::string>> headers_promise;
+  std::shared_ptr<impl::response_state> state_;
+  std::string version_, status_message_;
   boost::optional<size_t> content_length_;
-  std::promise<std::string> source_promise;
-  std::promise<std::string> destination_promise;
-  std::promise<std::string> body_promise;
   typedef boost::array<char, NETWORK_BUFFER_CHUNK> buffer_type;
   buffer_type part;
   buffer_type::const_iterator part_begin;
   std::string partial_parsed;
   std::string host_;
+  bool connected_, reused_, response_started_, keep_alive_;
+  boost::uint16_t status_;
+  size_t body_read_;
+  boost::uint16_t port_;
 };
 
 // END OF PIMPL DEFINITION
@@ -838,6 +905,10 @@ response http_async_connection::send_request(std::string const& method,
   return pimpl->start(request, method, get_body, callback, options);
 }
 
+void http_async_connection::on_release(release_callback_type callback) {
+  pimpl->on_release(callback);
+}
+
 void http_async_connection::reset() {
   pimpl
       ->reset();  // NOTE: We're not resetting the pimpl, just the internal state.
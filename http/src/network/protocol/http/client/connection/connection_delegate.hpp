@@ -10,6 +10,8 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <functional>
+#include <string>
+#include <vector>
 
 namespace network {
 namespace http {
@@ -19,6 +21,12 @@ struct connection_delegate {
       boost::asio::ip::tcp::endpoint& endpoint,
       std::string const& host,
       std::function<void(boost::system::error_code const&)> handler) = 0;
+  // Connects to the first of the endpoints to accept a connection. Attempts
+  // are staggered by the client's connection attempt delay (RFC 8305).
+  virtual void connect(
+      std::vector<boost::asio::ip::tcp::endpoint> const& endpoints,
+      std::string const& host,
+      std::function<void(boost::system::error_code const&)> handler) = 0;
   virtual void write(boost::asio::streambuf& command_streambuf,
                      std::function<void(boost::system::error_code const&,
                                         size_t)> handler) = 0;
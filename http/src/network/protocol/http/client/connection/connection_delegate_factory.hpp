@@ -8,6 +8,7 @@
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_DELEGATE_FACTORY_HPP_20110819
 
 #include <memory>
+#include <mutex>
 #include <boost/throw_exception.hpp>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 
@@ -16,6 +17,12 @@ namespace http {
 
 class client_options;
 
+namespace v2 {
+namespace client_connection {
+class ssl_client_context;
+}  // namespace client_connection
+}  // namespace v2
+
 struct connection_delegate_factory {
   typedef std::shared_ptr<connection_delegate> connection_delegate_ptr;
 
@@ -32,6 +39,12 @@ struct connection_delegate_factory {
  private:
   connection_delegate_factory(connection_delegate_factory const &) = delete;
   connection_delegate_factory &operator=(connection_delegate_factory) = delete;
+
+  // The HTTPS connections made by the factory share an SSL context and the
+  // sessions they can resume. It is built from the options of the first
+  // one.
+  std::mutex ssl_context_mutex_;
+  std::shared_ptr<v2::client_connection::ssl_client_context> ssl_context_;
 };
 
 }  // namespace http
@@ -33,7 +33,15 @@ connection_delegate_factory::connection_delegate_ptr connection_delegate_factory
   if (https) {
 #ifdef NETWORK_ENABLE_HTTPS
     NETWORK_MESSAGE("creating an SSL delegate");
-    std::shared_ptr<ssl_delegate> delegate_ptr(new ssl_delegate(service, options));
+    std::shared_ptr<ssl_client_context> context;
+    {
+      std::lock_guard<std::mutex> lock(ssl_context_mutex_);
+      if (!ssl_context_)
+        ssl_context_ = make_ssl_client_context(options);
+      context = ssl_context_;
+    }
+    std::shared_ptr<ssl_delegate> delegate_ptr(
+        new ssl_delegate(service, options, context));
     delegate = std::move(delegate_ptr);
 #else
     NETWORK_MESSAGE("creating an SSL delegate, but not supported");
@@ -41,7 +49,8 @@ connection_delegate_factory::connection_delegate_ptr connection_delegate_factory
 #endif /* NETWORK_ENABLE_HTTPS */
   } else {
     NETWORK_MESSAGE("creating a normal delegate");
-    delegate.reset(new normal_delegate(service));
+    delegate.reset(
+        new normal_delegate(service, options.connection_attempt_delay()));
   }
   return delegate;
 }
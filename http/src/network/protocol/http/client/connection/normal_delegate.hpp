@@ -8,6 +8,7 @@
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_NORMAL_DELEGATE_20110819
 
 #include <memory>
+#include <boost/cstdint.hpp>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 
 namespace boost {
@@ -23,12 +24,17 @@ namespace network {
 namespace http {
 
 struct normal_delegate : connection_delegate {
-  normal_delegate(boost::asio::io_service& service);
+  explicit normal_delegate(boost::asio::io_service& service,
+                           boost::uint64_t connection_attempt_delay = 250);
 
   virtual void connect(
       boost::asio::ip::tcp::endpoint& endpoint,
       std::string const& host,
       std::function<void(boost::system::error_code const&)> handler);
+  virtual void connect(
+      std::vector<boost::asio::ip::tcp::endpoint> const& endpoints,
+      std::string const& host,
+      std::function<void(boost::system::error_code const&)> handler);
   virtual void write(
       boost::asio::streambuf& command_streambuf,
       std::function<void(boost::system::error_code const&, size_t)> handler);
@@ -39,6 +45,7 @@ struct normal_delegate : connection_delegate {
 
  private:
   boost::asio::io_service& service_;
+  boost::uint64_t connection_attempt_delay_;
   std::unique_ptr<boost::asio::ip::tcp::socket> socket_;
 
   normal_delegate(normal_delegate const&) = delete;
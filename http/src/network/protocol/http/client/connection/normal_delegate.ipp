@@ -13,11 +13,14 @@
 #include <functional>
 #include <boost/asio/buffer.hpp>
 #include <network/protocol/http/client/connection/normal_delegate.hpp>
+#include <network/http/v2/client/connection/happy_eyeballs_connector.hpp>
 #include <network/detail/debug.hpp>
 
 network::http::normal_delegate::normal_delegate(
-    boost::asio::io_service& service)
-    : service_(service) {}
+    boost::asio::io_service& service,
+    boost::uint64_t connection_attempt_delay)
+    : service_(service),
+      connection_attempt_delay_(connection_attempt_delay) {}
 
 void network::http::normal_delegate::connect(
     boost::asio::ip::tcp::endpoint& endpoint,
@@ -27,6 +30,24 @@ void network::http::normal_delegate::connect(
   socket_->async_connect(endpoint, handler);
 }
 
+void network::http::normal_delegate::connect(
+    std::vector<boost::asio::ip::tcp::endpoint> const& endpoints,
+    std::string const& host,
+    std::function<void(boost::system::error_code const&)> handler) {
+  NETWORK_MESSAGE("normal_delegate::connect(...)");
+  typedef network::http::v2::client_connection::happy_eyeballs_connector
+      connector_type;
+  std::shared_ptr<connector_type> connector(std::make_shared<connector_type>(
+      service_, std::chrono::milliseconds(connection_attempt_delay_)));
+  connector->async_connect(
+      connector_type::interleave(endpoints),
+      [this, handler](boost::system::error_code const& ec,
+                      connector_type::socket_ptr socket) {
+        socket_ = std::move(socket);
+        handler(ec);
+      });
+}
+
 void network::http::normal_delegate::write(
     boost::asio::streambuf& command_streambuf,
     std::function<void(boost::system::error_code const&, size_t)> handler) {
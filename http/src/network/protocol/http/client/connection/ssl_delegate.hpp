@@ -9,6 +9,8 @@
 
 #include <memory>
 #include <boost/asio/ssl.hpp>
+#include <boost/cstdint.hpp>
+#include <network/http/v2/client/connection/ssl_client_context.hpp>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 #include <network/protocol/http/client/options.hpp>
 
@@ -21,14 +23,30 @@ class io_service;
 namespace network {
 namespace http {
 
+// The TLS state shared by the connections of a client is the v2 client's:
+// the SSL context, and the last session of each host the client has
+// connected to.
+typedef v2::client_connection::ssl_client_context ssl_client_context;
+
+// Makes the TLS state for the certificate and verify paths of options.
+std::shared_ptr<ssl_client_context> make_ssl_client_context(
+    client_options const& options);
+
 struct ssl_delegate : connection_delegate,
     std::enable_shared_from_this<ssl_delegate> {
   ssl_delegate(boost::asio::io_service& service, client_options const& options);
+  ssl_delegate(boost::asio::io_service& service,
+               client_options const& options,
+               std::shared_ptr<ssl_client_context> context);
 
   virtual void connect(
       boost::asio::ip::tcp::endpoint& endpoint,
       std::string const& host,
       std::function<void(boost::system::error_code const&)> handler);
+  virtual void connect(
+      std::vector<boost::asio::ip::tcp::endpoint> const& endpoints,
+      std::string const& host,
+      std::function<void(boost::system::error_code const&)> handler);
   virtual void write(
       boost::asio::streambuf& command_streambuf,
       std::function<void(boost::system::error_code const&, size_t)> handler);
@@ -40,13 +58,15 @@ struct ssl_delegate : connection_delegate,
  private:
   boost::asio::io_service& service_;
   client_options options_;
-  std::unique_ptr<boost::asio::ssl::context> context_;
+  std::shared_ptr<ssl_client_context> context_;
+  std::string destination_;
   std::unique_ptr<
       boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> socket_;
 
   ssl_delegate(ssl_delegate const&);      // = delete
   ssl_delegate& operator=(ssl_delegate);  // = delete
 
+  void init_socket(std::string const& host, boost::uint16_t port);
   void handle_connected(
       boost::system::error_code const& ec,
       std::function<void(boost::system::error_code const&)> handler);
@@ -7,15 +7,43 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_SSL_DELEGATE_IPP_20110819
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_SSL_DELEGATE_IPP_20110819
 
+#include <list>
+#include <string>
+#include <vector>
 #include <network/protocol/http/client/options.hpp>
 #include <network/protocol/http/client/connection/ssl_delegate.hpp>
+#include <network/http/v2/client/connection/happy_eyeballs_connector.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/lexical_cast.hpp>
 #include <network/detail/debug.hpp>
 
+std::shared_ptr<network::http::ssl_client_context>
+network::http::make_ssl_client_context(client_options const& options) {
+  NETWORK_MESSAGE("make_ssl_client_context(...)");
+  std::list<std::string> const& certificate_paths =
+      options.openssl_certificate_paths();
+  std::list<std::string> const& verify_paths = options.openssl_verify_paths();
+  return std::make_shared<ssl_client_context>(
+      std::vector<std::string>(certificate_paths.begin(),
+                               certificate_paths.end()),
+      std::vector<std::string>(verify_paths.begin(), verify_paths.end()));
+}
+
 network::http::ssl_delegate::ssl_delegate(boost::asio::io_service& service,
                                           client_options const& options)
     : service_(service),
-      options_(options) {
+      options_(options),
+      context_(make_ssl_client_context(options)) {
+  NETWORK_MESSAGE("ssl_delegate::ssl_delegate(...)");
+}
+
+network::http::ssl_delegate::ssl_delegate(
+    boost::asio::io_service& service,
+    client_options const& options,
+    std::shared_ptr<ssl_client_context> context)
+    : service_(service),
+      options_(options),
+      context_(context) {
   NETWORK_MESSAGE("ssl_delegate::ssl_delegate(...)");
 }
 
@@ -24,33 +52,7 @@ void network::http::ssl_delegate::connect(
     std::string const& host,
     std::function<void(boost::system::error_code const&)> handler) {
   NETWORK_MESSAGE("ssl_delegate::connect(...)");
-  context_.reset(
-      new boost::asio::ssl::context(boost::asio::ssl::context::sslv23));
-  std::list<std::string> const& certificate_paths =
-      options_.openssl_certificate_paths();
-  std::list<std::string> const& verifier_paths =
-      options_.openssl_verify_paths();
-  bool use_default_verification = certificate_paths.empty() &&
-                                  verifier_paths.empty();
-  if (!use_default_verification) {
-    for (std::list<std::string>::const_iterator it = certificate_paths.begin();
-         it != certificate_paths.end(); ++it) {
-      context_->load_verify_file(*it);
-    }
-    for (std::list<std::string>::const_iterator it = verifier_paths.begin();
-         it != verifier_paths.begin(); ++it) {
-      context_->add_verify_path(*it);
-    }
-    NETWORK_MESSAGE("verifying peer: " << host);
-    context_->set_verify_mode(boost::asio::ssl::context::verify_peer);
-    context_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
-  } else {
-    NETWORK_MESSAGE("not verifying peer");
-    context_->set_default_verify_paths();
-    context_->set_verify_mode(boost::asio::ssl::context::verify_none);
-  }
-  socket_.reset(new boost::asio::ssl::stream<
-                        boost::asio::ip::tcp::socket>(service_, *context_));
+  init_socket(host, endpoint.port());
   NETWORK_MESSAGE("scheduling asynchronous connection...");
   using namespace std::placeholders;
   socket_->lowest_layer()
@@ -61,23 +63,77 @@ void network::http::ssl_delegate::connect(
                                handler));
 }
 
+void network::http::ssl_delegate::connect(
+    std::vector<boost::asio::ip::tcp::endpoint> const& endpoints,
+    std::string const& host,
+    std::function<void(boost::system::error_code const&)> handler) {
+  NETWORK_MESSAGE("ssl_delegate::connect(...)");
+  init_socket(host, endpoints.empty() ? 0 : endpoints.front().port());
+  NETWORK_MESSAGE("scheduling staggered asynchronous connections...");
+  typedef network::http::v2::client_connection::happy_eyeballs_connector
+      connector_type;
+  std::shared_ptr<connector_type> connector(std::make_shared<connector_type>(
+      service_,
+      std::chrono::milliseconds(options_.connection_attempt_delay())));
+  std::shared_ptr<ssl_delegate> self(shared_from_this());
+  connector->async_connect(
+      connector_type::interleave(endpoints),
+      [self, handler](boost::system::error_code const& ec,
+                      connector_type::socket_ptr socket) {
+        if (socket) {
+          // the handshake is performed over the socket that won
+          self->socket_->lowest_layer() = std::move(*socket);
+        }
+        self->handle_connected(ec, handler);
+      });
+}
+
+void network::http::ssl_delegate::init_socket(std::string const& host,
+                                              boost::uint16_t port) {
+  socket_.reset(new boost::asio::ssl::stream<boost::asio::ip::tcp::socket>(
+      service_, context_->context()));
+  // Servers that host several names pick the certificate by the name sent
+  // with SNI. Addresses aren't sent.
+  boost::system::error_code is_name;
+  boost::asio::ip::address::from_string(host, is_name);
+  if (is_name) {
+    NETWORK_MESSAGE("sending server name: " << host);
+    SSL_set_tlsext_host_name(socket_->native_handle(), host.c_str());
+  }
+  if (context_->verify_peer()) {
+    NETWORK_MESSAGE("verifying peer: " << host);
+    socket_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
+  } else {
+    NETWORK_MESSAGE("not verifying peer");
+  }
+  destination_ = host + ":" + boost::lexical_cast<std::string>(port);
+  context_->resume(socket_->native_handle(), destination_);
+}
+
 void network::http::ssl_delegate::handle_connected(
     boost::system::error_code const& ec,
     std::function<void(boost::system::error_code const&)> handler) {
   NETWORK_MESSAGE("ssl_delegate::handle_connected(...)");
   if (!ec) {
-    NETWORK_MESSAGE("connected to endpoint.");
-    // Here we check if there's an existing session for the connection.
-    SSL_SESSION* existing_session = SSL_get1_session(socket_->impl()->ssl);
-    if (existing_session == NULL) {
-      NETWORK_MESSAGE("found no existing session, performing handshake.");
-      socket_->async_handshake(boost::asio::ssl::stream_base::client, handler);
-    } else {
-      NETWORK_MESSAGE("found existing session, bypassing handshake.");
-      SSL_set_session(socket_->impl()->ssl, existing_session);
-      SSL_connect(socket_->impl()->ssl);
-      handler(ec);
-    }
+    NETWORK_MESSAGE("connected to endpoint, performing handshake.");
+    // The handshake ends with a write of the client's, right before the
+    // request is written; with Nagle's algorithm the request would wait for
+    // the server to acknowledge the handshake.
+    boost::system::error_code ignored;
+    socket_->lowest_layer().set_option(boost::asio::ip::tcp::no_delay(true),
+                                       ignored);
+    std::shared_ptr<ssl_delegate> self(shared_from_this());
+    socket_->async_handshake(
+        boost::asio::ssl::stream_base::client,
+        [self, handler](boost::system::error_code const& ec) {
+          if (ec) {
+            NETWORK_MESSAGE("handshake failed: " << ec);
+            self->context_->forget(self->destination_);
+          } else if (SSL_session_reused(self->socket_->native_handle())) {
+            NETWORK_MESSAGE("resumed the last session.");
+          }
+          handler(ec);
+        });
   } else {
     NETWORK_MESSAGE("encountered error: " << ec);
     handler(ec);
@@ -102,6 +158,11 @@ void network::http::ssl_delegate::read_some(
 
 network::http::ssl_delegate::~ssl_delegate() {
   NETWORK_MESSAGE("ssl_delegate::~ssl_delegate()");
+  // Connections are closed without a close_notify, which OpenSSL takes to
+  // mean that their session can't be resumed. The session is kept by the
+  // client context though, and is still good; a failed handshake drops it.
+  if (socket_)
+    SSL_set_shutdown(socket_->native_handle(), SSL_SENT_SHUTDOWN);
 }
 
 #endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_SSL_DELEGATE_IPP_20110819 */
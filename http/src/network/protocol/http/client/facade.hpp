@@ -17,6 +17,8 @@ namespace http {
 
 struct basic_client_facade {
   typedef client_base::body_callback_function_type body_callback_function_type;
+  typedef client_base::response_callback_function_type
+      response_callback_function_type;
 
   basic_client_facade();
   explicit basic_client_facade(client_options const& options);
@@ -45,6 +47,30 @@ struct basic_client_facade {
       request const& request,
       body_callback_function_type body_handler = body_callback_function_type(),
       request_options const & options = request_options());
+
+  // These send the request and return right away, without waiting for the
+  // response. The response handler is called on the client's io_service
+  // once the whole response has been read, or with the error the request
+  // failed with.
+  void async_head(request const& request,
+                  response_callback_function_type response_handler,
+                  request_options const& options = request_options());
+  void async_get(request const& request,
+                 response_callback_function_type response_handler,
+                 request_options const & options = request_options());
+  void async_post(request request,
+                  boost::optional<std::string> body,
+                  boost::optional<std::string> content_type,
+                  response_callback_function_type response_handler,
+                  request_options const & options = request_options());
+  void async_put(request request,
+                 boost::optional<std::string> body,
+                 boost::optional<std::string> content_type,
+                 response_callback_function_type response_handler,
+                 request_options const & options = request_options());
+  void async_delete(request const& request,
+                    response_callback_function_type response_handler,
+                    request_options const & options = request_options());
   void clear_resolved_cache();
 
  protected:
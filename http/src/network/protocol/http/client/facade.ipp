@@ -14,6 +14,35 @@
 namespace network {
 namespace http {
 
+namespace {
+
+void prepare_body(request& request,
+                  boost::optional<std::string> const& body,
+                  boost::optional<std::string> const& content_type) {
+  if (body) {
+    NETWORK_MESSAGE("using body provided.");
+    request << remove_header("Content-Length")
+            << header("Content-Length",
+                      boost::lexical_cast<std::string>(body->size()))
+            << network::body(*body);
+  }
+
+  headers_wrapper::container_type const& headers_ = headers(request);
+  if (content_type) {
+    NETWORK_MESSAGE("using provided content type.");
+    request << remove_header("Content-Type")
+            << header("Content-Type", *content_type);
+  } else {
+    NETWORK_MESSAGE("using default content type.");
+    if (boost::empty(headers_.equal_range("Content-Type"))) {
+      static char default_content_type[] = "x-application/octet-stream";
+      request << header("Content-Type", default_content_type);
+    }
+  }
+}
+
+}  // namespace
+
 basic_client_facade::basic_client_facade()
     : base(new (std::nothrow) client_base()) {
   NETWORK_MESSAGE("basic_client_facade::basic_client_facade()");
@@ -50,26 +79,7 @@ response const basic_client_facade::post(
     body_callback_function_type body_handler,
     request_options const& options) {
   NETWORK_MESSAGE("basic_client_facade::post(...)");
-  if (body) {
-    NETWORK_MESSAGE("using body provided.");
-    request << remove_header("Content-Length")
-            << header("Content-Length",
-                      boost::lexical_cast<std::string>(body->size()))
-            << network::body(*body);
-  }
-
-  headers_wrapper::container_type const& headers_ = headers(request);
-  if (content_type) {
-    NETWORK_MESSAGE("using provided content type.");
-    request << remove_header("Content-Type")
-            << header("Content-Type", *content_type);
-  } else {
-    NETWORK_MESSAGE("using default content type.");
-    if (boost::empty(headers_.equal_range("Content-Type"))) {
-      static char default_content_type[] = "x-application/octet-stream";
-      request << header("Content-Type", default_content_type);
-    }
-  }
+  prepare_body(request, body, content_type);
   return base->request_skeleton(request, "POST", true, body_handler, options);
 }
 
@@ -80,26 +90,7 @@ response const basic_client_facade::put(
     body_callback_function_type body_handler,
     request_options const& options) {
   NETWORK_MESSAGE("basic_client_facade::put(...)");
-  if (body) {
-    NETWORK_MESSAGE("using body provided.");
-    request << remove_header("Content-Length")
-            << header("Content-Length",
-                      boost::lexical_cast<std::string>(body->size()))
-            << network::body(*body);
-  }
-
-  headers_wrapper::container_type const& headers_ = headers(request);
-  if (content_type) {
-    NETWORK_MESSAGE("using provided content type.");
-    request << remove_header("Content-Type")
-            << header("Content-Type", *content_type);
-  } else {
-    NETWORK_MESSAGE("using default content type.");
-    if (boost::empty(headers_.equal_range("Content-Type"))) {
-      static char default_content_type[] = "x-application/octet-stream";
-      request << header("Content-Type", default_content_type);
-    }
-  }
+  prepare_body(request, body, content_type);
   return base->request_skeleton(request, "PUT", true, body_handler, options);
 }
 
@@ -111,6 +102,57 @@ response const basic_client_facade::delete_(
   return base->request_skeleton(request, "DELETE", true, body_handler, options);
 }
 
+void basic_client_facade::async_head(
+    request const& request,
+    response_callback_function_type response_handler,
+    request_options const& options) {
+  NETWORK_MESSAGE("basic_client_facade::async_head(...)");
+  base->async_request_skeleton(
+      request, "HEAD", false, response_handler, options);
+}
+
+void basic_client_facade::async_get(
+    request const& request,
+    response_callback_function_type response_handler,
+    request_options const& options) {
+  NETWORK_MESSAGE("basic_client_facade::async_get(...)");
+  base->async_request_skeleton(
+      request, "GET", true, response_handler, options);
+}
+
+void basic_client_facade::async_post(
+    request request,
+    boost::optional<std::string> body,
+    boost::optional<std::string> content_type,
+    response_callback_function_type response_handler,
+    request_options const& options) {
+  NETWORK_MESSAGE("basic_client_facade::async_post(...)");
+  prepare_body(request, body, content_type);
+  base->async_request_skeleton(
+      request, "POST", true, response_handler, options);
+}
+
+void basic_client_facade::async_put(
+    request request,
+    boost::optional<std::string> body,
+    boost::optional<std::string> content_type,
+    response_callback_function_type response_handler,
+    request_options const& options) {
+  NETWORK_MESSAGE("basic_client_facade::async_put(...)");
+  prepare_body(request, body, content_type);
+  base->async_request_skeleton(
+      request, "PUT", true, response_handler, options);
+}
+
+void basic_client_facade::async_delete(
+    request const& request,
+    response_callback_function_type response_handler,
+    request_options const& options) {
+  NETWORK_MESSAGE("basic_client_facade::async_delete(...)");
+  base->async_request_skeleton(
+      request, "DELETE", true, response_handler, options);
+}
+
 void basic_client_facade::clear_resolved_cache() {
   NETWORK_MESSAGE("basic_client_facade::clear_resolved_cache()");
   base->clear_resolved_cache();
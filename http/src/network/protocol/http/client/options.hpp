@@ -68,6 +68,12 @@ class client_options {
   client_options& cache_resolved(bool setting = true);
   bool cache_resolved() const;
 
+  // The following options determine how long the client waits for a
+  // connection attempt before it also tries the next resolved address, in
+  // parallel (RFC 8305). The default is 250 milliseconds.
+  client_options& connection_attempt_delay(uint64_t milliseconds);
+  uint64_t connection_attempt_delay() const;
+
   // The following options provide the OpenSSL certificate paths to use.
   // Setting these options without OpenSSL support is valid, but the client
   // may throw an exception when attempting to make SSL connections. The
@@ -95,6 +101,20 @@ class client_options {
       std::shared_ptr<http::connection_factory> factory);
   std::shared_ptr<http::connection_factory> connection_factory() const;
 
+  // The following options limit how many connections a pooling connection
+  // manager keeps open between requests, in all and to the same host. The
+  // defaults are 64 and 8 connections.
+  client_options& max_idle_connections(std::size_t connections);
+  std::size_t max_idle_connections() const;
+  client_options& max_idle_connections_per_host(std::size_t connections);
+  std::size_t max_idle_connections_per_host() const;
+
+  // The following options determine how long a pooling connection manager
+  // keeps a connection open while it isn't used. The default is 30,000
+  // milliseconds (30 seconds).
+  client_options& idle_timeout(uint64_t milliseconds);
+  uint64_t idle_timeout() const;
+
   // More options go here...
 
  private:
@@ -20,17 +20,21 @@ class client_options_pimpl {
       : io_service_(0),
         follow_redirects_(false),
         cache_resolved_(false),
+        connection_attempt_delay_(250),
         openssl_certificate_paths_(),
         openssl_verify_paths_(),
         connection_manager_(),
-        connection_factory_() {}
+        connection_factory_(),
+        max_idle_connections_(64),
+        max_idle_connections_per_host_(8),
+        idle_timeout_(30 * 1000) {}
 
   client_options_pimpl* clone() const {
     return new (std::nothrow) client_options_pimpl(*this);
   }
 
   void io_service(boost::asio::io_service* io_service) {
-    io_service_ = io_service_;
+    io_service_ = io_service;
   }
 
   boost::asio::io_service* io_service() const { return io_service_; }
@@ -43,6 +47,14 @@ class client_options_pimpl {
 
   bool cache_resolved() const { return cache_resolved_; }
 
+  void connection_attempt_delay(uint64_t milliseconds) {
+    connection_attempt_delay_ = milliseconds;
+  }
+
+  uint64_t connection_attempt_delay() const {
+    return connection_attempt_delay_;
+  }
+
   void add_openssl_certificate_path(std::string const& path) {
     openssl_certificate_paths_.push_back(path);
   }
@@ -75,24 +87,49 @@ class client_options_pimpl {
     return connection_factory_;
   }
 
+  void max_idle_connections(std::size_t connections) {
+    max_idle_connections_ = connections;
+  }
+
+  std::size_t max_idle_connections() const { return max_idle_connections_; }
+
+  void max_idle_connections_per_host(std::size_t connections) {
+    max_idle_connections_per_host_ = connections;
+  }
+
+  std::size_t max_idle_connections_per_host() const {
+    return max_idle_connections_per_host_;
+  }
+
+  void idle_timeout(uint64_t milliseconds) { idle_timeout_ = milliseconds; }
+
+  uint64_t idle_timeout() const { return idle_timeout_; }
+
  private:
   client_options_pimpl(client_options_pimpl const& other)
       : io_service_(other.io_service_),
         follow_redirects_(other.follow_redirects_),
         cache_resolved_(other.cache_resolved_),
+        connection_attempt_delay_(other.connection_attempt_delay_),
         openssl_certificate_paths_(other.openssl_certificate_paths_),
         openssl_verify_paths_(other.openssl_verify_paths_),
         connection_manager_(other.connection_manager_),
-        connection_factory_(other.connection_factory_) {}
+        connection_factory_(other.connection_factory_),
+        max_idle_connections_(other.max_idle_connections_),
+        max_idle_connections_per_host_(other.max_idle_connections_per_host_),
+        idle_timeout_(other.idle_timeout_) {}
 
   client_options_pimpl& operator=(client_options_pimpl);  // cannot assign
 
   // Here's the list of members.
   boost::asio::io_service* io_service_;
   bool follow_redirects_, cache_resolved_;
+  uint64_t connection_attempt_delay_;
   std::list<std::string> openssl_certificate_paths_, openssl_verify_paths_;
   std::shared_ptr<http::connection_manager> connection_manager_;
   std::shared_ptr<http::connection_factory> connection_factory_;
+  std::size_t max_idle_connections_, max_idle_connections_per_host_;
+  uint64_t idle_timeout_;
 };
 
 client_options::client_options()
@@ -148,6 +185,16 @@ client_options& client_options::cache_resolved(bool cache_resolved) {
 
 bool client_options::cache_resolved() const { return pimpl->cache_resolved(); }
 
+client_options& client_options::connection_attempt_delay(
+    uint64_t milliseconds) {
+  pimpl->connection_attempt_delay(milliseconds);
+  return *this;
+}
+
+uint64_t client_options::connection_attempt_delay() const {
+  return pimpl->connection_attempt_delay();
+}
+
 client_options& client_options::add_openssl_certificate_path(
     std::string const& path) {
   pimpl->add_openssl_certificate_path(path);
@@ -191,6 +238,35 @@ std::shared_ptr<
   return pimpl->connection_factory();
 }
 
+client_options& client_options::max_idle_connections(
+    std::size_t connections) {
+  pimpl->max_idle_connections(connections);
+  return *this;
+}
+
+std::size_t client_options::max_idle_connections() const {
+  return pimpl->max_idle_connections();
+}
+
+client_options& client_options::max_idle_connections_per_host(
+    std::size_t connections) {
+  pimpl->max_idle_connections_per_host(connections);
+  return *this;
+}
+
+std::size_t client_options::max_idle_connections_per_host() const {
+  return pimpl->max_idle_connections_per_host();
+}
+
+client_options& client_options::idle_timeout(uint64_t milliseconds) {
+  pimpl->idle_timeout(milliseconds);
+  return *this;
+}
+
+uint64_t client_options::idle_timeout() const {
+  return pimpl->idle_timeout();
+}
+
 // End of client_options.
 
 class request_options_pimpl {
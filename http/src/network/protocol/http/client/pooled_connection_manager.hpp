@@ -0,0 +1,119 @@
+// Copyright 2013 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_POOLED_CONNECTION_MANAGER_HPP_20130620
+#define NETWORK_PROTOCOL_HTTP_CLIENT_POOLED_CONNECTION_MANAGER_HPP_20130620
+
+#include <cstddef>
+#include <memory>
+#include <network/protocol/http/client/connection_manager.hpp>
+#include <network/protocol/http/client/connection/connection_factory.hpp>
+
+namespace network {
+namespace http {
+
+/// Forward declaration of pooled_connection_manager_pimpl.
+struct pooled_connection_manager_pimpl;
+
+/// Forward declaration of the client_options class.
+class client_options;
+
+/** pooled_connection_manager
+ *
+ *  This connection manager keeps connections open once they are done with a
+ *  response, so that later requests to the same host and port, over the same
+ *  protocol, don't have to connect again. Connections that fail or that the
+ *  server wants closed are dropped, and connections that stay unused for
+ *  longer than client_options::idle_timeout() are closed.
+ */
+struct pooled_connection_manager : connection_manager {
+  /** statistics
+   *
+   *  Counts of what happened to the connections the manager handed out.
+   */
+  struct statistics {
+    statistics();
+    std::size_t created;    // connections made for a request
+    std::size_t reused;     // requests sent on an idle connection
+    std::size_t returned;   // connections kept once done with a response
+    std::size_t discarded;  // connections dropped after an error or a close
+    std::size_t expired;    // idle connections closed after the timeout
+    std::size_t idle;       // connections idle right now
+  };
+
+  /** Constructor
+   *
+   *  Args:
+   *    options: A properly constructed client_options instance. The
+   *             max_idle_connections(), max_idle_connections_per_host() and
+   *             idle_timeout() options limit the connections kept open.
+   */
+  explicit pooled_connection_manager(client_options const& options);
+
+  /** get_connection
+   *
+   * Args:
+   *   asio::io_service & service: The io_service instance to which the
+   *                               connection should be bound to. Idle
+   *                               connections are only reused for requests
+   *                               on the io_service they are bound to.
+   *   request_base const & request: The request object that includes the
+   *                                 information required by the connection.
+   *   client_options const & options: The options the connection is made
+   *                                   with. Idle connections are only
+   *                                   reused for requests with the same
+   *                                   connection options.
+   *
+   * Returns:
+   *   shared_ptr<client_connection> -- either an idle connection to the same
+   *   destination or a newly constructed connection configured to perform
+   *   the request.
+   */
+  virtual std::shared_ptr<client_connection> get_connection(
+      boost::asio::io_service& service,
+      request_base const& request,
+      client_options const& options)
+      override;
+
+  /** reset
+   *
+   * This function closes all the idle connections. Connections that are
+   * handling a request are kept when they are done with it.
+   */
+  virtual void reset() override;
+
+  /** clear_resolved_cache
+   *
+   * This function closes all the idle connections, so that the next requests
+   * resolve their host again.
+   */
+  virtual void clear_resolved_cache() override;
+
+  /** stats
+   *
+   * Returns the statistics gathered since the manager was constructed.
+   */
+  statistics stats() const;
+
+  /** Destructor.
+   */
+  virtual ~pooled_connection_manager() override;
+
+ protected:
+  // Connections hand themselves back after the manager may be gone, so they
+  // only hold a weak reference to the pimpl.
+  std::shared_ptr<pooled_connection_manager_pimpl> pimpl;
+
+ private:
+  /// Disabled copy constructor.
+  pooled_connection_manager(pooled_connection_manager const&);  // = delete
+  /// Disabled assignment operator.
+  pooled_connection_manager& operator=(pooled_connection_manager);  // = delete
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_POOLED_CONNECTION_MANAGER_HPP_20130620 */
@@ -0,0 +1,235 @@
+// Copyright 2013 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_POOLED_CONNECTION_MANAGER_IPP_20130620
+#define NETWORK_PROTOCOL_HTTP_CLIENT_POOLED_CONNECTION_MANAGER_IPP_20130620
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/lexical_cast.hpp>
+#include <network/protocol/http/client/pooled_connection_manager.hpp>
+#include <network/protocol/http/client/connection/simple_connection_factory.hpp>
+#include <network/protocol/http/client/client_connection.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/protocol/http/message/wrappers/host.hpp>
+#include <network/protocol/http/message/wrappers/port.hpp>
+#include <network/protocol/http/message/wrappers/uri.hpp>
+#include <network/detail/debug.hpp>
+
+namespace network {
+namespace http {
+
+struct pooled_connection_manager_pimpl
+    : std::enable_shared_from_this<pooled_connection_manager_pimpl> {
+  typedef std::chrono::steady_clock clock;
+  typedef pooled_connection_manager::statistics statistics;
+
+  pooled_connection_manager_pimpl(client_options const& options)
+      : connection_factory_(options.connection_factory()),
+        max_idle_(options.max_idle_connections()),
+        max_idle_per_host_(options.max_idle_connections_per_host()),
+        idle_timeout_(options.idle_timeout()) {
+    NETWORK_MESSAGE(
+        "pooled_connection_manager_pimpl::pooled_connection_manager_pimpl("
+        "client_options const &)");
+    if (!connection_factory_.get()) {
+      NETWORK_MESSAGE("creating simple connection factory");
+      connection_factory_.reset(new (std::nothrow) simple_connection_factory());
+    }
+  }
+
+  std::shared_ptr<client_connection> get_connection(
+      boost::asio::io_service& service,
+      request_base const& request,
+      client_options const& options) {
+    NETWORK_MESSAGE("pooled_connection_manager_pimpl::get_connection(...)");
+    std::string key = connection_key(request, options);
+    std::list<idle_connection> expired;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      expire(expired);
+      // The most recently used connections are at the front, and are the
+      // least likely to have been closed by the server.
+      for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+        if (it->service == &service && it->key == key) {
+          std::shared_ptr<client_connection> connection = it->connection;
+          idle_.erase(it);
+          ++stats_.reused;
+          NETWORK_MESSAGE("reusing idle connection to " << key);
+          return connection;
+        }
+      }
+      ++stats_.created;
+    }
+    NETWORK_MESSAGE("creating connection to " << key);
+    std::shared_ptr<client_connection> connection =
+        connection_factory_->create_connection(service, request, options);
+    std::weak_ptr<pooled_connection_manager_pimpl> self(shared_from_this());
+    boost::asio::io_service* service_ptr = &service;
+    connection->on_release(
+        [self, key, service_ptr](std::shared_ptr<client_connection> released) {
+          if (std::shared_ptr<pooled_connection_manager_pimpl> pool =
+                  self.lock())
+            pool->release(key, service_ptr, released);
+        });
+    return connection;
+  }
+
+  void release(std::string const& key,
+               boost::asio::io_service* service,
+               std::shared_ptr<client_connection> connection) {
+    NETWORK_MESSAGE("pooled_connection_manager_pimpl::release(...)");
+    std::list<idle_connection> dropped;
+    std::lock_guard<std::mutex> lock(mutex_);
+    expire(dropped);
+    if (!connection || idle_timeout_ == 0 || max_idle_per_host_ == 0 ||
+        max_idle_ == 0) {
+      ++stats_.discarded;
+      return;
+    }
+    // Keep at most max_idle_per_host_ connections to the destination,
+    // dropping the least recently used ones.
+    std::size_t same_host = 0;
+    for (auto it = idle_.begin(); it != idle_.end();) {
+      if (it->service == service && it->key == key &&
+          ++same_host >= max_idle_per_host_) {
+        dropped.splice(dropped.end(), idle_, it++);
+        ++stats_.discarded;
+      } else {
+        ++it;
+      }
+    }
+    while (idle_.size() >= max_idle_) {
+      dropped.splice(dropped.end(), idle_, --idle_.end());
+      ++stats_.discarded;
+    }
+    idle_connection idle = {key, service, connection, clock::now()};
+    idle_.push_front(idle);
+    ++stats_.returned;
+  }
+
+  void reset() {
+    std::list<idle_connection> closed;
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed.swap(idle_);
+  }
+
+  void clear_resolved_cache() { reset(); }
+
+  statistics stats() {
+    std::list<idle_connection> expired;
+    std::lock_guard<std::mutex> lock(mutex_);
+    expire(expired);
+    statistics stats = stats_;
+    stats.idle = idle_.size();
+    return stats;
+  }
+
+  ~pooled_connection_manager_pimpl() {
+    NETWORK_MESSAGE(
+        "pooled_connection_manager_pimpl::~pooled_connection_manager_pimpl()");
+  }
+
+ private:
+  struct idle_connection {
+    std::string key;
+    boost::asio::io_service* service;
+    std::shared_ptr<client_connection> connection;
+    clock::time_point since;
+  };
+
+  static std::string destination(request_base const& request) {
+    ::network::uri uri_ = http::uri(request);
+    std::string scheme =
+        uri_.scheme() ? boost::algorithm::to_lower_copy(std::string(
+                            *uri_.scheme())) : std::string("http");
+    std::string host_ = host(request);
+    boost::uint16_t port_ = port(request);
+    return scheme + "://" + boost::algorithm::to_lower_copy(host_) + ":" +
+           boost::lexical_cast<std::string>(port_);
+  }
+
+  // Connections are only reused for requests with the same options as the
+  // ones they were made with, as these determine how they connect.
+  static std::string connection_key(request_base const& request,
+                                    client_options const& options) {
+    std::string key = destination(request);
+    key += options.follow_redirects() ? " redirects" : " no-redirects";
+    key += options.cache_resolved() ? " cached" : " uncached";
+    key += " delay=" +
+           boost::lexical_cast<std::string>(options.connection_attempt_delay());
+    for (std::string const& path : options.openssl_certificate_paths())
+      key += " certificate=" + path;
+    for (std::string const& path : options.openssl_verify_paths())
+      key += " verify=" + path;
+    return key;
+  }
+
+  // Moves the connections that have been idle for too long to expired. The
+  // oldest connections are at the back. The connections are closed when
+  // expired goes away, which should be once the lock is released.
+  void expire(std::list<idle_connection>& expired) {
+    clock::time_point deadline =
+        clock::now() - std::chrono::milliseconds(idle_timeout_);
+    while (!idle_.empty() && idle_.back().since <= deadline) {
+      expired.splice(expired.end(), idle_, --idle_.end());
+      ++stats_.expired;
+    }
+  }
+
+  std::shared_ptr<connection_factory> connection_factory_;
+  std::size_t max_idle_, max_idle_per_host_;
+  uint64_t idle_timeout_;
+  std::mutex mutex_;
+  std::list<idle_connection> idle_;
+  statistics stats_;
+};
+
+pooled_connection_manager::statistics::statistics()
+    : created(0), reused(0), returned(0), discarded(0), expired(0), idle(0) {}
+
+pooled_connection_manager::pooled_connection_manager(
+    client_options const& options)
+    : pimpl(std::make_shared<pooled_connection_manager_pimpl>(options)) {
+  NETWORK_MESSAGE("pooled_connection_manager::pooled_connection_manager("
+                  "client_options const &)");
+}
+
+std::shared_ptr<client_connection> pooled_connection_manager::get_connection(
+    boost::asio::io_service& service,
+    request_base const& request,
+    client_options const& options) {
+  NETWORK_MESSAGE("pooled_connection_manager::get_connection(...)");
+  return pimpl->get_connection(service, request, options);
+}
+
+void pooled_connection_manager::reset() {
+  NETWORK_MESSAGE("pooled_connection_manager::reset()");
+  pimpl->reset();
+}
+
+void pooled_connection_manager::clear_resolved_cache() {
+  NETWORK_MESSAGE("pooled_connection_manager::clear_resolved_cache()");
+  pimpl->clear_resolved_cache();
+}
+
+pooled_connection_manager::statistics pooled_connection_manager::stats()
+    const {
+  return pimpl->stats();
+}
+
+pooled_connection_manager::~pooled_connection_manager() {
+  NETWORK_MESSAGE("pooled_connection_manager::~pooled_connection_manager()");
+  // Connections that are handling a request find the pool gone when they
+  // are done, and close.
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_POOLED_CONNECTION_MANAGER_IPP_20130620 */
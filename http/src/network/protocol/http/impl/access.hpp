@@ -7,9 +7,7 @@
 #ifndef NETWORK_PROTOCOL_HTTP_IMPL_ACCESS_HPP_20111202
 #define NETWORK_PROTOCOL_HTTP_IMPL_ACCESS_HPP_20111202
 
-#include <future>
-#include <map>
-#include <boost/cstdint.hpp>
+#include <memory>
 
 namespace network {
 namespace http {
@@ -18,16 +16,11 @@ struct response;
 
 namespace impl {
 
+struct response_state;
+
 struct setter_access {
-  void set_version_promise(response& r, std::promise<std::string>& p);
-  void set_status_promise(response& r, std::promise<boost::uint16_t>& p);
-  void set_status_message_promise(response& r, std::promise<std::string>& p);
-  void set_headers_promise(
-      response& r,
-      std::promise<std::multimap<std::string, std::string>>& p);
-  void set_source_promise(response& r, std::promise<std::string>& p);
-  void set_destination_promise(response& r, std::promise<std::string>& p);
-  void set_body_promise(response& r, std::promise<std::string>& p);
+  void set_state(response& r, std::shared_ptr<response_state> state);
+  std::shared_ptr<response_state> get_state(response const& r);
 };
 
 }       // namespace impl
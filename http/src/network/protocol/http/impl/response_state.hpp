@@ -0,0 +1,130 @@
+// Copyright 2013 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_IMPL_RESPONSE_STATE_HPP_20130624
+#define NETWORK_PROTOCOL_HTTP_IMPL_RESPONSE_STATE_HPP_20130624
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <boost/cstdint.hpp>
+
+namespace network {
+namespace http {
+namespace impl {
+
+// The parts of a response that a client connection reads, shared with the
+// response objects it hands out. The connection fills it in two steps, once
+// the headers have been read and once the body has, and readers wait for
+// the step that has the part they want. An error fails the steps that
+// haven't been reached yet.
+struct response_state {
+  typedef std::function<void(std::exception_ptr)> completion_handler;
+
+  response_state() : status(0), stage_(pending) {}
+
+  void set_headers(std::string const& version,
+                   boost::uint16_t status,
+                   std::string const& status_message,
+                   std::multimap<std::string, std::string>& headers) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      this->version = version;
+      this->status = status;
+      this->status_message = status_message;
+      this->headers.swap(headers);
+      stage_ = headers_read;
+    }
+    // Readers are woken once the lock is released, or they would only wake
+    // up to wait for it.
+    ready_.notify_all();
+  }
+
+  void set_body(std::string& body) {
+    completion_handler handler;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      this->body.swap(body);
+      stage_ = body_read;
+      handler.swap(completed_);
+    }
+    ready_.notify_all();
+    if (handler)
+      handler(std::exception_ptr());
+  }
+
+  void set_error(std::exception_ptr error) {
+    completion_handler handler;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stage_ == body_read || error_)
+        return;
+      error_ = error;
+      handler.swap(completed_);
+    }
+    ready_.notify_all();
+    if (handler)
+      handler(error);
+  }
+
+  // Calls the handler once, when the body has been read or the response has
+  // failed, with the error it failed with. The handler is called by whoever
+  // completes the response, or right away if it already is complete, so it
+  // shouldn't block.
+  void when_complete(completion_handler handler) {
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stage_ < body_read && !error_) {
+        completed_.swap(handler);
+        return;
+      }
+      if (stage_ < body_read)
+        error = error_;
+    }
+    handler(error);
+  }
+
+  // These wait until the parts are there, and throw the error the response
+  // failed with if they never will be.
+  void wait_for_headers() const { wait(headers_read); }
+  void wait_for_body() const { wait(body_read); }
+
+  // Only read these once the step that sets them is done.
+  std::string version;
+  boost::uint16_t status;
+  std::string status_message;
+  std::multimap<std::string, std::string> headers;
+  std::string source, destination, body;
+
+ private:
+  enum stage { pending, headers_read, body_read };
+
+  response_state(response_state const&);  // = delete
+  response_state& operator=(response_state const&);  // = delete
+
+  void wait(stage until) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (stage_ < until && !error_)
+      ready_.wait(lock);
+    if (stage_ < until)
+      std::rethrow_exception(error_);
+  }
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable ready_;
+  stage stage_;
+  std::exception_ptr error_;
+  completion_handler completed_;
+};
+
+}  // namespace impl
+}  // namespace http
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_IMPL_RESPONSE_STATE_HPP_20130624
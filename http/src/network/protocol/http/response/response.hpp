@@ -61,16 +61,10 @@ struct response : response_base {
 
  private:
   friend struct impl::setter_access;  // Hide access through accessor class.
-  // These methods are unique to the response type which will allow for creating
-  // promises that can be set appropriately.
-  void set_version_promise(std::promise<std::string>&);
-  void set_status_promise(std::promise<uint16_t>&);
-  void set_status_message_promise(std::promise<std::string>&);
-  void set_headers_promise(
-      std::promise<std::multimap<std::string, std::string>>&);
-  void set_source_promise(std::promise<std::string>&);
-  void set_destination_promise(std::promise<std::string>&);
-  void set_body_promise(std::promise<std::string>&);
+  // This method is unique to the response type which will allow for sharing
+  // the state of a response that is being read.
+  void set_state(std::shared_ptr<impl::response_state>);
+  std::shared_ptr<impl::response_state> get_state() const;
 
   response_pimpl* pimpl_;
 };
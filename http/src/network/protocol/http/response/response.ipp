@@ -8,7 +8,9 @@
 #define NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_IPP_20111206
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/optional.hpp>
 #include <network/protocol/http/response/response.hpp>
+#include <network/protocol/http/impl/response_state.hpp>
 
 #include <algorithm>
 #include <set>
@@ -23,31 +25,30 @@ struct response_pimpl {
   response_pimpl* clone() { return new (std::nothrow) response_pimpl(*this); }
 
   void set_destination(std::string const& destination) {
-    std::promise<std::string> destination_promise;
-    destination_promise.set_value(destination);
-    std::future<std::string> tmp_future = destination_promise.get_future();
-    destination_future_ = std::move(tmp_future);
+    destination_ = destination;
   }
 
   void get_destination(std::string& destination) {
-    if (!destination_future_.valid()) {
-      destination = "";
+    if (destination_) {
+      destination = *destination_;
+    } else if (state_) {
+      state_->wait_for_body();
+      destination = state_->destination;
     } else {
-      destination = destination_future_.get();
+      destination = "";
     }
   }
 
-  void set_source(std::string const& source) {
-    std::promise<std::string> source_promise;
-    source_promise.set_value(source);
-    source_future_ = source_promise.get_future().share();
-  }
+  void set_source(std::string const& source) { source_ = source; }
 
   void get_source(std::string& source) {
-    if (!source_future_.valid()) {
-      source = "";
+    if (source_) {
+      source = *source_;
+    } else if (state_) {
+      state_->wait_for_body();
+      source = state_->source;
     } else {
-      source = source_future_.get();
+      source = "";
     }
   }
 
@@ -60,35 +61,20 @@ struct response_pimpl {
   }
 
   void remove_headers() {
-    if (!headers_future_.valid()) {
-      std::promise<std::multimap<std::string, std::string>> headers_promise;
-      headers_promise.set_value(std::multimap<std::string, std::string>());
-      std::future<std::multimap<std::string, std::string>> tmp =
-          headers_promise.get_future();
+    if (!state_) {
       std::multimap<std::string, std::string>().swap(added_headers_);
       std::set<std::string>().swap(removed_headers_);
-      headers_future_ = std::move(tmp);
     }
   }
 
   void get_headers(
       std::function<void(std::string const&, std::string const&)> inserter) {
-    std::multimap<std::string, std::string>::const_iterator it;
-    if (!headers_future_.valid()) {
-      it = added_headers_.begin();
-      for (; it != added_headers_.end(); ++it) {
-        if (removed_headers_.find(it->first) == removed_headers_.end()) {
-          inserter(it->first, it->second);
-        }
-      }
-    } else {
-      std::multimap<std::string, std::string> const& headers_ =
-          headers_future_.get();
-      it = headers_.begin();
-      for (; it != headers_.end(); ++it) {
-        if (removed_headers_.find(it->first) == removed_headers_.end()) {
-          inserter(it->first, it->second);
-        }
+    std::multimap<std::string, std::string> const& headers_ = headers();
+    std::multimap<std::string, std::string>::const_iterator it =
+        headers_.begin();
+    for (; it != headers_.end(); ++it) {
+      if (removed_headers_.find(it->first) == removed_headers_.end()) {
+        inserter(it->first, it->second);
       }
     }
   }
@@ -100,14 +86,7 @@ struct response_pimpl {
     
     std::pair<std::multimap<std::string, std::string>::const_iterator,
               std::multimap<std::string, std::string>::const_iterator> 
-        range;
-    if (!headers_future_.valid()) {
-      range = added_headers_.equal_range(name);
-    } else {
-      std::multimap<std::string, std::string> const& headers_ = 
-          headers_future_.get();
-      range = headers_.equal_range(name);
-    }
+        range = headers().equal_range(name);
     
     for (auto it = range.first; it != range.second; ++it) {
       inserter(it->first, it->second);
@@ -119,21 +98,16 @@ struct response_pimpl {
     /* FIXME: Do something! */
   }
 
-  void set_body(std::string const& body) {
-    std::promise<std::string> body_promise;
-    body_promise.set_value(body);
-    std::future<std::string> tmp_future = body_promise.get_future();
-    body_future_ = std::move(tmp_future);
-  }
+  void set_body(std::string const& body) { body_ = body; }
 
   void append_body(std::string const& data) { /* FIXME: Do something! */
   }
 
   void get_body(std::string& body) {
-    if (!body_future_.valid()) {
+    if (!body_ && !state_) {
       body = "";
     } else {
-      std::string partial_parsed = body_future_.get();
+      std::string partial_parsed = raw_body();
       bool chunked = false;
       auto check = [&](std::string const& key, std::string const& value) {
         chunked = chunked || boost::iequals(value, "chunked");
@@ -169,152 +143,78 @@ struct response_pimpl {
       size_t size) { /* FIXME: Do something! */
   }
 
-  void set_status(boost::uint16_t status) {
-    std::promise<boost::uint16_t> status_promise;
-    status_promise.set_value(status);
-    std::future<boost::uint16_t> tmp_future = status_promise.get_future();
-    status_future_ = std::move(tmp_future);
-  }
+  void set_status(boost::uint16_t status) { status_ = status; }
 
   void get_status(boost::uint16_t& status) {
-    if (!status_future_.valid()) {
-      status = 0u;
+    if (status_) {
+      status = *status_;
+    } else if (state_) {
+      state_->wait_for_headers();
+      status = state_->status;
     } else {
-      status = status_future_.get();
+      status = 0u;
     }
   }
 
   void set_status_message(std::string const& status_message) {
-    std::promise<std::string> status_message_promise_;
-    status_message_promise_.set_value(status_message);
-    std::future<std::string> tmp_future = status_message_promise_.get_future();
-    status_message_future_ = std::move(tmp_future);
+    status_message_ = status_message;
   }
 
   void get_status_message(std::string& status_message) {
-    if (!status_message_future_.valid()) {
-      status_message = "";
+    if (status_message_) {
+      status_message = *status_message_;
+    } else if (state_) {
+      state_->wait_for_headers();
+      status_message = state_->status_message;
     } else {
-      status_message = status_message_future_.get();
+      status_message = "";
     }
   }
 
-  void set_version(std::string const& version) {
-    std::promise<std::string> version_promise;
-    version_promise.set_value(version);
-    std::future<std::string> tmp_future = version_promise.get_future();
-    version_future_ = std::move(tmp_future);
-  }
+  void set_version(std::string const& version) { version_ = version; }
 
   void get_version(std::string& version) {
-    if (!version_future_.valid()) {
-      version = "";
+    if (version_) {
+      version = *version_;
+    } else if (state_) {
+      state_->wait_for_headers();
+      version = state_->version;
     } else {
-      version = version_future_.get();
+      version = "";
     }
   }
 
-  void set_source_promise(std::promise<std::string>& promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    source_future_ = std::move(tmp_future);
-  }
-
-  void set_destination_promise(std::promise<std::string>& promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    destination_future_ = std::move(tmp_future);
-  }
-
-  void set_headers_promise(
-      std::promise<std::multimap<std::string, std::string>>& promise_) {
-    std::future<std::multimap<std::string, std::string>> tmp_future =
-        promise_.get_future();
-    headers_future_ = std::move(tmp_future);
-  }
-
-  void set_status_promise(std::promise<boost::uint16_t>& promise_) {
-    std::future<boost::uint16_t> tmp_future = promise_.get_future();
-    status_future_ = std::move(tmp_future);
-  }
-
-  void set_status_message_promise(std::promise<std::string>& promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    status_message_future_ = std::move(tmp_future);
-  }
-
-  void set_version_promise(std::promise<std::string>& promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    version_future_ = std::move(tmp_future);
+  void set_state(std::shared_ptr<impl::response_state> state) {
+    state_ = state;
   }
 
-  void set_body_promise(std::promise<std::string>& promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    body_future_ = std::move(tmp_future);
-  }
+  std::shared_ptr<impl::response_state> get_state() const { return state_; }
 
-  bool equals(response_pimpl const& other) {
-    if (source_future_.valid()) {
-      if (!other.source_future_.valid())
-        return false;
-      if (source_future_.get() != other.source_future_.get())
-        return false;
-    } else {
-      if (other.source_future_.valid())
-        return false;
-    }
-    if (destination_future_.valid()) {
-      if (!other.destination_future_.valid())
-        return false;
-      if (destination_future_.get() != other.destination_future_.get())
-        return false;
-    } else {
-      if (other.destination_future_.valid())
-        return false;
-    }
-    if (headers_future_.valid()) {
-      if (!other.headers_future_.valid())
-        return false;
-      if (headers_future_.get() != other.headers_future_.get())
-        return false;
-    } else {
-      if (other.headers_future_.valid())
-        return false;
-    }
-    if (status_future_.valid()) {
-      if (!other.status_future_.valid())
-        return false;
-      if (status_future_.get() != other.status_future_.get())
-        return false;
-    } else {
-      if (other.status_future_.valid())
-        return false;
-    }
-    if (status_message_future_.valid()) {
-      if (!other.status_message_future_.valid())
-        return false;
-      if (status_message_future_.get() != other.status_message_future_.get())
-        return false;
-    } else {
-      if (other.status_message_future_.valid())
-        return false;
-    }
-    if (version_future_.valid()) {
-      if (!other.version_future_.valid())
-        return false;
-      if (version_future_.get() != other.version_future_.get())
-        return false;
-    } else {
-      if (other.version_future_.valid())
-        return false;
-    }
-    if (body_future_.valid()) {
-      if (!other.body_future_.valid())
-        return false;
-      if (body_future_.get() != other.body_future_.get())
-        return false;
-    } else {
-      if (other.body_future_.valid())
-        return false;
-    }
+  bool equals(response_pimpl& other) {
+    std::string value, other_value;
+    get_source(value);
+    other.get_source(other_value);
+    if (value != other_value)
+      return false;
+    get_destination(value);
+    other.get_destination(other_value);
+    if (value != other_value)
+      return false;
+    get_status_message(value);
+    other.get_status_message(other_value);
+    if (value != other_value)
+      return false;
+    get_version(value);
+    other.get_version(other_value);
+    if (value != other_value)
+      return false;
+    boost::uint16_t status, other_status;
+    get_status(status);
+    other.get_status(other_status);
+    if (status != other_status)
+      return false;
+    if (raw_body() != other.raw_body() || headers() != other.headers())
+      return false;
     if (other.added_headers_ != added_headers_ ||
         other.removed_headers_ != removed_headers_)
       return false;
@@ -322,26 +222,40 @@ struct response_pimpl {
   }
 
  private:
-  mutable std::shared_future<std::string> source_future_;
-  mutable std::shared_future<std::string> destination_future_;
-  mutable std::shared_future<
-      std::multimap<std::string, std::string>> headers_future_;
-  mutable std::shared_future<boost::uint16_t> status_future_;
-  mutable std::shared_future<std::string> status_message_future_;
-  mutable std::shared_future<std::string> version_future_;
-  mutable std::shared_future<std::string> body_future_;
+  // The state is shared with the connection reading the response, and with
+  // copies of this response. Values set on this response take precedence.
+  std::shared_ptr<impl::response_state> state_;
+  boost::optional<std::string> source_, destination_, status_message_,
+      version_, body_;
+  boost::optional<boost::uint16_t> status_;
   // TODO: use unordered_map and unordered_set here.
   std::multimap<std::string, std::string> added_headers_;
   std::set<std::string> removed_headers_;
 
+  std::multimap<std::string, std::string> const& headers() {
+    if (!state_)
+      return added_headers_;
+    state_->wait_for_headers();
+    return state_->headers;
+  }
+
+  std::string raw_body() {
+    if (body_)
+      return *body_;
+    if (!state_)
+      return std::string();
+    state_->wait_for_body();
+    return state_->body;
+  }
+
   response_pimpl(response_pimpl const& other)
-      : source_future_(other.source_future_),
-        destination_future_(other.destination_future_),
-        headers_future_(other.headers_future_),
-        status_future_(other.status_future_),
-        status_message_future_(other.status_message_future_),
-        version_future_(other.version_future_),
-        body_future_(other.body_future_),
+      : state_(other.state_),
+        source_(other.source_),
+        destination_(other.destination_),
+        status_message_(other.status_message_),
+        version_(other.version_),
+        body_(other.body_),
+        status_(other.status_),
         added_headers_(other.added_headers_),
         removed_headers_(other.removed_headers_) {}
 };
@@ -447,33 +361,12 @@ void response::get_version(std::string& version) const {
 
 response::~response() { delete pimpl_; }
 
-void response::set_version_promise(std::promise<std::string>& promise) {
-  return pimpl_->set_version_promise(promise);
-}
-
-void response::set_status_promise(std::promise<boost::uint16_t>& promise) {
-  return pimpl_->set_status_promise(promise);
-}
-
-void response::set_status_message_promise(std::promise<std::string>& promise) {
-  return pimpl_->set_status_message_promise(promise);
-}
-
-void response::set_headers_promise(
-    std::promise<std::multimap<std::string, std::string>>& promise) {
-  return pimpl_->set_headers_promise(promise);
-}
-
-void response::set_source_promise(std::promise<std::string>& promise) {
-  return pimpl_->set_source_promise(promise);
-}
-
-void response::set_destination_promise(std::promise<std::string>& promise) {
-  return pimpl_->set_destination_promise(promise);
+void response::set_state(std::shared_ptr<impl::response_state> state) {
+  return pimpl_->set_state(state);
 }
 
-void response::set_body_promise(std::promise<std::string>& promise) {
-  return pimpl_->set_body_promise(promise);
+std::shared_ptr<impl::response_state> response::get_state() const {
+  return pimpl_->get_state();
 }
 
 }       // namespace http
@@ -11,12 +11,20 @@
 #define NETWORK_HTTP_SERVER_HPP_
 
 #include <boost/shared_ptr.hpp>
+#include <functional>
+#include <string>
 
 namespace network {
-namespace utils {
+namespace concurrency {
 
 struct thread_pool;
 
+}  // namespace concurrency
+
+namespace utils {
+
+typedef ::network::concurrency::thread_pool thread_pool;
+
 }  // namespace utils
 
 }  // namespace network
@@ -34,9 +42,20 @@ struct response;
 template <class SyncHandler> class sync_server {
  public:
   sync_server(server_options const& options, SyncHandler& handler);
+  // Request body chunks are passed to body_handler as they are read instead
+  // of being buffered in the request; handler is called once the whole body
+  // has been read.
+  sync_server(server_options const& options,
+              SyncHandler& handler,
+              std::function<void(http::request const&, std::string const&)>
+                  body_handler);
   void run();
   void stop();
   void listen();
+  // Stops accepting connections and lets the open ones finish the requests
+  // they are handling, then stops. Gives up after the server's
+  // drain_timeout.
+  void drain();
   ~sync_server();
 
   typedef http::request request;
@@ -55,6 +74,10 @@ template <class AsyncHandler> class async_server {
   void run();
   void stop();
   void listen();
+  // Stops accepting connections and lets the open ones finish the requests
+  // they are handling, telling keep-alive clients that their connection is
+  // being closed, then stops. Gives up after the server's drain_timeout.
+  void drain();
   ~async_server();
 
   typedef http::request request;
@@ -8,15 +8,25 @@
 #define NETWORK_PROTOCOL_HTTP_SERVER_ASYNC_IMPL_20120318
 
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <network/protocol/http/server/options.hpp>
 #include <network/protocol/http/server/impl/socket_options_setter.hpp>
+#include <network/protocol/http/server/impl/free_list.hpp>
+#include <http/server/default_connection_manager.hpp>
 
 namespace network {
-namespace utils {
+namespace concurrency {
 struct thread_pool;
-}  // namespace util
+}  // namespace concurrency
+namespace utils {
+typedef ::network::concurrency::thread_pool thread_pool;
+}  // namespace utils
 }  // namespace network
 
 namespace network {
@@ -25,6 +35,7 @@ namespace http {
 struct request;
 
 class async_server_connection;
+class async_server_read_buffers;
 
 class async_server_impl : protected socket_options_setter {
  public:
@@ -36,21 +47,67 @@ class async_server_impl : protected socket_options_setter {
   void run();
   void stop();
   void listen();
+  void drain();
 
  private:
+  // An accept kept pending on an acceptor, with the connection allocated
+  // for it ahead of time.
+  struct pending_accept {
+    explicit pending_accept(boost::asio::io_service& service);
+    std::shared_ptr<async_server_connection> connection;
+    boost::asio::steady_timer retry_timer;
+    std::chrono::milliseconds retry_delay;
+  };
+
+  // Connections that have been closed, kept to be reused by the shard they
+  // were accepted on.
+  typedef free_list<async_server_connection> spare_connection_list;
+
+  // Deleter for accepted connections, which hands them back to the spare
+  // connections of their shard.
+  struct recycle_connection {
+    explicit recycle_connection(std::shared_ptr<spare_connection_list> spares);
+    void operator()(async_server_connection* connection) const;
+    std::shared_ptr<spare_connection_list> spares;
+  };
+
+  // An acceptor and the io_service its connections run on. Every shard but
+  // the first owns its io_service and the thread that runs it.
+  struct acceptor_shard {
+    acceptor_shard(boost::asio::io_service* shared_service,
+                   std::size_t spare_connections);
+    std::unique_ptr<boost::asio::io_service> owned_service;
+    boost::asio::io_service& service;
+    boost::asio::ip::tcp::acceptor acceptor;
+    std::vector<std::unique_ptr<pending_accept>> accepts;
+    std::shared_ptr<spare_connection_list> spare_connections;
+    std::thread thread;
+  };
+
   server_options options_;
   std::string address_, port_;
   boost::asio::io_service* service_;
-  boost::asio::ip::tcp::acceptor* acceptor_;
-  std::shared_ptr<async_server_connection> new_connection_;
+  std::vector<std::unique_ptr<acceptor_shard>> shards_;
+  std::shared_ptr<async_server_read_buffers> read_buffers_;
+  default_connection_manager connections_;
+  std::unique_ptr<boost::asio::steady_timer> drain_timer_;
   std::mutex listening_mutex_, stopping_mutex_;
   std::function<void(request const&, connection_ptr)> handler_;
   utils::thread_pool& pool_;
   bool listening_, owned_service_, stopping_;
 
   void handle_stop();
+  void stop_accepting();
+  void handle_drain_timeout(boost::system::error_code const& ec);
   void start_listening();
-  void handle_accept(boost::system::error_code const& ec);
+  void accept(std::size_t shard, std::size_t slot);
+  void async_accept(std::size_t shard, std::size_t slot);
+  void handle_accept(std::size_t shard,
+                     std::size_t slot,
+                     boost::system::error_code const& ec);
+  void handle_accept_retry(std::size_t shard,
+                           std::size_t slot,
+                           boost::system::error_code const& ec);
 };
 
 }       // namespace http
@@ -9,15 +9,64 @@
 
 #include <network/protocol/http/server/async_impl.hpp>
 #include <network/protocol/http/server/connection/async.hpp>
+#include <network/protocol/http/server/impl/accept_retry.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <algorithm>
 #include <functional>
+#include <thread>
 #include <network/detail/debug.hpp>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace network {
 namespace http {
 
+namespace {
+
+// Pins the calling thread to a CPU, picked round-robin by shard.
+void pin_to_cpu(std::size_t shard) {
+#if defined(__linux__)
+  unsigned cpus = std::thread::hardware_concurrency();
+  if (cpus == 0)
+    return;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(shard % cpus, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+}  // namespace
+
+async_server_impl::pending_accept::pending_accept(
+    boost::asio::io_service& service)
+    : connection(), retry_timer(service), retry_delay(0) {}
+
+async_server_impl::recycle_connection::recycle_connection(
+    std::shared_ptr<spare_connection_list> spares)
+    : spares(spares) {}
+
+void async_server_impl::recycle_connection::operator()(
+    async_server_connection* connection) const {
+  connection->recycle();
+  spares->give(connection);
+}
+
+async_server_impl::acceptor_shard::acceptor_shard(
+    boost::asio::io_service* shared_service,
+    std::size_t spare_connections)
+    : owned_service(shared_service ? 0 : new boost::asio::io_service),
+      service(shared_service ? *shared_service : *owned_service),
+      acceptor(service),
+      accepts(),
+      spare_connections(
+          std::make_shared<spare_connection_list>(spare_connections)),
+      thread() {}
+
 async_server_impl::async_server_impl(
     server_options const& options,
     std::function<void(request const&, connection_ptr)> handler,
@@ -26,8 +75,10 @@ async_server_impl::async_server_impl(
       address_(options.address()),
       port_(options.port()),
       service_(options.io_service()),
-      acceptor_(0),
-      new_connection_(),
+      shards_(),
+      read_buffers_(),
+      connections_(),
+      drain_timer_(),
       listening_mutex_(),
       stopping_mutex_(),
       handler_(handler),
@@ -40,33 +91,120 @@ async_server_impl::async_server_impl(
     owned_service_ = true;
   }
   BOOST_ASSERT(service_ != 0);
-  acceptor_ = new boost::asio::ip::tcp::acceptor(*service_);
-  BOOST_ASSERT(acceptor_ != 0);
+  drain_timer_.reset(new boost::asio::steady_timer(*service_));
+  int shards = 1;
+#if defined(SO_REUSEPORT)
+  // Without SO_REUSEPORT the acceptors can't share the port.
+  shards = std::max(options.acceptor_shards(), 1);
+#endif
+  std::size_t spares = std::max(options.spare_connections(), 0);
+  shards_.emplace_back(new acceptor_shard(service_, spares));
+  for (int shard = 1; shard < shards; ++shard)
+    shards_.emplace_back(new acceptor_shard(0, spares));
+  read_buffers_ = std::make_shared<async_server_read_buffers>(
+      std::max(options.spare_read_buffers(), 0));
+  int accepts = std::max(options.pending_accepts(), 1);
+  for (std::size_t shard = 0; shard < shards_.size(); ++shard) {
+    for (int slot = 0; slot < accepts; ++slot) {
+      shards_[shard]->accepts.emplace_back(
+          new pending_accept(shards_[shard]->service));
+    }
+  }
 }
 
 async_server_impl::~async_server_impl() {
+  for (std::size_t shard = 1; shard < shards_.size(); ++shard) {
+    if (shards_[shard]->thread.joinable()) {
+      shards_[shard]->service.stop();
+      shards_[shard]->thread.join();
+    }
+  }
+  {
+    // Connections released while the io_services are destroyed mustn't
+    // try to stop them once a drain is done.
+    std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
+    stopping_ = false;
+  }
+  drain_timer_.reset();
+  // Connections released from here on are deleted while their io_service
+  // is still around.
+  for (std::size_t shard = 0; shard < shards_.size(); ++shard)
+    shards_[shard]->spare_connections->close();
+  shards_.clear();
   if (owned_service_)
     delete service_;
-  delete acceptor_;
 }
 
 void async_server_impl::run() {
   listen();
+  for (std::size_t shard = 1; shard < shards_.size(); ++shard) {
+    acceptor_shard& current = *shards_[shard];
+    if (current.thread.joinable())
+      continue;
+    bool pin = options_.pin_acceptor_threads();
+    current.thread = std::thread([&current, shard, pin]() {
+      if (pin)
+        pin_to_cpu(shard);
+      current.service.run();
+    });
+  }
   service_->run();
+  for (std::size_t shard = 1; shard < shards_.size(); ++shard) {
+    if (shards_[shard]->thread.joinable())
+      shards_[shard]->thread.join();
+  }
 }
 
 void async_server_impl::stop() {
   std::lock_guard<std::mutex> listening_lock(listening_mutex_);
-  if (listening_) {
-    std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
-    stopping_ = true;
-    boost::system::error_code ignored;
-    acceptor_->close(ignored);
-    listening_ = false;
+  // A server that's being drained can still be stopped right away.
+  if (listening_ || connections_.draining()) {
+    stop_accepting();
     service_->post(boost::bind(&async_server_impl::handle_stop, this));
   }
 }
 
+void async_server_impl::drain() {
+  std::lock_guard<std::mutex> listening_lock(listening_mutex_);
+  if (!listening_)
+    return;
+  stop_accepting();
+  NETWORK_MESSAGE("draining " << connections_.size() << " connections on "
+                              << address_ << ':' << port_);
+  if (options_.drain_timeout() > 0) {
+    drain_timer_->expires_from_now(
+        std::chrono::seconds(options_.drain_timeout()));
+    drain_timer_->async_wait(
+        boost::bind(&async_server_impl::handle_drain_timeout,
+                    this,
+                    boost::asio::placeholders::error));
+  }
+  connections_.drain(boost::bind(&async_server_impl::handle_stop, this));
+}
+
+// listening_mutex_ must be held.
+void async_server_impl::stop_accepting() {
+  std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
+  stopping_ = true;
+  boost::system::error_code ignored;
+  for (std::size_t shard = 0; shard < shards_.size(); ++shard) {
+    shards_[shard]->acceptor.close(ignored);
+    for (std::size_t slot = 0; slot < shards_[shard]->accepts.size(); ++slot)
+      shards_[shard]->accepts[slot]->retry_timer.cancel(ignored);
+  }
+  listening_ = false;
+}
+
+void async_server_impl::handle_drain_timeout(
+    boost::system::error_code const& ec) {
+  if (ec)
+    return;
+  NETWORK_MESSAGE("stopping with " << connections_.size()
+                                   << " connections still open on "
+                                   << address_ << ':' << port_);
+  handle_stop();
+}
+
 void async_server_impl::listen() {
   std::lock_guard<std::mutex> listening_lock(listening_mutex_);
   NETWORK_MESSAGE("listening on " << address_ << ':' << port_);
@@ -83,11 +221,44 @@ void async_server_impl::handle_stop() {
   std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
   // A user may have stopped listening again before the stop command is
   // reached.
-  if (stopping_)
-    service_->stop();
+  if (stopping_) {
+    for (std::size_t shard = 0; shard < shards_.size(); ++shard)
+      shards_[shard]->service.stop();
+  }
+}
+
+void async_server_impl::accept(std::size_t shard, std::size_t slot) {
+  acceptor_shard& current = *shards_[shard];
+  async_server_connection* connection = current.spare_connections->take();
+  if (!connection) {
+    connection =
+        new async_server_connection(current.service,
+                                    handler_,
+                                    pool_,
+                                    options_.max_requests_per_connection(),
+                                    options_.idle_timeout(),
+                                    options_.inline_handlers(),
+                                    read_buffers_);
+  }
+  current.accepts[slot]->connection.reset(
+      connection, recycle_connection(current.spare_connections));
+  async_accept(shard, slot);
+}
+
+void async_server_impl::async_accept(std::size_t shard, std::size_t slot) {
+  acceptor_shard& current = *shards_[shard];
+  current.acceptor.async_accept(
+      current.accepts[slot]->connection->socket(),
+      boost::bind(&async_server_impl::handle_accept,
+                  this,
+                  shard,
+                  slot,
+                  boost::asio::placeholders::error));
 }
 
-void async_server_impl::handle_accept(boost::system::error_code const& ec) {
+void async_server_impl::handle_accept(std::size_t shard,
+                                      std::size_t slot,
+                                      boost::system::error_code const& ec) {
   {
     std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
     // We dont want to add another handler instance, and we dont want to know
@@ -95,24 +266,58 @@ void async_server_impl::handle_accept(boost::system::error_code const& ec) {
     if (stopping_)
       return;
   }
+  pending_accept& pending = *shards_[shard]->accepts[slot];
   if (!ec) {
-    set_socket_options(options_, new_connection_->socket());
-    new_connection_->start();
-    new_connection_.reset(
-        new async_server_connection(*service_, handler_, pool_));
-    acceptor_->async_accept(new_connection_->socket(),
-                            boost::bind(&async_server_impl::handle_accept,
-                                        this,
-                                        boost::asio::placeholders::error));
-  } else {
+    pending.retry_delay = std::chrono::milliseconds(0);
+    set_socket_options(options_, pending.connection->socket());
+    // Draining asks the connection to close, unless it's already gone.
+    std::weak_ptr<async_server_connection> connection = pending.connection;
+    pending.connection->registration_ = connections_.add([connection]() {
+      if (connection_ptr open = connection.lock())
+        open->close_when_done();
+    });
+    pending.connection->start();
+    accept(shard, slot);
+  } else if (ec != boost::asio::error::operation_aborted) {
     NETWORK_MESSAGE("Error accepting connection, reason: " << ec);
+    // The connection wasn't used, so it takes the next accept.
+    pending.retry_delay = accept_retry_delay(ec, pending.retry_delay);
+    if (pending.retry_delay == std::chrono::milliseconds(0)) {
+      async_accept(shard, slot);
+      return;
+    }
+    pending.retry_timer.expires_from_now(pending.retry_delay);
+    pending.retry_timer.async_wait(
+        boost::bind(&async_server_impl::handle_accept_retry,
+                    this,
+                    shard,
+                    slot,
+                    boost::asio::placeholders::error));
   }
 }
 
+void async_server_impl::handle_accept_retry(
+    std::size_t shard,
+    std::size_t slot,
+    boost::system::error_code const& ec) {
+  {
+    std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
+    if (stopping_ || ec)
+      return;
+  }
+  async_accept(shard, slot);
+}
+
 void async_server_impl::start_listening() {
   using boost::asio::ip::tcp;
   boost::system::error_code error;
-  service_->reset();  // allows repeated cycles of run->stop->run
+  // allows repeated cycles of run->stop->run
+  for (std::size_t shard = 0; shard < shards_.size(); ++shard)
+    shards_[shard]->service.reset();
+  // an earlier drain neither closes the connections accepted from now on
+  // nor stops the server when it would have timed out
+  connections_.resume();
+  drain_timer_->cancel(error);
   tcp::resolver resolver(*service_);
   tcp::resolver::query query(address_, port_);
   tcp::resolver::iterator endpoint_iterator = resolver.resolve(query, error);
@@ -122,29 +327,28 @@ void async_server_impl::start_listening() {
         std::runtime_error("Error resolving address:port combination."));
   }
   tcp::endpoint endpoint = *endpoint_iterator;
-  acceptor_->open(endpoint.protocol(), error);
-  if (error) {
-    NETWORK_MESSAGE("error opening socket: " << address_ << ":" << port_);
-    BOOST_THROW_EXCEPTION(std::runtime_error("Error opening socket."));
+  for (std::size_t shard = 0; shard < shards_.size(); ++shard) {
+    tcp::acceptor& acceptor = shards_[shard]->acceptor;
+    acceptor.open(endpoint.protocol(), error);
+    if (error) {
+      NETWORK_MESSAGE("error opening socket: " << address_ << ":" << port_);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Error opening socket."));
+    }
+    set_acceptor_options(options_, acceptor);
+    acceptor.bind(endpoint, error);
+    if (error) {
+      NETWORK_MESSAGE("error binding socket: " << address_ << ":" << port_);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Error binding socket."));
+    }
+    acceptor.listen(boost::asio::socket_base::max_connections, error);
+    if (error) {
+      NETWORK_MESSAGE("error listening on socket: '"
+                      << error << "' on " << address_ << ":" << port_);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Error listening on socket."));
+    }
+    for (std::size_t slot = 0; slot < shards_[shard]->accepts.size(); ++slot)
+      accept(shard, slot);
   }
-  set_acceptor_options(options_, *acceptor_);
-  acceptor_->bind(endpoint, error);
-  if (error) {
-    NETWORK_MESSAGE("error binding socket: " << address_ << ":" << port_);
-    BOOST_THROW_EXCEPTION(std::runtime_error("Error binding socket."));
-  }
-  acceptor_->listen(boost::asio::socket_base::max_connections, error);
-  if (error) {
-    NETWORK_MESSAGE("error listening on socket: '" << error << "' on "
-                                                   << address_ << ":" << port_);
-    BOOST_THROW_EXCEPTION(std::runtime_error("Error listening on socket."));
-  }
-  new_connection_.reset(
-      new async_server_connection(*service_, handler_, pool_));
-  acceptor_->async_accept(new_connection_->socket(),
-                          boost::bind(&async_server_impl::handle_accept,
-                                      this,
-                                      boost::asio::placeholders::error));
   listening_ = true;
   std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
   stopping_ =
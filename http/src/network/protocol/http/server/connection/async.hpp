@@ -12,28 +12,40 @@
 #include <network/protocol/http/request.hpp>
 #include <network/protocol/http/algorithms/linearize.hpp>
 #include <network/utils/thread_pool.hpp>
-#include <boost/range/adaptor/sliced.hpp>
 #include <boost/range/algorithm/transform.hpp>
-#include <boost/range/algorithm/copy.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/asio/write.hpp>
 #include <memory>
 #include <network/protocol/http/server/request_parser.hpp>
+#include <network/protocol/http/server/impl/free_list.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/typed_in_place_factory.hpp>
 #include <thread>
+#include <chrono>
 #include <type_traits>
 #include <list>
 #include <vector>
 #include <iterator>
+#include <limits>
 #include <mutex>
 // #include <boost/bind.hpp>
 #include <functional>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #include <network/constants.hpp>
 
 #ifndef NETWORK_HTTP_SERVER_CONNECTION_HEADER_BUFFER_MAX_SIZE
@@ -59,14 +71,28 @@
 #define NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE 4096uL
 #endif
 
+#ifndef NETWORK_HTTP_SERVER_CONNECTION_BODY_DISCARD_MAX_SIZE
+/** The most of a request body left unread by its handler that is read and
+ *  thrown away to keep the connection open. When more than this is left
+ *  once the response headers are sent, the connection is closed instead.
+ */
+#define NETWORK_HTTP_SERVER_CONNECTION_BODY_DISCARD_MAX_SIZE 65536uL
+#endif
+
 namespace network {
 namespace http {
 
-extern void parse_version(std::string const& partial_parsed,
-                          boost::fusion::tuple<uint8_t, uint8_t>& version_pair);
-extern void parse_headers(
-    std::string const& input,
-    std::vector<std::pair<std::string, std::string>>& container);
+// Read buffers that async server connections borrow while they read, so
+// that idle connections don't each hold one.
+class async_server_read_buffers
+    : public free_list<
+          boost::array<char, NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE>> {
+ public:
+  explicit async_server_read_buffers(std::size_t max_size)
+      : free_list<boost::array<char,
+                               NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE>>(
+            max_size) {}
+};
 
 class async_server_connection
     : public std::enable_shared_from_this<async_server_connection> {
@@ -94,6 +120,13 @@ class async_server_connection
 
   typedef std::string string_type;
   typedef std::shared_ptr<async_server_connection> connection_ptr;
+  // Keeps the memory referred to by a written buffer alive until the
+  // write has completed.
+  typedef std::shared_ptr<void const> buffer_owner;
+
+ private:
+  typedef boost::array<char,
+                       NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE> buffer_type;
 
  private:
   static char const* status_message(status_t status) {
@@ -159,23 +192,53 @@ class async_server_connection
 
  public:
 
+  // Requests are served on the same connection until either side asks for it
+  // to be closed, up to max_requests requests (0 means no limit). The
+  // connection is closed if the next request doesn't start within
+  // idle_timeout seconds (0 means no limit). With inline_handlers the
+  // handler and callbacks run on the connection's strand rather than on
+  // thread_pool, and the connection is only used from them so it isn't
+  // locked. Read buffers are taken from read_buffers when given.
   async_server_connection(
       boost::asio::io_service& io_service,
       std::function<void(request const&, connection_ptr)> handler,
-      utils::thread_pool& thread_pool)
+      utils::thread_pool& thread_pool,
+      int max_requests = 1000,
+      int idle_timeout = 60,
+      bool inline_handlers = false,
+      std::shared_ptr<async_server_read_buffers> read_buffers =
+          std::shared_ptr<async_server_read_buffers>())
       : socket_(io_service),
         strand(io_service),
         handler(handler),
         thread_pool_(thread_pool),
         headers_already_sent(false),
         headers_in_progress(false),
-        headers_buffer(NETWORK_HTTP_SERVER_CONNECTION_HEADER_BUFFER_MAX_SIZE) {
-    new_start = read_buffer_.begin();
-  }
+        headers_buffer(NETWORK_HTTP_SERVER_CONNECTION_HEADER_BUFFER_MAX_SIZE),
+        read_buffers_(read_buffers
+                          ? read_buffers
+                          : std::make_shared<async_server_read_buffers>(1)),
+        read_buffer_(0),
+        status(ok),
+        new_start(0),
+        data_end(0),
+        idle_timer_(io_service),
+        max_requests_(max_requests),
+        idle_timeout_(idle_timeout),
+        requests_(0),
+        pending_writes_(0),
+        keep_alive_(false),
+        is_http_1_0_(false),
+        response_done_(false),
+        is_idle_(false),
+        inline_handlers_(inline_handlers),
+        is_waiting_(false),
+        closing_(false) {}
 
   ~async_server_connection() throw() {
     boost::system::error_code ignored;
     socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_receive, ignored);
+    release_read_buffer();
   }
 
   /** Function: template <class Range> set_headers(Range headers)
@@ -189,7 +252,7 @@ class async_server_connection
        *  then sent as soon as the first call to `write` or `flush` commences.
        */
   template <class Range> void set_headers(Range headers) {
-    lock_guard lock(headers_mutex);
+    state_lock lock = lock_state();
     if (headers_in_progress || headers_already_sent)
       boost::throw_exception(
           std::logic_error("Headers have already been sent."));
@@ -202,13 +265,42 @@ class async_server_connection
       stream << constants::http_slash() << 1 << constants::dot() << 1
              << constants::space() << status << constants::space()
              << status_message(status) << constants::crlf();
-      if (!boost::empty(headers)) {
-        typedef typename Range::const_iterator iterator;
-        boost::transform(headers,
-                         std::ostream_iterator<std::string>(stream),
-                         linearize_header());
-      } else {
-        stream << constants::crlf();
+      boost::transform(headers,
+                       std::ostream_iterator<std::string>(stream),
+                       linearize_header());
+
+      // A persistent connection needs the end of the response to be known
+      // without the connection being closed.
+      std::string method;
+      request_.get_method(method);
+      bool is_delimited = (method == "HEAD") || (status == no_content) ||
+                          (status == not_modified);
+      bool has_connection_header = false;
+      typedef typename Range::const_iterator iterator;
+      for (iterator it = boost::begin(headers); it != boost::end(headers);
+           ++it) {
+        if (boost::iequals(name(*it), "Content-Length") ||
+            boost::iequals(name(*it), "Transfer-Encoding")) {
+          is_delimited = true;
+        } else if (boost::iequals(name(*it), "Connection")) {
+          has_connection_header = true;
+          if (boost::icontains(value(*it), "close"))
+            keep_alive_ = false;
+        }
+      }
+      if (!is_delimited)
+        keep_alive_ = false;
+      // The client is told now if what's left of its request body is too
+      // much to skip.
+      std::size_t const discard_max_size =
+          NETWORK_HTTP_SERVER_CONNECTION_BODY_DISCARD_MAX_SIZE;
+      if (body_remaining_ && (*body_remaining_ > discard_max_size))
+        keep_alive_ = false;
+      if (!has_connection_header) {
+        if (!keep_alive_)
+          stream << "Connection: close" << constants::crlf();
+        else if (is_http_1_0_)
+          stream << "Connection: keep-alive" << constants::crlf();
       }
       stream << constants::crlf();
     }
@@ -219,7 +311,7 @@ class async_server_connection
   }
 
   void set_status(status_t new_status) {
-    lock_guard lock(headers_mutex);
+    state_lock lock = lock_state();
     if (headers_already_sent)
       boost::throw_exception(std::logic_error(
           "Headers have already been sent, cannot reset status."));
@@ -230,7 +322,7 @@ class async_server_connection
   }
 
   template <class Range> void write(Range const& range) {
-    lock_guard lock(headers_mutex);
+    state_lock lock = lock_state();
     if (error_encountered)
       boost::throw_exception(boost::system::system_error(*error_encountered));
     std::function<void(boost::system::error_code)> f =
@@ -247,7 +339,7 @@ class async_server_connection
                        typename Range::value_type>::value>::type write(
       Range const& range,
       Callback const& callback) {
-    lock_guard lock(headers_mutex);
+    state_lock lock = lock_state();
     if (error_encountered)
       boost::throw_exception(boost::system::system_error(*error_encountered));
     write_impl(boost::make_iterator_range(range), callback);
@@ -259,45 +351,173 @@ class async_server_connection
                       typename ConstBufferSeq::value_type>::value>::type write(
       ConstBufferSeq const& seq,
       Callback const& callback) {
-    write_vec_impl(seq, callback, shared_array_list(), shared_buffers());
+    write_vec_impl(seq, callback, buffer_owner(), shared_buffers());
   }
 
- private:
-  typedef boost::array<char,
-                       NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE> buffer_type;
+  /** Function: template <class ConstBufferSeq, class Callback>
+   *            write(ConstBufferSeq seq, buffer_owner owner, Callback callback)
+   *
+   *  Writes the buffers in seq without copying them. owner is held until
+   *  the write completes and should own the memory the buffers refer to.
+   */
+  template <class ConstBufferSeq, class Callback>
+  typename std::enable_if<
+      std::is_base_of<boost::asio::const_buffer,
+                      typename ConstBufferSeq::value_type>::value>::type write(
+      ConstBufferSeq const& seq,
+      buffer_owner owner,
+      Callback const& callback) {
+    write_vec_impl(seq, callback, owner, shared_buffers());
+  }
+
+  /** Function: write(std::string&& body)
+   *
+   *  Takes ownership of body and writes it without copying it.
+   */
+  void write(std::string&& body) {
+    std::function<void(boost::system::error_code)> f =
+        std::bind(&async_server_connection::default_error,
+                  async_server_connection::shared_from_this(),
+                  std::placeholders::_1);
+    write(std::move(body), f);
+  }
+
+  template <class Callback>
+  void write(std::string&& body, Callback const& callback) {
+    std::shared_ptr<std::string> owner =
+        std::make_shared<std::string>(std::move(body));
+    write_owned(owner, owner->data(), owner->size(), callback);
+  }
+
+  /** Function: write(std::shared_ptr<char const> data, std::size_t size)
+   *
+   *  Writes size bytes starting at data without copying them, sharing
+   *  ownership of data until the write completes.
+   */
+  void write(std::shared_ptr<char const> data, std::size_t size) {
+    std::function<void(boost::system::error_code)> f =
+        std::bind(&async_server_connection::default_error,
+                  async_server_connection::shared_from_this(),
+                  std::placeholders::_1);
+    write(data, size, f);
+  }
+
+  template <class Callback>
+  void write(std::shared_ptr<char const> data,
+             std::size_t size,
+             Callback const& callback) {
+    write_owned(data, data.get(), size, callback);
+  }
+
+  /** Function: template <class Callback>
+   *            write_file(int fd, off_t offset, std::size_t length,
+   *                       Callback callback)
+   *
+   *  Sends length bytes of the open file fd, starting at offset, without
+   *  copying them through user memory. On Linux this uses sendfile(2),
+   *  elsewhere (or for files sendfile can't read) the range is mapped
+   *  into memory and written from there. fd has to stay open until the
+   *  callback is called.
+   */
+  template <class Callback>
+  void write_file(int fd,
+                  off_t offset,
+                  std::size_t length,
+                  Callback const& callback) {
+    write_file_impl(std::make_shared<file_transfer>(
+        fd, offset, length, false, callback));
+  }
+
+  /** Function: template <class Callback>
+   *            write_file(std::string path, off_t offset, std::size_t length,
+   *                       Callback callback)
+   *
+   *  Like write_file above, but opens the file at path and closes it once
+   *  it has been sent.
+   *  Throws: boost::system::system_error if the file can't be opened.
+   */
+  template <class Callback>
+  void write_file(std::string const& path,
+                  off_t offset,
+                  std::size_t length,
+                  Callback const& callback) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+      boost::throw_exception(boost::system::system_error(
+          errno, boost::system::system_category(), path));
+    write_file_impl(std::make_shared<file_transfer>(
+        fd, offset, length, true, callback));
+  }
 
- public:
   typedef boost::iterator_range<buffer_type::const_iterator> input_range;
   typedef std::function<void(input_range,
                              boost::system::error_code,
                              std::size_t,
                              connection_ptr)> read_callback_function;
 
+  /** Function: read(read_callback_function callback)
+   *
+   *  Reads the next part of the request body. Once a body of known length
+   *  has been read, the callback is called with boost::asio::error::eof. The
+   *  response isn't done while a read is pending.
+   */
   void read(read_callback_function callback) {
     if (error_encountered)
       boost::throw_exception(boost::system::system_error(*error_encountered));
-    if (new_start != read_buffer_.begin()) {
-      input_range input = boost::make_iterator_range(new_start,
-                                                     read_buffer_.end());
-      thread_pool()
-          .post(std::bind(callback,
-                            input,
-                            boost::system::error_code(),
-                            std::distance(new_start, data_end),
-                            async_server_connection::shared_from_this()));
-      new_start = read_buffer_.begin();
-      return;
+    connection_ptr handle = read_handle();
+    std::size_t length = read_buffer().size();
+    {
+      state_lock lock = lock_state();
+      if (body_remaining_) {
+        if (*body_remaining_ == 0) {
+          boost::system::error_code eof = boost::asio::error::eof;
+          run_handler(std::bind(
+              callback, input_range(), eof, std::size_t(0), handle));
+          return;
+        }
+        length = std::min(length, *body_remaining_);
+      }
+      // Only the body is handed out of what was read with the headers, the
+      // rest is the next request.
+      std::size_t buffered = std::min<std::size_t>(
+          std::distance(new_start, data_end), length);
+      if (buffered != 0) {
+        input_range input =
+            boost::make_iterator_range(new_start, new_start + buffered);
+        new_start += buffered;
+        if (body_remaining_)
+          *body_remaining_ -= buffered;
+        run_handler(std::bind(callback,
+                              input,
+                              boost::system::error_code(),
+                              buffered,
+                              handle));
+        return;
+      }
     }
 
     socket().async_read_some(
-        boost::asio::buffer(read_buffer_),
+        boost::asio::buffer(read_buffer(), length),
         strand.wrap(std::bind(&async_server_connection::wrap_read_handler,
                                 async_server_connection::shared_from_this(),
                                 callback,
+                                handle,
                                 boost::asio::placeholders::error,
                                 boost::asio::placeholders::bytes_transferred)));
   }
 
+  /** Function: close_when_done()
+   *
+   *  Lets the request being handled finish, telling the client that the
+   *  connection is being closed, and closes the connection once its
+   *  response is done. A connection waiting for its next request is closed
+   *  right away.
+   */
+  void close_when_done() {
+    strand.dispatch(std::bind(&async_server_connection::handle_close_when_done,
+                              async_server_connection::shared_from_this()));
+  }
+
   boost::asio::ip::tcp::socket& socket() { return socket_; }
   utils::thread_pool& thread_pool() { return thread_pool_; }
   bool has_error() { return (!!error_encountered); }
@@ -308,31 +528,60 @@ class async_server_connection
  private:
 
   void wrap_read_handler(read_callback_function callback,
+                         connection_ptr handle,
                          boost::system::error_code const& ec,
                          std::size_t bytes_transferred) {
     if (ec)
       error_encountered = boost::in_place<boost::system::system_error>(ec);
-    buffer_type::const_iterator data_start = read_buffer_.begin(),
-                                             data_end = read_buffer_.begin();
-    std::advance(data_end, bytes_transferred);
-    thread_pool()
-        .post(std::bind(callback,
-                          boost::make_iterator_range(data_start, data_end),
+    buffer_type::iterator data_start = read_buffer().begin();
+    new_start = data_end = data_start + bytes_transferred;
+    {
+      state_lock lock = lock_state();
+      if (body_remaining_)
+        *body_remaining_ -= bytes_transferred;
+    }
+    run_handler(std::bind(callback,
+                          boost::make_iterator_range(
+                              buffer_type::const_iterator(data_start),
+                              buffer_type::const_iterator(data_end)),
                           ec,
                           bytes_transferred,
-                          async_server_connection::shared_from_this()));
+                          handle));
   }
 
   void default_error(boost::system::error_code const& ec) {
-    error_encountered = boost::in_place<boost::system::system_error>(ec);
+    if (ec)
+      error_encountered = boost::in_place<boost::system::system_error>(ec);
   }
 
-  typedef boost::array<char, NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE> array;
-  typedef std::list<std::shared_ptr<array>> array_list;
-  typedef std::shared_ptr<array_list> shared_array_list;
   typedef std::shared_ptr<
       std::vector<boost::asio::const_buffer>> shared_buffers;
-  typedef std::lock_guard<std::recursive_mutex> lock_guard;
+
+  struct file_transfer {
+    file_transfer(int fd,
+                  off_t offset,
+                  std::size_t length,
+                  bool owns_fd,
+                  std::function<void(boost::system::error_code)> callback)
+        : fd(fd),
+          offset(offset),
+          remaining(length),
+          owns_fd(owns_fd),
+          is_started(false),
+          callback(callback) {}
+
+    ~file_transfer() {
+      if (owns_fd)
+        ::close(fd);
+    }
+
+    int fd;
+    off_t offset;
+    std::size_t remaining;
+    bool owns_fd, is_started;
+    std::function<void(boost::system::error_code)> callback;
+  };
+  typedef std::unique_lock<std::recursive_mutex> state_lock;
   typedef std::list<std::function<void()>> pending_actions_list;
 
   boost::asio::ip::tcp::socket socket_;
@@ -343,7 +592,8 @@ class async_server_connection
   boost::asio::streambuf headers_buffer;
 
   std::recursive_mutex headers_mutex;
-  buffer_type read_buffer_;
+  std::shared_ptr<async_server_read_buffers> read_buffers_;
+  buffer_type* read_buffer_;
   status_t status;
   request_parser parser;
   request request_;
@@ -351,9 +601,33 @@ class async_server_connection
   std::string partial_parsed;
   boost::optional<boost::system::system_error> error_encountered;
   pending_actions_list pending_actions;
+  boost::asio::steady_timer idle_timer_;
+  std::string source_;
+  int max_requests_, idle_timeout_, requests_;
+  // Writes that have been started or queued, guarded by headers_mutex.
+  std::size_t pending_writes_;
+  bool keep_alive_, is_http_1_0_, response_done_, is_idle_, inline_handlers_;
+  bool is_waiting_, closing_;
+  // What's left to read of the request body, none when its length isn't
+  // known.
+  boost::optional<std::size_t> body_remaining_;
+  // Keeps the connection tracked by the server while it's open.
+  std::shared_ptr<void> registration_;
 
   friend class async_server_impl;
 
+  // The handler is given its own reference to the connection, which shares
+  // ownership of a token. Once the handler and everything it has handed the
+  // reference to have released it, the token is destroyed and the response
+  // is complete.
+  struct response_token {
+    explicit response_token(connection_ptr connection)
+        : connection(connection) {}
+    ~response_token() { connection->handle_response_done(); }
+    connection_ptr connection;
+  };
+  std::weak_ptr<response_token> response_token_;
+
   enum state_t {
     method,
     uri,
@@ -361,17 +635,316 @@ class async_server_connection
     headers
   };
 
+  // Runs a handler or callback where this connection runs them: on the
+  // strand when handlers are run inline, on the thread pool otherwise.
+  void run_handler(std::function<void()> const& f) {
+    if (inline_handlers_)
+      strand.dispatch(f);
+    else
+      thread_pool().post(f);
+  }
+
+  // Only the strand touches the connection when handlers are run inline,
+  // so the lock is only taken when they run on the thread pool.
+  state_lock lock_state() {
+    if (inline_handlers_) {
+      BOOST_ASSERT(strand.running_in_this_thread() &&
+                   "A connection with inline handlers was used from outside "
+                   "its handler and callbacks.");
+      return state_lock(headers_mutex, std::defer_lock);
+    }
+    return state_lock(headers_mutex);
+  }
+
   void start() {
     std::ostringstream ip_stream;
     ip_stream << socket_.remote_endpoint().address().to_string() << ':'
               << socket_.remote_endpoint().port();
-    request_.set_source(ip_stream.str());
+    source_ = ip_stream.str();
+    request_.set_source(source_);
+    wait_for_request();
+  }
+
+  connection_ptr request_handle() {
+    std::shared_ptr<response_token> token = std::make_shared<response_token>(
+        async_server_connection::shared_from_this());
+    response_token_ = token;
+    return connection_ptr(token, token->connection.get());
+  }
+
+  // A pending read holds the response open like the handler does, so that
+  // the next request isn't read before the body.
+  connection_ptr read_handle() {
+    std::shared_ptr<response_token> token = response_token_.lock();
+    if (!token)
+      return async_server_connection::shared_from_this();
+    return connection_ptr(token, token->connection.get());
+  }
+
+  // Parses a Content-Length value, which is a number that has to fit.
+  static boost::optional<std::size_t> content_length(boost::string_ref value) {
+    std::string digits = boost::trim_copy(value.to_string());
+    if (digits.empty())
+      return boost::none;
+    std::size_t length = 0;
+    for (std::string::const_iterator it = digits.begin(); it != digits.end();
+         ++it) {
+      if ((*it < '0') || (*it > '9'))
+        return boost::none;
+      std::size_t digit = *it - '0';
+      if (length > (std::numeric_limits<std::size_t>::max() - digit) / 10)
+        return boost::none;
+      length = (length * 10) + digit;
+    }
+    return length;
+  }
+
+  // Adds the headers the parser found in block to the request.
+  void append_headers(char const* block) {
+    std::vector<request_parser::header_field> const& fields =
+        parser.header_fields();
+    for (std::vector<request_parser::header_field>::const_iterator it =
+             fields.begin();
+         it != fields.end(); ++it) {
+      request_.append_header(it->name(block).to_string(),
+                             it->value(block).to_string());
+    }
+  }
+
+  bool wants_keep_alive(char const* block) {
+    unsigned short major = 0, minor = 0;
+    request_.get_version_major(major);
+    request_.get_version_minor(minor);
+    is_http_1_0_ = (major == 1) && (minor == 0);
+    bool keep_alive = (major > 1) || ((major == 1) && (minor >= 1));
+    body_remaining_ = std::size_t(0);
+    bool has_length = false;
+    std::vector<request_parser::header_field> const& fields =
+        parser.header_fields();
+    for (std::vector<request_parser::header_field>::const_iterator it =
+             fields.begin();
+         it != fields.end(); ++it) {
+      boost::string_ref name = it->name(block), value = it->value(block);
+      if (boost::iequals(name, "Connection")) {
+        if (boost::icontains(value, "close"))
+          keep_alive = false;
+        else if (boost::icontains(value, "keep-alive"))
+          keep_alive = true;
+      } else if (boost::iequals(name, "Content-Length")) {
+        // Repeated lengths have to agree.
+        boost::optional<std::size_t> length = content_length(value);
+        if (!length || (has_length && body_remaining_ != length))
+          body_remaining_ = boost::none;
+        else if (!has_length)
+          body_remaining_ = length;
+        has_length = true;
+      } else if (boost::iequals(name, "Transfer-Encoding")) {
+        has_length = true;
+        body_remaining_ = boost::none;
+      }
+    }
+    // The next request is only found after a body of known length, which is
+    // skipped if the handler doesn't read all of it.
+    return keep_alive && body_remaining_ &&
+           ((max_requests_ <= 0) || (requests_ < max_requests_));
+  }
+
+  void handle_response_done() {
+    // The last handle may be released by a callback that's being destroyed
+    // off the strand.
+    if (inline_handlers_ && !strand.running_in_this_thread()) {
+      strand.post(std::bind(&async_server_connection::handle_response_done,
+                            async_server_connection::shared_from_this()));
+      return;
+    }
+    state_lock lock = lock_state();
+    response_done_ = true;
+    if (pending_writes_ == 0)
+      read_next_request();
+  }
+
+  void finish_write() {
+    state_lock lock = lock_state();
+    if ((--pending_writes_ == 0) && response_done_)
+      read_next_request();
+  }
+
+  void run_pending_action(std::function<void()> action) {
+    action();
+    finish_write();
+  }
+
+  void read_next_request() {
+    // A response that was never started is ended by closing the connection.
+    if (!keep_alive_ || error_encountered || !headers_already_sent)
+      return;
+    response_done_ = false;
+    strand.post(std::bind(&async_server_connection::start_next_request,
+                          async_server_connection::shared_from_this()));
+  }
+
+  void start_next_request() {
+    if (body_remaining_ && (*body_remaining_ != 0)) {
+      skip_body();
+      return;
+    }
+    {
+      state_lock lock = lock_state();
+      headers_already_sent = false;
+      headers_in_progress = false;
+      status = ok;
+      keep_alive_ = false;
+    }
+    parser.reset();
+    request_ = request();
+    request_.set_source(source_);
+    partial_parsed.clear();
+
+    // The client may have sent the next request without waiting for the
+    // response to the previous one.
+    if (new_start != data_end) {
+      handle_read_data(method,
+                       boost::system::error_code(),
+                       std::distance(read_buffer().begin(), data_end));
+      return;
+    }
+
+    wait_for_request();
+  }
+
+  // Throws away what the handler left of the request body, which is no more
+  // than NETWORK_HTTP_SERVER_CONNECTION_BODY_DISCARD_MAX_SIZE.
+  void skip_body() {
+    std::size_t buffered = std::min<std::size_t>(
+        std::distance(new_start, data_end), *body_remaining_);
+    new_start += buffered;
+    *body_remaining_ -= buffered;
+    if (*body_remaining_ == 0) {
+      start_next_request();
+      return;
+    }
+    socket_.async_read_some(
+        boost::asio::buffer(read_buffer(),
+                            std::min(read_buffer().size(), *body_remaining_)),
+        strand.wrap(std::bind(&async_server_connection::handle_skipped_body,
+                              async_server_connection::shared_from_this(),
+                              boost::asio::placeholders::error,
+                              boost::asio::placeholders::bytes_transferred)));
+  }
+
+  void handle_skipped_body(boost::system::error_code const& ec,
+                           std::size_t bytes_transferred) {
+    if (ec) {
+      error_encountered = boost::in_place<boost::system::system_error>(ec);
+      return;
+    }
+    new_start = data_end = read_buffer().begin();
+    *body_remaining_ -= bytes_transferred;
+    start_next_request();
+  }
+
+  // Waits for the next request to arrive without holding a read buffer. The
+  // first request is waited for like the others, so a client that connects
+  // and sends nothing is closed after idle_timeout too.
+  void wait_for_request() {
+    if (idle_timeout_ > 0) {
+      is_idle_ = true;
+      idle_timer_.expires_from_now(std::chrono::seconds(idle_timeout_));
+      idle_timer_.async_wait(strand.wrap(
+          std::bind(&async_server_connection::handle_idle_timeout,
+                    async_server_connection::shared_from_this(),
+                    boost::asio::placeholders::error)));
+    }
+    is_waiting_ = true;
+    release_read_buffer();
+    std::string().swap(partial_parsed);
+    socket_.async_read_some(
+        boost::asio::null_buffers(),
+        strand.wrap(std::bind(&async_server_connection::handle_request_ready,
+                              async_server_connection::shared_from_this(),
+                              boost::asio::placeholders::error)));
+  }
+
+  void handle_request_ready(boost::system::error_code const& ec) {
+    is_waiting_ = false;
+    if (ec) {
+      error_encountered = boost::in_place<boost::system::system_error>(ec);
+      return;
+    }
+    new_start = read_buffer().begin();
     read_more(method);
   }
 
+  buffer_type& read_buffer() {
+    if (!read_buffer_) {
+      read_buffer_ = read_buffers_->take();
+      if (!read_buffer_)
+        read_buffer_ = new buffer_type;
+    }
+    return *read_buffer_;
+  }
+
+  void release_read_buffer() {
+    if (read_buffer_) {
+      read_buffers_->give(read_buffer_);
+      read_buffer_ = 0;
+      new_start = data_end = 0;
+    }
+  }
+
+  // Closes the connection and returns it to the state it was constructed
+  // in, so that it can be used for another connection. There must be no
+  // operations pending on it.
+  void recycle() {
+    boost::system::error_code ignored;
+    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_receive, ignored);
+    socket_.close(ignored);
+    headers_already_sent = false;
+    headers_in_progress = false;
+    headers_buffer.consume(headers_buffer.size());
+    release_read_buffer();
+    status = ok;
+    parser.reset();
+    request_ = request();
+    std::string().swap(partial_parsed);
+    error_encountered = boost::none;
+    pending_actions.clear();
+    source_.clear();
+    requests_ = 0;
+    pending_writes_ = 0;
+    keep_alive_ = false;
+    is_http_1_0_ = false;
+    response_done_ = false;
+    is_idle_ = false;
+    is_waiting_ = false;
+    closing_ = false;
+    body_remaining_ = boost::none;
+    registration_.reset();
+  }
+
+  void handle_close_when_done() {
+    state_lock lock = lock_state();
+    closing_ = true;
+    keep_alive_ = false;
+    if (is_waiting_) {
+      boost::system::error_code ignored;
+      idle_timer_.cancel(ignored);
+      socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+      socket_.close(ignored);
+    }
+  }
+
+  void handle_idle_timeout(boost::system::error_code const& ec) {
+    if (ec || !is_idle_)
+      return;
+    boost::system::error_code ignored;
+    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+    socket_.close(ignored);
+  }
+
   void read_more(state_t state) {
     socket_.async_read_some(
-        boost::asio::buffer(read_buffer_),
+        boost::asio::buffer(read_buffer()),
         strand.wrap(std::bind(&async_server_connection::handle_read_data,
                                 async_server_connection::shared_from_this(),
                                 state,
@@ -382,10 +955,15 @@ class async_server_connection
   void handle_read_data(state_t state,
                         boost::system::error_code const& ec,
                         std::size_t bytes_transferred) {
+    if (is_idle_) {
+      is_idle_ = false;
+      boost::system::error_code ignored;
+      idle_timer_.cancel(ignored);
+    }
     if (!ec) {
       boost::logic::tribool parsed_ok;
       boost::iterator_range<buffer_type::iterator> result_range, input_range;
-      data_end = read_buffer_.begin();
+      data_end = read_buffer().begin();
       std::advance(data_end, bytes_transferred);
       switch (state) {
         case method:
@@ -405,7 +983,7 @@ class async_server_connection
           } else {
             partial_parsed.append(boost::begin(result_range),
                                   boost::end(result_range));
-            new_start = read_buffer_.begin();
+            new_start = read_buffer().begin();
             read_more(method);
             break;
           }
@@ -427,7 +1005,7 @@ class async_server_connection
           } else {
             partial_parsed.append(boost::begin(result_range),
                                   boost::end(result_range));
-            new_start = read_buffer_.begin();
+            new_start = read_buffer().begin();
             read_more(uri);
             break;
           }
@@ -439,18 +1017,11 @@ class async_server_connection
             client_error();
             break;
           } else if (parsed_ok == true) {
-            boost::fusion::tuple<uint8_t, uint8_t> version_pair;
-            partial_parsed.append(boost::begin(result_range),
-                                  boost::end(result_range));
-            parse_version(partial_parsed, version_pair);
-            request_.set_version_major(boost::fusion::get<0>(version_pair));
-            request_.set_version_minor(boost::fusion::get<1>(version_pair));
+            request_.set_version_major(parser.version_major());
+            request_.set_version_minor(parser.version_minor());
             new_start = boost::end(result_range);
-            partial_parsed.clear();
           } else {
-            partial_parsed.append(boost::begin(result_range),
-                                  boost::end(result_range));
-            new_start = read_buffer_.begin();
+            new_start = read_buffer().begin();
             read_more(version);
             break;
           }
@@ -462,26 +1033,29 @@ class async_server_connection
             client_error();
             break;
           } else if (parsed_ok == true) {
-            partial_parsed.append(boost::begin(result_range),
-                                  boost::end(result_range));
-            std::vector<std::pair<std::string, std::string>> headers;
-            parse_headers(partial_parsed, headers);
-            for (std::vector<
-                std::pair<std::string, std::string>>::const_iterator it =
-                     headers.begin();
-                 it != headers.end(); ++it) {
-              request_.append_header(it->first, it->second);
+            // The header block is only copied out of the read buffer when it
+            // took more than one read.
+            char const* block = &*new_start;
+            if (!partial_parsed.empty()) {
+              partial_parsed.append(boost::begin(result_range),
+                                    boost::end(result_range));
+              block = partial_parsed.data();
             }
+            append_headers(block);
             new_start = boost::end(result_range);
-            thread_pool()
-                .post(std::bind(handler,
+            ++requests_;
+            {
+              state_lock lock = lock_state();
+              keep_alive_ = wants_keep_alive(block) && !closing_;
+            }
+            run_handler(std::bind(handler,
                                   boost::cref(request_),
-                                  async_server_connection::shared_from_this()));
+                                  request_handle()));
             return;
           } else {
             partial_parsed.append(boost::begin(result_range),
                                   boost::end(result_range));
-            new_start = read_buffer_.begin();
+            new_start = read_buffer().begin();
             read_more(headers);
             break;
           }
@@ -526,6 +1100,8 @@ class async_server_connection
     if (headers_in_progress)
       return;
     headers_in_progress = true;
+    // the header write and the callback
+    pending_writes_ += 2;
     boost::asio::async_write(
         socket(),
         headers_buffer,
@@ -539,17 +1115,27 @@ class async_server_connection
   void handle_write_headers(std::function<void()> callback,
                             boost::system::error_code const& ec,
                             std::size_t bytes_transferred) {
-    lock_guard lock(headers_mutex);
+    state_lock lock = lock_state();
     if (!ec) {
       headers_buffer.consume(headers_buffer.size());
       headers_already_sent = true;
-      thread_pool().post(callback);
-      pending_actions_list::iterator start = pending_actions.begin(),
-                                             end = pending_actions.end();
+      // Inline actions may queue more writes, so they're run off a list of
+      // their own.
+      pending_actions_list actions;
+      actions.swap(pending_actions);
+      run_handler(
+          std::bind(&async_server_connection::run_pending_action,
+                    async_server_connection::shared_from_this(),
+                    callback));
+      pending_actions_list::iterator start = actions.begin(),
+                                             end = actions.end();
       while (start != end) {
-        thread_pool().post(*start++);
+        run_handler(
+            std::bind(&async_server_connection::run_pending_action,
+                      async_server_connection::shared_from_this(),
+                      *start++));
       }
-      pending_actions_list().swap(pending_actions);
+      finish_write();
     } else {
       error_encountered = boost::in_place<boost::system::system_error>(ec);
     }
@@ -557,22 +1143,170 @@ class async_server_connection
 
   void handle_write(
       std::function<void(boost::system::error_code const&)> callback,
-      shared_array_list temporaries,
+      buffer_owner owner,
       shared_buffers buffers,
       boost::system::error_code const& ec,
       std::size_t bytes_transferred) {
-    // we want to forget the temporaries and buffers
-    thread_pool().post(std::bind(callback, ec));
+    // we want to forget the owner and buffers
+    run_handler(std::bind(callback, ec));
+    finish_write();
+  }
+
+  template <class Callback>
+  void write_owned(buffer_owner owner,
+                   char const* data,
+                   std::size_t size,
+                   Callback const& callback) {
+    if (size == 0)
+      return;
+    std::vector<boost::asio::const_buffer> seq(1,
+                                               boost::asio::buffer(data, size));
+    write_vec_impl(seq, callback, owner, shared_buffers());
+  }
+
+  void write_file_impl(std::shared_ptr<file_transfer> transfer) {
+    state_lock lock = lock_state();
+    if (error_encountered)
+      boost::throw_exception(boost::system::system_error(*error_encountered));
+
+    std::function<void()> continuation =
+        std::bind(&async_server_connection::write_file_impl,
+                  async_server_connection::shared_from_this(),
+                  transfer);
+
+    if (!headers_already_sent && !headers_in_progress) {
+      write_headers_only(continuation);
+      return;
+    } else if (headers_in_progress && !headers_already_sent) {
+      ++pending_writes_;
+      pending_actions.push_back(continuation);
+      return;
+    }
+
+    ++pending_writes_;
+    if (transfer->remaining == 0) {
+      finish_file(transfer, boost::system::error_code());
+      return;
+    }
+    send_file(transfer);
+  }
+
+  void send_file(std::shared_ptr<file_transfer> transfer) {
+#if defined(__linux__)
+    boost::system::error_code ec;
+    socket_.native_non_blocking(true, ec);
+    while (!ec) {
+      ssize_t sent = ::sendfile(socket_.native_handle(),
+                                transfer->fd,
+                                &transfer->offset,
+                                transfer->remaining);
+      if (sent > 0) {
+        transfer->is_started = true;
+        transfer->remaining -= sent;
+        if (transfer->remaining == 0)
+          break;
+      } else if (sent == 0) {
+        // the file is shorter than the range we were asked to send
+        ec = boost::asio::error::eof;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        socket_.async_write_some(
+            boost::asio::null_buffers(),
+            strand.wrap(
+                std::bind(&async_server_connection::handle_file_writable,
+                          async_server_connection::shared_from_this(),
+                          transfer,
+                          boost::asio::placeholders::error)));
+        return;
+      } else if ((errno == EINVAL || errno == ENOSYS) &&
+                 !transfer->is_started) {
+        // sendfile can't read from this kind of file
+        write_mapped_file(transfer);
+        return;
+      } else if (errno != EINTR) {
+        ec = boost::system::error_code(errno, boost::system::system_category());
+      }
+    }
+    finish_file(transfer, ec);
+#else
+    write_mapped_file(transfer);
+#endif
+  }
+
+  void handle_file_writable(std::shared_ptr<file_transfer> transfer,
+                            boost::system::error_code const& ec) {
+    if (ec)
+      finish_file(transfer, ec);
+    else
+      send_file(transfer);
+  }
+
+  void write_mapped_file(std::shared_ptr<file_transfer> transfer) {
+    struct stat file_stat;
+    if (::fstat(transfer->fd, &file_stat) == -1) {
+      finish_file(transfer,
+                  boost::system::error_code(errno,
+                                            boost::system::system_category()));
+      return;
+    }
+    // reading a mapping past the end of the file raises SIGBUS, so a range
+    // the file doesn't hold is refused like sendfile running out of data
+    if (file_stat.st_size < transfer->offset ||
+        static_cast<std::size_t>(file_stat.st_size - transfer->offset) <
+            transfer->remaining) {
+      finish_file(transfer, boost::asio::error::eof);
+      return;
+    }
+    // mappings have to start on a page boundary
+    off_t page_size = ::sysconf(_SC_PAGESIZE);
+    off_t map_offset = transfer->offset - (transfer->offset % page_size);
+    std::size_t map_length =
+        transfer->remaining + (transfer->offset - map_offset);
+    void* mapping = ::mmap(
+        0, map_length, PROT_READ, MAP_SHARED, transfer->fd, map_offset);
+    if (mapping == MAP_FAILED) {
+      finish_file(transfer,
+                  boost::system::error_code(errno,
+                                            boost::system::system_category()));
+      return;
+    }
+    buffer_owner owner(mapping, [map_length](void const* mapping) {
+      ::munmap(const_cast<void*>(mapping), map_length);
+    });
+    char const* data = static_cast<char const*>(mapping) +
+                       (transfer->offset - map_offset);
+    async_write_data(
+        boost::asio::buffer(data, transfer->remaining),
+        std::bind(&async_server_connection::handle_write,
+                  async_server_connection::shared_from_this(),
+                  transfer->callback,
+                  owner,
+                  shared_buffers(),
+                  boost::asio::placeholders::error,
+                  boost::asio::placeholders::bytes_transferred));
+  }
+
+  // Write completions are handled straight from the io_service, unless
+  // handlers are run inline and the completion has to be on the strand.
+  template <class ConstBufferSeq, class Handler>
+  void async_write_data(ConstBufferSeq const& seq, Handler const& handler) {
+    if (inline_handlers_)
+      boost::asio::async_write(socket_, seq, strand.wrap(handler));
+    else
+      boost::asio::async_write(socket_, seq, handler);
+  }
+
+  void finish_file(std::shared_ptr<file_transfer> transfer,
+                   boost::system::error_code const& ec) {
+    run_handler(std::bind(transfer->callback, ec));
+    finish_write();
   }
 
   template <class Range>
   void write_impl(Range range,
                   std::function<void(boost::system::error_code)> callback) {
-    // linearize the whole range into a vector
-    // of fixed-sized buffers, then schedule an asynchronous
-    // write of these buffers -- make sure they are live
-    // by making these linearized buffers shared and made
-    // part of the completion handler.
+    // linearize the whole range into a single buffer that the
+    // completion handler keeps alive, then schedule an asynchronous
+    // write of it.
     //
     // once the range has been linearized and sent, schedule
     // a wrapper to be called in the io_service's thread, that
@@ -580,42 +1314,19 @@ class async_server_connection
     // referred to here so that the io_service's thread can concentrate
     // on doing I/O.
     //
-
-    static std::size_t const connection_buffer_size =
-        NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE;
-    shared_array_list temporaries = std::make_shared<array_list>();
-    shared_buffers buffers = std::make_shared<
-                                 std::vector<boost::asio::const_buffer>>(0);
-
-    std::size_t range_size = boost::distance(range);
-    buffers->reserve((range_size / connection_buffer_size) +
-                     ((range_size % connection_buffer_size) ? 1 : 0));
-    std::size_t slice_size = std::min(range_size, connection_buffer_size);
-    typename boost::range_iterator<Range>::type start = boost::begin(range),
-                                                        end = boost::end(range);
-    while (slice_size != 0) {
-      using boost::adaptors::sliced;
-      std::shared_ptr<array> new_array = std::make_shared<array>();
-      boost::copy(range | sliced(0, slice_size), new_array->begin());
-      temporaries->push_back(new_array);
-      buffers->push_back(boost::asio::buffer(new_array->data(), slice_size));
-      std::advance(start, slice_size);
-      range = boost::make_iterator_range(start, end);
-      range_size = boost::distance(range);
-      slice_size = std::min(range_size, connection_buffer_size);
-    }
-
-    if (!buffers->empty()) {
-      write_vec_impl(*buffers, callback, temporaries, buffers);
-    }
+    // callers that can give up their buffer should use the owning
+    // write overloads, which skip this copy.
+    std::shared_ptr<std::string> linearized =
+        std::make_shared<std::string>(boost::begin(range), boost::end(range));
+    write_owned(linearized, linearized->data(), linearized->size(), callback);
   }
 
   template <class ConstBufferSeq, class Callback>
   void write_vec_impl(ConstBufferSeq const& seq,
                       Callback const& callback,
-                      shared_array_list temporaries,
+                      buffer_owner owner,
                       shared_buffers buffers) {
-    lock_guard lock(headers_mutex);
+    state_lock lock = lock_state();
     if (error_encountered)
       boost::throw_exception(boost::system::system_error(*error_encountered));
 
@@ -630,24 +1341,25 @@ class async_server_connection
             async_server_connection::shared_from_this(),
             seq,
             callback_function,
-            temporaries,
+            owner,
             buffers);
 
     if (!headers_already_sent && !headers_in_progress) {
       write_headers_only(continuation);
       return;
     } else if (headers_in_progress && !headers_already_sent) {
+      ++pending_writes_;
       pending_actions.push_back(continuation);
       return;
     }
 
-    boost::asio::async_write(
-        socket_,
+    ++pending_writes_;
+    async_write_data(
         seq,
         std::bind(&async_server_connection::handle_write,
                     async_server_connection::shared_from_this(),
                     callback_function,
-                    temporaries,
+                    owner,
                     buffers,
                     boost::asio::placeholders::error,
                     boost::asio::placeholders::bytes_transferred));
@@ -14,6 +14,8 @@
 
 #include <utility>
 #include <iterator>
+#include <algorithm>
+#include <sstream>
 // #include <boost/enable_shared_from_this.hpp>
 #include <network/constants.hpp>
 #include <network/protocol/http/server/request_parser.hpp>
@@ -28,29 +30,38 @@
 #include <boost/array.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/logic/tribool.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/typed_in_place_factory.hpp>
 #include <functional>
 #include <mutex>
 
 namespace network {
 namespace http {
 
-#ifndef NETWORK_NO_LIB
-extern void parse_version(std::string const& partial_parsed,
-                          boost::fusion::tuple<uint8_t, uint8_t>& version_pair);
-extern void parse_headers(
-    std::string const& input,
-    std::vector<std::pair<std::string, std::string>>& container);
-#endif
-
 class sync_server_connection
     : public std::enable_shared_from_this<sync_server_connection> {
  public:
-  sync_server_connection(boost::asio::io_service& service,
-                         std::function<void(request const&, response&)> handler)
+  sync_server_connection(
+      boost::asio::io_service& service,
+      std::function<void(request const&, response&)> handler,
+      std::function<void(request const&, std::string const&)> body_handler =
+          std::function<void(request const&, std::string const&)>(),
+      int max_body_size = -1)
       : service_(service),
         handler_(handler),
+        body_handler_(body_handler),
         socket_(service_),
-        wrapper_(service_) {}
+        wrapper_(service_),
+        max_body_size_(max_body_size),
+        body_remaining_(0),
+        body_size_(0),
+        body_state_(no_body),
+        body_too_large_(false),
+        expect_continue_(false),
+        has_request_(false) {}
 
   boost::asio::ip::tcp::socket& socket() { return socket_; }
 
@@ -63,6 +74,7 @@ class sync_server_connection
     ip_stream << socket_.remote_endpoint().address().to_string() << ':'
               << socket_.remote_endpoint().port();
     request_.set_source(ip_stream.str());
+    new_start = read_buffer_.begin();
     socket_.async_read_some(boost::asio::buffer(read_buffer_),
                             wrapper_.wrap(std::bind(
                                 &sync_server_connection::handle_read_data,
@@ -72,7 +84,23 @@ class sync_server_connection
                                 boost::asio::placeholders::bytes_transferred)));
   }
 
+  // Closes the connection if no request has arrived on it yet. Otherwise
+  // the connection closes once the request has been answered.
+  void close_when_done() {
+    wrapper_.dispatch(std::bind(&sync_server_connection::handle_close_when_done,
+                                sync_server_connection::shared_from_this()));
+  }
+
  private:
+  friend class sync_server_impl;
+
+  void handle_close_when_done() {
+    if (has_request_)
+      return;
+    boost::system::error_code ignored;
+    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+    socket_.close(ignored);
+  }
 
   enum state_t {
     method,
@@ -82,10 +110,21 @@ class sync_server_connection
     body
   };
 
+  enum body_state_t {
+    no_body,
+    content,
+    chunk_size,
+    chunk_data,
+    chunk_data_end,
+    chunk_trailer,
+    body_done
+  };
+
   void handle_read_data(state_t state,
                         boost::system::error_code const& ec,
                         std::size_t bytes_transferred) {
     if (!ec) {
+      has_request_ = true;
       boost::logic::tribool parsed_ok;
       boost::iterator_range<buffer_type::iterator> result_range, input_range;
       data_end = read_buffer_.begin();
@@ -105,10 +144,6 @@ class sync_server_connection
             boost::trim(method);
             request_.set_method(method);
             new_start = boost::end(result_range);
-            // Determine whether we're going to need to parse the body of the
-            // request. All we do is peek at the first character of the method
-            // to determine whether it's a POST or a PUT.
-            read_body_ = method.size() ? method[0] == 'P' : false;
           } else {
             partial_parsed.append(boost::begin(result_range),
                                   boost::end(result_range));
@@ -146,17 +181,10 @@ class sync_server_connection
             client_error();
             break;
           } else if (parsed_ok == true) {
-            boost::fusion::tuple<uint8_t, uint8_t> version_pair;
-            partial_parsed.append(boost::begin(result_range),
-                                  boost::end(result_range));
-            parse_version(partial_parsed, version_pair);
-            request_.set_version_major(boost::fusion::get<0>(version_pair));
-            request_.set_version_minor(boost::fusion::get<1>(version_pair));
+            request_.set_version_major(parser_.version_major());
+            request_.set_version_minor(parser_.version_minor());
             new_start = boost::end(result_range);
-            partial_parsed.clear();
           } else {
-            partial_parsed.append(boost::begin(result_range),
-                                  boost::end(result_range));
             new_start = read_buffer_.begin();
             read_more(version);
             break;
@@ -169,38 +197,29 @@ class sync_server_connection
             client_error();
             break;
           } else if (parsed_ok == true) {
-            partial_parsed.append(boost::begin(result_range),
-                                  boost::end(result_range));
-            std::vector<std::pair<std::string, std::string>> headers;
-            parse_headers(partial_parsed, headers);
-            for (std::vector<
-                std::pair<std::string, std::string>>::const_iterator it =
-                     headers.begin();
-                 it != headers.end(); ++it) {
-              request_.append_header(it->first, it->second);
+            // The header block is only copied out of the read buffer when it
+            // took more than one read.
+            char const* block = &*new_start;
+            if (!partial_parsed.empty()) {
+              partial_parsed.append(boost::begin(result_range),
+                                    boost::end(result_range));
+              block = partial_parsed.data();
             }
+            append_headers(block);
             new_start = boost::end(result_range);
-            if (read_body_) {} else {
-              response response_;
-              handler_(request_, response_);
-              flatten_response();
-              std::vector<boost::asio::const_buffer> response_buffers(
-                  output_buffers_.size());
-              std::transform(output_buffers_.begin(),
-                             output_buffers_.end(),
-                             response_buffers.begin(),
-                             [](buffer_type const& buffer) {
-                return boost::asio::const_buffer(buffer.data(), buffer.size());
-              });
-              boost::asio::async_write(
-                  socket_,
-                  response_buffers,
-                  wrapper_.wrap(
-                      std::bind(&sync_server_connection::handle_write,
-                                  sync_server_connection::shared_from_this(),
-                                  boost::asio::placeholders::error)));
+            bool body_ok = start_body(block);
+            partial_parsed.clear();
+            if (!body_ok) {
+              if (body_too_large_)
+                entity_too_large();
+              else
+                client_error();
+              break;
+            }
+            if (expect_continue_ && body_state_ != body_done) {
+              send_continue();
+              break;
             }
-            return;
           } else {
             partial_parsed.append(boost::begin(result_range),
                                   boost::end(result_range));
@@ -208,6 +227,9 @@ class sync_server_connection
             read_more(headers);
             break;
           }
+        case body:
+          read_body();
+          break;
         default:
           BOOST_ASSERT(
               false &&
@@ -219,9 +241,219 @@ class sync_server_connection
     }
   }
 
+  // Reads the body from what is left of the read buffer, asking for more
+  // until the whole body has arrived.
+  void read_body() {
+    boost::logic::tribool parsed_ok = parse_body();
+    if (!parsed_ok) {
+      if (body_too_large_)
+        entity_too_large();
+      else
+        client_error();
+    } else if (parsed_ok == true) {
+      handle_request();
+    } else {
+      new_start = read_buffer_.begin();
+      read_more(body);
+    }
+  }
+
+  // Tells a client that waits for it before sending the body to go ahead.
+  void send_continue() {
+    static char const continue_reply[] = "HTTP/1.1 100 Continue\r\n\r\n";
+    boost::asio::async_write(
+        socket_,
+        boost::asio::buffer(continue_reply, sizeof(continue_reply) - 1),
+        wrapper_.wrap(std::bind(&sync_server_connection::handle_continue_sent,
+                                sync_server_connection::shared_from_this(),
+                                boost::asio::placeholders::error)));
+  }
+
+  void handle_continue_sent(boost::system::error_code const& ec) {
+    if (ec) {
+      error_encountered = boost::in_place<boost::system::system_error>(ec);
+      return;
+    }
+    read_body();
+  }
+
+  // Adds the headers the parser found in block to the request.
+  void append_headers(char const* block) {
+    std::vector<request_parser::header_field> const& fields =
+        parser_.header_fields();
+    for (std::vector<request_parser::header_field>::const_iterator it =
+             fields.begin();
+         it != fields.end(); ++it) {
+      request_.append_header(it->name(block).to_string(),
+                             it->value(block).to_string());
+    }
+  }
+
+  // Works out how the request body is delimited from the request headers.
+  // Returns false if the body can't be read.
+  bool start_body(char const* block) {
+    bool has_length = false, is_chunked = false, expects_continue = false;
+    std::size_t length = 0;
+    std::vector<request_parser::header_field> const& fields =
+        parser_.header_fields();
+    for (std::vector<request_parser::header_field>::const_iterator it =
+             fields.begin();
+         it != fields.end(); ++it) {
+      boost::string_ref name = it->name(block);
+      if (boost::iequals(name, "Transfer-Encoding")) {
+        // chunked has to be the last coding for the length to be known
+        std::string coding = boost::trim_copy(it->value(block).to_string());
+        if (!boost::iends_with(coding, "chunked"))
+          return false;
+        is_chunked = true;
+      } else if (boost::iequals(name, "Content-Length")) {
+        std::string value = boost::trim_copy(it->value(block).to_string());
+        if (value.empty() || value.find_first_not_of("0123456789") !=
+                                 std::string::npos)
+          return false;
+        try {
+          std::size_t parsed = boost::lexical_cast<std::size_t>(value);
+          if (has_length && parsed != length)
+            return false;
+          length = parsed;
+          has_length = true;
+        }
+        catch (boost::bad_lexical_cast const&) {
+          return false;
+        }
+      } else if (boost::iequals(name, "Expect")) {
+        expects_continue = boost::iequals(
+            boost::trim_copy(it->value(block).to_string()), "100-continue");
+      }
+    }
+    // HTTP/1.0 clients don't know 100 Continue, and don't wait for it
+    expect_continue_ = expects_continue &&
+                       (parser_.version_major() > 1 ||
+                        (parser_.version_major() == 1 &&
+                         parser_.version_minor() >= 1));
+
+    if (is_chunked) {
+      body_state_ = chunk_size;
+    } else if (has_length && length != 0) {
+      if (max_body_size_ >= 0 &&
+          length > static_cast<std::size_t>(max_body_size_)) {
+        body_too_large_ = true;
+        return false;
+      }
+      body_state_ = content;
+      body_remaining_ = length;
+    } else {
+      body_state_ = body_done;
+    }
+    return true;
+  }
+
+  // Reads the body from [new_start, data_end). Returns true once the whole
+  // body has been read, false if it is malformed or too large, and
+  // indeterminate if more data is needed.
+  boost::logic::tribool parse_body() {
+    while (body_state_ != body_done && new_start != data_end) {
+      switch (body_state_) {
+        case content:
+        case chunk_data: {
+          std::size_t available = std::min<std::size_t>(
+              body_remaining_, std::distance(new_start, data_end));
+          if (!append_body(&*new_start, available))
+            return false;
+          std::advance(new_start, available);
+          body_remaining_ -= available;
+          if (body_remaining_ == 0)
+            body_state_ = (body_state_ == content) ? body_done : chunk_data_end;
+          break;
+        }
+        case chunk_size: {
+          char c = *new_start++;
+          if (c != '\n') {
+            partial_parsed.push_back(c);
+            if (partial_parsed.size() > 1024)
+              return false;
+            break;
+          }
+          // chunk extensions are ignored
+          std::string size_line =
+              partial_parsed.substr(0, partial_parsed.find_first_of(";\r"));
+          boost::trim(size_line);
+          partial_parsed.clear();
+          if (size_line.empty() || size_line.size() > 2 * sizeof(std::size_t) ||
+              size_line.find_first_not_of("0123456789abcdefABCDEF") !=
+                  std::string::npos)
+            return false;
+          std::istringstream size_stream(size_line);
+          size_stream >> std::hex >> body_remaining_;
+          body_state_ = body_remaining_ ? chunk_data : chunk_trailer;
+          break;
+        }
+        case chunk_data_end: {
+          // the chunk data has to be followed by a CRLF
+          char c = *new_start++;
+          if (partial_parsed.empty() && c == '\r') {
+            partial_parsed.push_back(c);
+          } else if (partial_parsed == "\r" && c == '\n') {
+            partial_parsed.clear();
+            body_state_ = chunk_size;
+          } else {
+            return false;
+          }
+          break;
+        }
+        case chunk_trailer: {
+          // trailer fields are ignored, an empty line ends the body
+          char c = *new_start++;
+          if (c != '\n') {
+            partial_parsed.push_back(c);
+            if (partial_parsed.size() > 1024)
+              return false;
+            break;
+          }
+          if (partial_parsed.empty() || partial_parsed == "\r")
+            body_state_ = body_done;
+          partial_parsed.clear();
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    if (body_state_ == body_done)
+      return true;
+    return boost::logic::indeterminate;
+  }
+
+  bool append_body(char const* data, std::size_t size) {
+    body_size_ += size;
+    if (max_body_size_ >= 0 &&
+        body_size_ > static_cast<std::size_t>(max_body_size_)) {
+      body_too_large_ = true;
+      return false;
+    }
+    if (!size)
+      return true;
+    if (body_handler_)
+      body_handler_(request_, std::string(data, size));
+    else
+      request_.append_body(std::string(data, size));
+    return true;
+  }
+
+  void handle_request() {
+    handler_(request_, response_);
+    flatten_response();
+    boost::asio::async_write(
+        socket_,
+        boost::asio::buffer(output_),
+        wrapper_.wrap(std::bind(&sync_server_connection::handle_write,
+                                sync_server_connection::shared_from_this(),
+                                boost::asio::placeholders::error)));
+  }
+
   void handle_write(boost::system::error_code const& ec) {
-    // First thing we do is clear out the output buffers.
-    output_buffers_.clear();
+    // First thing we do is clear out the output buffer.
+    output_.clear();
     if (ec) {
       // TODO maybe log the error here.
     }
@@ -230,10 +462,19 @@ class sync_server_connection
   void client_error() {
     static char const bad_request[] =
         "HTTP/1.0 400 Bad Request\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: 12\r\n\r\nBad Request.";
+    write_error(bad_request);
+  }
 
+  void entity_too_large() {
+    static char const too_large[] =
+        "HTTP/1.0 413 Request Entity Too Large\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: 25\r\n\r\nRequest Entity Too Large.";
+    write_error(too_large);
+  }
+
+  void write_error(char const* reply) {
     boost::asio::async_write(
         socket(),
-        boost::asio::buffer(bad_request, strlen(bad_request)),
+        boost::asio::buffer(reply, strlen(reply)),
         wrapper_.wrap(
             std::bind(&sync_server_connection::client_error_sent,
                         sync_server_connection::shared_from_this(),
@@ -266,52 +507,29 @@ class sync_server_connection
     uint16_t status = http::status(response_);
     std::string status_message = http::status_message(response_);
     headers_wrapper::container_type headers = network::headers(response_);
-    std::ostringstream status_line;
-    status_line << status << constants::space() << status_message
-                << constants::space() << constants::http_slash()
-                << "1.1"  // TODO: make this a constant
-                << constants::crlf();
-    segmented_write(status_line.str());
-    std::ostringstream header_stream;
+    std::ostringstream response_stream;
+    response_stream << constants::http_slash()
+                    << "1.1"  // TODO: make this a constant
+                    << constants::space() << status << constants::space()
+                    << status_message << constants::crlf();
     auto it = std::begin(headers), end = std::end(headers);
     for (; it != end; ++it) {
       const auto& header = *it;
       //for (auto const &header : headers) {
-      header_stream << header.first << constants::colon() << constants::space()
-                    << header.second << constants::crlf();
-    }
-    header_stream << constants::crlf();
-    segmented_write(header_stream.str());
-    bool done = false;
-    while (!done) {
-      buffer_type buffer;
-      response_.get_body([&done, &buffer](std::string::const_iterator start,
-                                          size_t length) {
-        if (!length)
-          done = true;
-        else {
-          std::string::const_iterator past_end = start;
-          std::advance(past_end, length);
-          std::copy(start, past_end, buffer.begin());
-        }
-      },
-                         buffer.size());
-      if (!done)
-        output_buffers_.emplace_back(std::move(buffer));
-    }
-  }
-
-  void segmented_write(std::string data) {
-    while (!boost::empty(data)) {
-      buffer_type buffer;
-      auto end = std::copy_n(boost::begin(data), buffer.size(), buffer.begin());
-      data.erase(0, std::distance(buffer.begin(), end));
-      output_buffers_.emplace_back(std::move(buffer));
+      response_stream << header.first << constants::colon()
+                      << constants::space() << header.second
+                      << constants::crlf();
     }
+    response_stream << constants::crlf();
+    std::string body;
+    response_.get_body(body);
+    output_ = response_stream.str();
+    output_.append(body);
   }
 
   boost::asio::io_service& service_;
   std::function<void(request const&, response&)> handler_;
+  std::function<void(request const&, std::string const&)> body_handler_;
   boost::asio::ip::tcp::socket socket_;
   boost::asio::io_service::strand wrapper_;
 
@@ -322,10 +540,15 @@ class sync_server_connection
   request_parser parser_;
   request request_;
   response response_;
-  std::list<buffer_type> output_buffers_;
+  std::string output_;
   std::string partial_parsed;
   boost::optional<boost::system::system_error> error_encountered;
-  bool read_body_;
+  int max_body_size_;
+  std::size_t body_remaining_, body_size_;
+  body_state_t body_state_;
+  bool body_too_large_, expect_continue_, has_request_;
+  // Keeps the connection tracked by the server while it's open.
+  std::shared_ptr<void> registration_;
 };
 
 }       // namespace http
@@ -0,0 +1,35 @@
+// Copyright 2012 Dean Michael Berris <dberris@google.com>.
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_IMPL_ACCEPT_RETRY_HPP_20130610
+#define NETWORK_PROTOCOL_HTTP_SERVER_IMPL_ACCEPT_RETRY_HPP_20130610
+
+#include <algorithm>
+#include <chrono>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace network {
+namespace http {
+
+// Returns how long to wait before accepting again after a failed accept.
+// Errors that are likely to persist for a while, like running out of file
+// descriptors, back off exponentially from 10ms up to a second so that the
+// acceptor doesn't spin; a connection aborted by the peer is retried
+// straight away.
+inline std::chrono::milliseconds accept_retry_delay(
+    boost::system::error_code const& ec,
+    std::chrono::milliseconds previous_delay) {
+  if (ec == boost::asio::error::connection_aborted)
+    return std::chrono::milliseconds(0);
+  return std::min(std::max(previous_delay * 2, std::chrono::milliseconds(10)),
+                  std::chrono::milliseconds(1000));
+}
+
+}       // namespace http
+}       // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_IMPL_ACCEPT_RETRY_HPP_20130610
@@ -0,0 +1,75 @@
+// Copyright 2012 Dean Michael Berris <dberris@google.com>.
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_IMPL_FREE_LIST_HPP_20130612
+#define NETWORK_PROTOCOL_HTTP_SERVER_IMPL_FREE_LIST_HPP_20130612
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace network {
+namespace http {
+
+// Keeps up to max_size objects that are no longer used so that they can be
+// reused instead of being allocated again. Objects can be taken and given
+// back from any thread.
+template <class T> class free_list {
+ public:
+  explicit free_list(std::size_t max_size)
+      : mutex_(), spares_(), max_size_(max_size), is_open_(true) {}
+
+  ~free_list() { close(); }
+
+  // Returns a spare object, or 0 if there are none.
+  T* take() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spares_.empty())
+      return 0;
+    T* object = spares_.back();
+    spares_.pop_back();
+    return object;
+  }
+
+  // Keeps object to be taken again, or deletes it if the list is full or
+  // has been closed.
+  void give(T* object) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (is_open_ && spares_.size() < max_size_) {
+        spares_.push_back(object);
+        return;
+      }
+    }
+    delete object;
+  }
+
+  // Deletes the spare objects, and any objects given back from now on.
+  void close() {
+    std::vector<T*> spares;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_open_ = false;
+      spares.swap(spares_);
+    }
+    for (std::size_t i = 0; i < spares.size(); ++i)
+      delete spares[i];
+  }
+
+ private:
+  free_list(free_list const&);  // = delete
+  free_list& operator=(free_list const&);  // = delete
+
+  std::mutex mutex_;
+  std::vector<T*> spares_;
+  std::size_t max_size_;
+  bool is_open_;
+};
+
+}       // namespace http
+}       // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_IMPL_FREE_LIST_HPP_20130612
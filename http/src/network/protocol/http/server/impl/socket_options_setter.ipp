@@ -9,10 +9,16 @@
 
 #include <network/protocol/http/server/impl/socket_options_setter.hpp>
 #include <network/protocol/http/server/options.hpp>
+#include <boost/asio/detail/socket_option.hpp>
 
 namespace network {
 namespace http {
 
+#if defined(SO_REUSEPORT)
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>
+    reuse_port;
+#endif
+
 void socket_options_setter::set_socket_options(
     server_options const& options,
     boost::asio::ip::tcp::socket& socket) {
@@ -22,21 +28,25 @@ void socket_options_setter::set_socket_options(
     boost::asio::ip::tcp::socket::linger linger(true, options.linger_timeout());
     socket.set_option(linger, ignored);
   }
-  if (int buf_size = options.receive_buffer_size() >= 0) {
+  int buf_size = options.receive_buffer_size();
+  if (buf_size >= 0) {
     boost::asio::ip::tcp::socket::receive_buffer_size receive_buffer_size(
         buf_size);
     socket.set_option(receive_buffer_size, ignored);
   }
-  if (int buf_size = options.send_buffer_size() >= 0) {
+  buf_size = options.send_buffer_size();
+  if (buf_size >= 0) {
     boost::asio::ip::tcp::socket::send_buffer_size send_buffer_size(buf_size);
     socket.set_option(send_buffer_size, ignored);
   }
-  if (int buf_size = options.receive_low_watermark() >= 0) {
+  buf_size = options.receive_low_watermark();
+  if (buf_size >= 0) {
     boost::asio::ip::tcp::socket::receive_low_watermark receive_low_watermark(
         buf_size);
     socket.set_option(receive_low_watermark, ignored);
   }
-  if (int buf_size = options.send_low_watermark() >= 0) {
+  buf_size = options.send_low_watermark();
+  if (buf_size >= 0) {
     boost::asio::ip::tcp::socket::send_low_watermark send_low_watermark(
         buf_size);
     socket.set_option(send_low_watermark, ignored);
@@ -53,6 +63,10 @@ void socket_options_setter::set_acceptor_options(
   acceptor.set_option(boost::asio::ip::tcp::acceptor::enable_connection_aborted(
       options.report_aborted()),
                       ignored);
+#if defined(SO_REUSEPORT)
+  if (options.acceptor_shards() > 1)
+    acceptor.set_option(reuse_port(true), ignored);
+#endif
 }
 
 }       // namespace http
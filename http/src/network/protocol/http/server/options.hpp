@@ -73,6 +73,65 @@ class server_options {
   server_options& linger_timeout(int setting);
   int linger_timeout() const;
 
+  // Set the maximum number of requests served on a persistent (keep-alive)
+  // connection. 1 disables persistent connections, 0 means no limit.
+  server_options& max_requests_per_connection(int setting);
+  int max_requests_per_connection() const;
+
+  // Set the number of seconds a persistent connection is kept open while
+  // waiting for the next request. 0 means no limit.
+  server_options& idle_timeout(int setting);
+  int idle_timeout() const;
+
+  // Set the maximum size in bytes of a request body read by the sync server.
+  // Larger requests are refused with 413 Request Entity Too Large. -1 means
+  // no limit.
+  server_options& max_request_body_size(int setting);
+  int max_request_body_size() const;
+
+  // Set the number of acceptors the async server listens with. Each one is
+  // bound to the same address with SO_REUSEPORT and has its own io_service,
+  // so the kernel spreads new connections across them. The thread calling
+  // run() serves the first acceptor, the server starts a thread for each of
+  // the others. 1 means a single acceptor.
+  server_options& acceptor_shards(int setting);
+  int acceptor_shards() const;
+
+  // Set the number of accepts kept pending on each acceptor, each with a
+  // connection allocated ahead of time, so that bursts of new connections
+  // don't wait for each other to be accepted.
+  server_options& pending_accepts(int setting);
+  int pending_accepts() const;
+
+  // Pin each thread the server starts for an acceptor shard to its own CPU.
+  server_options& pin_acceptor_threads(bool setting);
+  bool pin_acceptor_threads() const;
+
+  // Run the async server's handlers and write callbacks inline on the
+  // connection's strand instead of posting them to the thread pool. This
+  // saves a thread hop and the connection's lock for every callback, but
+  // handlers must not block, and a connection may then only be used from
+  // its handler and callbacks.
+  server_options& inline_handlers(bool setting);
+  bool inline_handlers() const;
+
+  // Set the number of closed connections each acceptor keeps to reuse for
+  // the connections it accepts next. 0 means connections aren't reused.
+  server_options& spare_connections(int setting);
+  int spare_connections() const;
+
+  // Set the number of read buffers kept for reuse. Connections only hold a
+  // read buffer while a request is arriving, so this bounds the memory kept
+  // for reads by a server with mostly idle connections.
+  server_options& spare_read_buffers(int setting);
+  int spare_read_buffers() const;
+
+  // Set the number of seconds a server that's being drained waits for its
+  // connections to finish the requests they are handling before it stops
+  // anyway. 0 means it waits for as long as it takes.
+  server_options& drain_timeout(int setting);
+  int drain_timeout() const;
+
  private:
   server_options_pimpl* pimpl_;
 };
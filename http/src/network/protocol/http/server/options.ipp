@@ -24,10 +24,20 @@ class server_options_pimpl {
         receive_low_watermark_(-1),
         send_low_watermark_(-1),
         linger_timeout_(30),
+        max_requests_per_connection_(1000),
+        idle_timeout_(60),
+        max_request_body_size_(8 << 20),
+        acceptor_shards_(1),
+        pending_accepts_(1),
+        spare_connections_(64),
+        spare_read_buffers_(256),
+        drain_timeout_(30),
         reuse_address_(false),
         report_aborted_(false),
         non_blocking_io_(true),
-        linger_(false) {}
+        linger_(false),
+        pin_acceptor_threads_(false),
+        inline_handlers_(false) {}
 
   server_options_pimpl* clone() const {
     return new server_options_pimpl(*this);
@@ -87,6 +97,50 @@ class server_options_pimpl {
 
   int linger_timeout() const { return linger_timeout_; }
 
+  void max_requests_per_connection(int setting) {
+    max_requests_per_connection_ = setting;
+  }
+
+  int max_requests_per_connection() const {
+    return max_requests_per_connection_;
+  }
+
+  void idle_timeout(int setting) { idle_timeout_ = setting; }
+
+  int idle_timeout() const { return idle_timeout_; }
+
+  void max_request_body_size(int setting) { max_request_body_size_ = setting; }
+
+  int max_request_body_size() const { return max_request_body_size_; }
+
+  void acceptor_shards(int setting) { acceptor_shards_ = setting; }
+
+  int acceptor_shards() const { return acceptor_shards_; }
+
+  void pending_accepts(int setting) { pending_accepts_ = setting; }
+
+  int pending_accepts() const { return pending_accepts_; }
+
+  void pin_acceptor_threads(bool setting) { pin_acceptor_threads_ = setting; }
+
+  bool pin_acceptor_threads() const { return pin_acceptor_threads_; }
+
+  void inline_handlers(bool setting) { inline_handlers_ = setting; }
+
+  bool inline_handlers() const { return inline_handlers_; }
+
+  void spare_connections(int setting) { spare_connections_ = setting; }
+
+  int spare_connections() const { return spare_connections_; }
+
+  void spare_read_buffers(int setting) { spare_read_buffers_ = setting; }
+
+  int spare_read_buffers() const { return spare_read_buffers_; }
+
+  void drain_timeout(int setting) { drain_timeout_ = setting; }
+
+  int drain_timeout() const { return drain_timeout_; }
+
  private:
   std::string address_, port_;
   boost::asio::io_service* io_service_;
@@ -94,8 +148,17 @@ class server_options_pimpl {
       send_buffer_size_,
       receive_low_watermark_,
       send_low_watermark_,
-      linger_timeout_;
-  bool reuse_address_, report_aborted_, non_blocking_io_, linger_;
+      linger_timeout_,
+      max_requests_per_connection_,
+      idle_timeout_,
+      max_request_body_size_,
+      acceptor_shards_,
+      pending_accepts_,
+      spare_connections_,
+      spare_read_buffers_,
+      drain_timeout_;
+  bool reuse_address_, report_aborted_, non_blocking_io_, linger_,
+      pin_acceptor_threads_, inline_handlers_;
 
   server_options_pimpl(server_options_pimpl const& other)
       : address_(other.address_),
@@ -106,10 +169,20 @@ class server_options_pimpl {
         receive_low_watermark_(other.receive_low_watermark_),
         send_low_watermark_(other.send_low_watermark_),
         linger_timeout_(other.linger_timeout_),
+        max_requests_per_connection_(other.max_requests_per_connection_),
+        idle_timeout_(other.idle_timeout_),
+        max_request_body_size_(other.max_request_body_size_),
+        acceptor_shards_(other.acceptor_shards_),
+        pending_accepts_(other.pending_accepts_),
+        spare_connections_(other.spare_connections_),
+        spare_read_buffers_(other.spare_read_buffers_),
+        drain_timeout_(other.drain_timeout_),
         reuse_address_(other.reuse_address_),
         report_aborted_(other.report_aborted_),
         non_blocking_io_(other.non_blocking_io_),
-        linger_(other.linger_) {}
+        linger_(other.linger_),
+        pin_acceptor_threads_(other.pin_acceptor_threads_),
+        inline_handlers_(other.inline_handlers_) {}
 
 };
 
@@ -227,6 +300,94 @@ server_options& server_options::linger_timeout(int buffer_size) {
 
 int server_options::linger_timeout() const { return pimpl_->linger_timeout(); }
 
+server_options& server_options::max_requests_per_connection(int setting) {
+  pimpl_->max_requests_per_connection(setting);
+  return *this;
+}
+
+int server_options::max_requests_per_connection() const {
+  return pimpl_->max_requests_per_connection();
+}
+
+server_options& server_options::idle_timeout(int setting) {
+  pimpl_->idle_timeout(setting);
+  return *this;
+}
+
+int server_options::idle_timeout() const { return pimpl_->idle_timeout(); }
+
+server_options& server_options::max_request_body_size(int setting) {
+  pimpl_->max_request_body_size(setting);
+  return *this;
+}
+
+int server_options::max_request_body_size() const {
+  return pimpl_->max_request_body_size();
+}
+
+server_options& server_options::acceptor_shards(int setting) {
+  pimpl_->acceptor_shards(setting);
+  return *this;
+}
+
+int server_options::acceptor_shards() const {
+  return pimpl_->acceptor_shards();
+}
+
+server_options& server_options::pending_accepts(int setting) {
+  pimpl_->pending_accepts(setting);
+  return *this;
+}
+
+int server_options::pending_accepts() const {
+  return pimpl_->pending_accepts();
+}
+
+server_options& server_options::pin_acceptor_threads(bool setting) {
+  pimpl_->pin_acceptor_threads(setting);
+  return *this;
+}
+
+bool server_options::pin_acceptor_threads() const {
+  return pimpl_->pin_acceptor_threads();
+}
+
+server_options& server_options::inline_handlers(bool setting) {
+  pimpl_->inline_handlers(setting);
+  return *this;
+}
+
+bool server_options::inline_handlers() const {
+  return pimpl_->inline_handlers();
+}
+
+server_options& server_options::spare_connections(int setting) {
+  pimpl_->spare_connections(setting);
+  return *this;
+}
+
+int server_options::spare_connections() const {
+  return pimpl_->spare_connections();
+}
+
+server_options& server_options::spare_read_buffers(int setting) {
+  pimpl_->spare_read_buffers(setting);
+  return *this;
+}
+
+int server_options::spare_read_buffers() const {
+  return pimpl_->spare_read_buffers();
+}
+
+server_options& server_options::drain_timeout(int setting) {
+  pimpl_->drain_timeout(setting);
+  return *this;
+}
+
+int server_options::drain_timeout() const {
+  return pimpl_->drain_timeout();
+}
+
 }       // namespace http
 
 }       // namespace network
@@ -7,11 +7,15 @@
 #ifndef NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_PARSER_HPP_20101005
 #define NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_PARSER_HPP_20101005
 
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <utility>
+#include <vector>
 #include <boost/range/iterator_range.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <boost/logic/tribool.hpp>
 #include <boost/fusion/tuple.hpp>
-#include <boost/algorithm/string/classification.hpp>
 
 namespace network {
 namespace http {
@@ -43,15 +47,50 @@ struct request_parser {
     headers_done
   };
 
+  // Where a header's name and value are in the header block, the bytes that
+  // follow the request line.
+  struct header_field {
+    explicit header_field(std::size_t name_begin)
+        : name_begin(name_begin), name_end(name_begin),
+          value_begin(name_begin), value_end(name_begin) {}
+
+    boost::string_ref name(char const* block) const {
+      return boost::string_ref(block + name_begin, name_end - name_begin);
+    }
+
+    boost::string_ref value(char const* block) const {
+      return boost::string_ref(block + value_begin, value_end - value_begin);
+    }
+
+    std::size_t name_begin, name_end, value_begin, value_end;
+  };
+
   explicit request_parser(state_t start_state = method_start)
-      : internal_state(start_state) {}
+      : internal_state(start_state),
+        version_major_(0),
+        version_minor_(0),
+        header_offset_(0),
+        header_fields_() {}
 
   void reset(state_t start_state = method_start) {
     internal_state = method_start;
+    version_major_ = version_minor_ = 0;
+    header_offset_ = 0;
+    header_fields_.clear();
   }
 
   state_t state() const { return internal_state; }
 
+  // The version, once the parser is past version_done.
+  std::uint8_t version_major() const { return version_major_; }
+  std::uint8_t version_minor() const { return version_minor_; }
+
+  // The headers the parser has gone through. Only the offsets are kept, the
+  // caller holds on to the bytes.
+  std::vector<header_field> const& header_fields() const {
+    return header_fields_;
+  }
+
   template <class Range>
   boost::fusion::tuple<
       boost::logic::tribool,
@@ -68,33 +107,35 @@ struct request_parser {
     while (!boost::empty(local_range) && stop_state != internal_state &&
            indeterminate(parsed_ok)) {
       current_iterator = boost::begin(local_range);
+      state_t current_state = internal_state;
+      unsigned char const c = *current_iterator;
       switch (internal_state) {
         case method_start:
-          if (boost::algorithm::is_upper()(*current_iterator))
+          if (std::isupper(c))
             internal_state = method_char;
           else
             parsed_ok = false;
           break;
         case method_char:
-          if (boost::algorithm::is_upper()(*current_iterator))
+          if (std::isupper(c))
             break;
-          else if (boost::algorithm::is_space()(*current_iterator))
+          else if (std::isspace(c))
             internal_state = method_done;
           else
             parsed_ok = false;
           break;
         case method_done:
-          if (boost::algorithm::is_cntrl()(*current_iterator))
+          if (std::iscntrl(c))
             parsed_ok = false;
-          else if (boost::algorithm::is_space()(*current_iterator))
+          else if (std::isspace(c))
             parsed_ok = false;
           else
             internal_state = uri_char;
           break;
         case uri_char:
-          if (boost::algorithm::is_cntrl()(*current_iterator))
+          if (std::iscntrl(c))
             parsed_ok = false;
-          else if (boost::algorithm::is_space()(*current_iterator))
+          else if (std::isspace(c))
             internal_state = uri_done;
           break;
         case uri_done:
@@ -128,10 +169,12 @@ struct request_parser {
             parsed_ok = false;
           break;
         case version_slash:
-          if (boost::algorithm::is_digit()(*current_iterator))
+          if (std::isdigit(c)) {
+            version_major_ = *current_iterator - '0';
             internal_state = version_d1;
-          else
+          } else {
             parsed_ok = false;
+          }
           break;
         case version_d1:
           if (*current_iterator == '.')
@@ -140,10 +183,12 @@ struct request_parser {
             parsed_ok = false;
           break;
         case version_dot:
-          if (boost::algorithm::is_digit()(*current_iterator))
+          if (std::isdigit(c)) {
+            version_minor_ = *current_iterator - '0';
             internal_state = version_d2;
-          else
+          } else {
             parsed_ok = false;
+          }
           break;
         case version_d2:
           if (*current_iterator == '\r')
@@ -158,33 +203,38 @@ struct request_parser {
             parsed_ok = false;
           break;
         case version_done:
-          if (boost::algorithm::is_alnum()(*current_iterator))
+          if (std::isalnum(c)) {
+            header_fields_.push_back(header_field(header_offset_));
             internal_state = header_name;
-          else if (*current_iterator == '\r')
+          } else if (*current_iterator == '\r') {
             internal_state = headers_cr;
-          else
+          } else {
             parsed_ok = false;
+          }
           break;
         case header_name:
-          if (*current_iterator == ':')
+          if (*current_iterator == ':') {
+            header_fields_.back().name_end = header_offset_;
             internal_state = header_colon;
-          else if (boost::algorithm::is_alnum()(*current_iterator) ||
-                   boost::algorithm::is_punct()(*current_iterator))
-            break;
-          else
+          } else if (!std::isalnum(c) && !std::ispunct(c)) {
             parsed_ok = false;
+          }
           break;
         case header_colon:
-          if (*current_iterator == ' ')
+          if (*current_iterator == ' ') {
+            header_fields_.back().value_begin = header_offset_ + 1;
             internal_state = header_value;
-          else
+          } else {
             parsed_ok = false;
+          }
           break;
         case header_value:
-          if (*current_iterator == '\r')
+          if (*current_iterator == '\r') {
+            header_fields_.back().value_end = header_offset_;
             internal_state = header_cr;
-          else if (boost::algorithm::is_cntrl()(*current_iterator))
+          } else if (std::iscntrl(c)) {
             parsed_ok = false;
+          }
           break;
         case header_cr:
           if (*current_iterator == '\n')
@@ -193,12 +243,14 @@ struct request_parser {
             parsed_ok = false;
           break;
         case header_line_done:
-          if (*current_iterator == '\r')
+          if (*current_iterator == '\r') {
             internal_state = headers_cr;
-          else if (boost::algorithm::is_alnum()(*current_iterator))
+          } else if (std::isalnum(c)) {
+            header_fields_.push_back(header_field(header_offset_));
             internal_state = header_name;
-          else
+          } else {
             parsed_ok = false;
+          }
           break;
         case headers_cr:
           if (*current_iterator == '\n')
@@ -213,6 +265,8 @@ struct request_parser {
           parsed_ok = false;
       }
       ;
+      if (current_state >= version_done)
+        ++header_offset_;
       if (internal_state == stop_state)
         parsed_ok = true;
       local_range = boost::make_iterator_range(++current_iterator, end);
@@ -224,6 +278,9 @@ struct request_parser {
 
  private:
   state_t internal_state;
+  std::uint8_t version_major_, version_minor_;
+  std::size_t header_offset_;
+  std::vector<header_field> header_fields_;
 
 };
 
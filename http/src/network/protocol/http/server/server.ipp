@@ -19,6 +19,13 @@ sync_server<SyncHandler>::sync_server(server_options const& options,
                                       SyncHandler& handler)
     : pimpl_(new sync_server_impl(options, handler)) {}
 
+template <class SyncHandler>
+sync_server<SyncHandler>::sync_server(
+    server_options const& options,
+    SyncHandler& handler,
+    std::function<void(request const&, std::string const&)> body_handler)
+    : pimpl_(new sync_server_impl(options, handler, body_handler)) {}
+
 template <class SyncHandler> void sync_server<SyncHandler>::run() {
   pimpl_->run();
 }
@@ -31,6 +38,10 @@ template <class SyncHandler> void sync_server<SyncHandler>::listen() {
   pimpl_->listen();
 }
 
+template <class SyncHandler> void sync_server<SyncHandler>::drain() {
+  pimpl_->drain();
+}
+
 template <class SyncHandler> sync_server<SyncHandler>::~sync_server() {
   delete pimpl_;
 }
@@ -53,6 +64,10 @@ template <class AsyncHandler> void async_server<AsyncHandler>::listen() {
   pimpl_->listen();
 }
 
+template <class AsyncHandler> void async_server<AsyncHandler>::drain() {
+  pimpl_->drain();
+}
+
 template <class SyncHandler> async_server<SyncHandler>::~async_server() {
   delete pimpl_;
 }
@@ -11,9 +11,13 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <vector>
+#include <chrono>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <network/protocol/http/server/impl/socket_options_setter.hpp>
 #include <network/protocol/http/server/options.hpp>
+#include <http/server/default_connection_manager.hpp>
 
 namespace network {
 namespace http {
@@ -25,23 +29,46 @@ struct response;
 class sync_server_impl : protected socket_options_setter {
  public:
   sync_server_impl(server_options const& options,
-                   std::function<void(request const&, response&)> handler);
+                   std::function<void(request const&, response&)> handler,
+                   std::function<void(request const&, std::string const&)>
+                       body_handler =
+                       std::function<void(request const&,
+                                          std::string const&)>());
   void run();
   void stop();
   void listen();
+  void drain();
 
  private:
+  // An accept kept pending on the acceptor, with the connection allocated
+  // for it ahead of time.
+  struct pending_accept {
+    explicit pending_accept(boost::asio::io_service& service);
+    std::shared_ptr<sync_server_connection> connection;
+    boost::asio::steady_timer retry_timer;
+    std::chrono::milliseconds retry_delay;
+  };
+
   server_options options_;
   std::string address_, port_;
   boost::asio::io_service* service_;
   boost::asio::ip::tcp::acceptor* acceptor_;
-  std::shared_ptr<sync_server_connection> new_connection_;
+  std::vector<std::unique_ptr<pending_accept>> accepts_;
+  default_connection_manager connections_;
+  std::unique_ptr<boost::asio::steady_timer> drain_timer_;
   std::mutex listening_mutex_;
   bool listening_, owned_service_;
   std::function<void(request const&, response&)> handler_;
+  std::function<void(request const&, std::string const&)> body_handler_;
 
+  void stop_accepting();
+  void handle_drain_timeout(boost::system::error_code const& ec);
   void start_listening();
-  void handle_accept(boost::system::error_code const& ec);
+  void accept(std::size_t slot);
+  void async_accept(std::size_t slot);
+  void handle_accept(std::size_t slot, boost::system::error_code const& ec);
+  void handle_accept_retry(std::size_t slot,
+                           boost::system::error_code const& ec);
 };
 
 }       // namespace http
@@ -10,23 +10,34 @@
 #include <boost/bind.hpp>
 #include <network/protocol/http/server/sync_impl.hpp>
 #include <network/protocol/http/server/connection/sync.hpp>
+#include <network/protocol/http/server/impl/accept_retry.hpp>
 #include <network/detail/debug.hpp>
+#include <algorithm>
 
 namespace network {
 namespace http {
 
+sync_server_impl::pending_accept::pending_accept(
+    boost::asio::io_service& service)
+    : connection(), retry_timer(service), retry_delay(0) {}
+
 sync_server_impl::sync_server_impl(
     server_options const& options,
-    std::function<void(request const&, response&)> handler)
+    std::function<void(request const&, response&)> handler,
+    std::function<void(request const&, std::string const&)> body_handler)
     : options_(options),
       address_(options.address()),
       port_(options.port()),
       service_(options.io_service()),
       acceptor_(0),
-      new_connection_(),
+      accepts_(),
+      connections_(),
+      drain_timer_(),
       listening_mutex_(),
       listening_(false),
-      owned_service_(false) {
+      owned_service_(false),
+      handler_(handler),
+      body_handler_(body_handler) {
   if (service_ == 0) {
     service_ = new boost::asio::io_service;
     owned_service_ = true;
@@ -34,6 +45,10 @@ sync_server_impl::sync_server_impl(
   }
   acceptor_ = new boost::asio::ip::tcp::acceptor(*service_);
   BOOST_ASSERT(acceptor_ != 0);
+  drain_timer_.reset(new boost::asio::steady_timer(*service_));
+  int accepts = std::max(options.pending_accepts(), 1);
+  for (int slot = 0; slot < accepts; ++slot)
+    accepts_.emplace_back(new pending_accept(*service_));
 }
 
 void sync_server_impl::run() {
@@ -42,8 +57,48 @@ void sync_server_impl::run() {
 }
 
 void sync_server_impl::stop() {
+  {
+    std::lock_guard<std::mutex> listening_lock(listening_mutex_);
+    stop_accepting();
+  }
+  service_->stop();
+}
+
+void sync_server_impl::drain() {
+  std::lock_guard<std::mutex> listening_lock(listening_mutex_);
+  if (!listening_)
+    return;
+  stop_accepting();
+  NETWORK_MESSAGE("draining " << connections_.size() << " connections on "
+                              << address_ << ':' << port_);
+  if (options_.drain_timeout() > 0) {
+    drain_timer_->expires_from_now(
+        std::chrono::seconds(options_.drain_timeout()));
+    drain_timer_->async_wait(
+        boost::bind(&sync_server_impl::handle_drain_timeout,
+                    this,
+                    boost::asio::placeholders::error));
+  }
+  connections_.drain(
+      boost::bind(&boost::asio::io_service::stop, service_));
+}
+
+// listening_mutex_ must be held.
+void sync_server_impl::stop_accepting() {
   boost::system::error_code ignored;
   acceptor_->close(ignored);
+  for (std::size_t slot = 0; slot < accepts_.size(); ++slot)
+    accepts_[slot]->retry_timer.cancel(ignored);
+  listening_ = false;
+}
+
+void sync_server_impl::handle_drain_timeout(
+    boost::system::error_code const& ec) {
+  if (ec)
+    return;
+  NETWORK_MESSAGE("stopping with " << connections_.size()
+                                   << " connections still open on "
+                                   << address_ << ':' << port_);
   service_->stop();
 }
 
@@ -53,24 +108,70 @@ void sync_server_impl::listen() {
     start_listening();
 }
 
-void sync_server_impl::handle_accept(boost::system::error_code const& ec) {
+void sync_server_impl::accept(std::size_t slot) {
+  accepts_[slot]->connection.reset(
+      new sync_server_connection(*service_,
+                                 handler_,
+                                 body_handler_,
+                                 options_.max_request_body_size()));
+  async_accept(slot);
+}
+
+void sync_server_impl::async_accept(std::size_t slot) {
+  acceptor_->async_accept(accepts_[slot]->connection->socket(),
+                          boost::bind(&sync_server_impl::handle_accept,
+                                      this,
+                                      slot,
+                                      boost::asio::placeholders::error));
+}
+
+void sync_server_impl::handle_accept(std::size_t slot,
+                                     boost::system::error_code const& ec) {
+  pending_accept& pending = *accepts_[slot];
   if (!ec) {
-    set_socket_options(options_, new_connection_->socket());
-    new_connection_->start();
-    new_connection_.reset(new sync_server_connection(*service_, handler_));
-    acceptor_->async_accept(new_connection_->socket(),
-                            boost::bind(&sync_server_impl::handle_accept,
-                                        this,
-                                        boost::asio::placeholders::error));
-  } else {
+    pending.retry_delay = std::chrono::milliseconds(0);
+    set_socket_options(options_, pending.connection->socket());
+    // Draining asks the connection to close, unless it's already gone.
+    std::weak_ptr<sync_server_connection> connection = pending.connection;
+    pending.connection->registration_ = connections_.add([connection]() {
+      if (std::shared_ptr<sync_server_connection> open = connection.lock())
+        open->close_when_done();
+    });
+    pending.connection->start();
+    accept(slot);
+  } else if (ec != boost::asio::error::operation_aborted) {
     NETWORK_MESSAGE("error accepting connection: " << ec);
-    this->stop();
+    // The connection wasn't used, so it takes the next accept.
+    pending.retry_delay = accept_retry_delay(ec, pending.retry_delay);
+    if (pending.retry_delay == std::chrono::milliseconds(0)) {
+      async_accept(slot);
+      return;
+    }
+    pending.retry_timer.expires_from_now(pending.retry_delay);
+    pending.retry_timer.async_wait(
+        boost::bind(&sync_server_impl::handle_accept_retry,
+                    this,
+                    slot,
+                    boost::asio::placeholders::error));
   }
 }
 
+void sync_server_impl::handle_accept_retry(
+    std::size_t slot,
+    boost::system::error_code const& ec) {
+  if (!ec && acceptor_->is_open())
+    async_accept(slot);
+}
+
 void sync_server_impl::start_listening() {
   using boost::asio::ip::tcp;
   boost::system::error_code error;
+  // an earlier drain neither closes the connections accepted from now on
+  // nor stops the server when it would have timed out
+  connections_.resume();
+  drain_timer_->cancel(error);
+  // allows repeated cycles of run->stop->run
+  service_->reset();
   tcp::resolver resolver(*service_);
   tcp::resolver::query query(address_, port_);
   tcp::resolver::iterator endpoint_ = resolver.resolve(query, error);
@@ -107,11 +208,8 @@ void sync_server_impl::start_listening() {
     BOOST_THROW_EXCEPTION(
         std::runtime_error("Error listening on socket for acceptor."));
   }
-  new_connection_.reset(new sync_server_connection(*service_, handler_));
-  acceptor_->async_accept(new_connection_->socket(),
-                          boost::bind(&sync_server_impl::handle_accept,
-                                      this,
-                                      boost::asio::placeholders::error));
+  for (std::size_t slot = 0; slot < accepts_.size(); ++slot)
+    accept(slot);
   listening_ = true;
 }
 
@@ -0,0 +1,654 @@
+// Copyright 2013 (c) Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include <network/protocol/http/server.hpp>
+#include <network/protocol/http/server/connection/async.hpp>
+#include <network/protocol/http/server/impl/accept_retry.hpp>
+#include <network/protocol/http/server/impl/free_list.hpp>
+#include <network/utils/thread_pool.hpp>
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace http = network::http;
+namespace utils = network::utils;
+using boost::asio::ip::tcp;
+
+namespace {
+
+typedef std::shared_ptr<http::async_server_connection> connection_ptr;
+typedef std::function<void(http::request const&, connection_ptr)> handler_type;
+
+void set_content_length(connection_ptr connection, std::size_t length) {
+  std::vector<http::response_header> headers(
+      1, http::response_header{"Content-Length", std::to_string(length)});
+  connection->set_headers(headers);
+}
+
+// Answers every request with its destination.
+void echo_destination(http::request const& request, connection_ptr connection) {
+  std::string destination;
+  request.get_destination(destination);
+  set_content_length(connection, destination.size());
+  connection->write(std::move(destination));
+}
+
+// Reads the whole request body, then answers with it.
+struct body_echo {
+  void operator()(http::async_server_connection::input_range input,
+                  boost::system::error_code const& ec,
+                  std::size_t,
+                  connection_ptr connection) {
+    if (ec) {
+      set_content_length(connection, body->size());
+      connection->write(std::move(*body));
+      return;
+    }
+    body->append(boost::begin(input), boost::end(input));
+    connection->read(*this);
+  }
+
+  std::shared_ptr<std::string> body;
+};
+
+void echo_body(http::request const&, connection_ptr connection) {
+  connection->read(body_echo{std::make_shared<std::string>()});
+}
+
+std::string post(std::string const& destination, std::string const& body) {
+  return "POST " + destination + " HTTP/1.1\r\nHost: localhost\r\n"
+         "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// Returns size bytes that aren't all the same, so that misplaced data shows.
+std::string make_body(std::size_t size) {
+  std::string body(size, '\0');
+  for (std::size_t i = 0; i < size; ++i)
+    body[i] = 'a' + (i * 7) % 26;
+  return body;
+}
+
+// Returns a port nothing is listening on.
+std::string free_port() {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor(
+      io_service,
+      tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+  return std::to_string(acceptor.local_endpoint().port());
+}
+
+// A connection to the server under test. Reads give up after five seconds,
+// so that a server that doesn't answer fails the test instead of hanging it.
+class test_connection {
+ public:
+  // The socket is opened right away, but only connected if connect_now is
+  // set, so that a test can connect it while descriptors are scarce.
+  explicit test_connection(std::string const& port, bool connect_now = true)
+      : socket_(io_service_, tcp::v4()), port_(port) {
+    timeval timeout = {5, 0};
+    ::setsockopt(socket_.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                 sizeof(timeout));
+    if (connect_now)
+      connect();
+  }
+
+  void connect() {
+    socket_.connect(tcp::endpoint(
+        boost::asio::ip::address::from_string("127.0.0.1"),
+        static_cast<unsigned short>(std::stoi(port_))));
+  }
+
+  void send(std::string const& data) {
+    boost::asio::write(socket_, boost::asio::buffer(data));
+  }
+
+  std::string get(std::string const& destination,
+                  std::string const& headers = std::string()) {
+    send("GET " + destination + " HTTP/1.1\r\nHost: localhost\r\n" + headers +
+         "\r\n");
+    return read_response();
+  }
+
+  // Reads a response that has a Content-Length, and returns all of it, or
+  // what arrived of it if the connection was closed.
+  std::string read_response() {
+    std::string::size_type head_size;
+    while ((head_size = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (!receive())
+        return take(buffer_.size());
+    }
+    head_size += 4;
+    std::size_t body_size = 0;
+    std::string::size_type length = buffer_.find("Content-Length: ");
+    if (length != std::string::npos && length < head_size)
+      body_size = std::stoul(buffer_.substr(length + 16));
+    while (buffer_.size() < head_size + body_size && receive()) {
+    }
+    return take(std::min(buffer_.size(), head_size + body_size));
+  }
+
+  // Tests if the server has closed the connection.
+  bool is_closed() {
+    char c;
+    return ::recv(socket_.native_handle(), &c, 1, 0) == 0 ||
+           errno == ECONNRESET;
+  }
+
+ private:
+  // Appends what arrives to the buffer, returns false if nothing did.
+  // asio's blocking reads wait again when SO_RCVTIMEO expires, so the
+  // socket is read directly.
+  bool receive() {
+    char data[4096];
+    ssize_t size = ::recv(socket_.native_handle(), data, sizeof(data), 0);
+    if (size <= 0)
+      return false;
+    buffer_.append(data, size);
+    return true;
+  }
+
+  std::string take(std::size_t size) {
+    std::string data = buffer_.substr(0, size);
+    buffer_.erase(0, size);
+    return data;
+  }
+
+  boost::asio::io_service io_service_;
+  tcp::socket socket_;
+  std::string port_;
+  std::string buffer_;
+};
+
+bool has_header(std::string const& response, std::string const& header) {
+  return response.find("\r\n" + header + "\r\n") != std::string::npos;
+}
+
+bool has_body(std::string const& response, std::string const& body) {
+  return response.size() >= body.size() &&
+         response.compare(response.size() - body.size(), body.size(), body) ==
+             0;
+}
+
+// A file holding contents that is removed when the test is done with it.
+class temporary_file {
+ public:
+  explicit temporary_file(std::string const& contents) {
+    char path[] = "/tmp/async_server_test.XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd == -1)
+      throw std::runtime_error("can't create a temporary file");
+    path_ = path;
+    ssize_t written = ::write(fd, contents.data(), contents.size());
+    ::close(fd);
+    if (written != static_cast<ssize_t>(contents.size()))
+      throw std::runtime_error("can't write the temporary file");
+  }
+
+  ~temporary_file() { ::unlink(path_.c_str()); }
+
+  std::string const& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+// Runs an async server on a loopback port for the duration of a test.
+class async_server_test : public ::testing::Test {
+ protected:
+  async_server_test() : pool_(2), port_(free_port()) {}
+
+  ~async_server_test() {
+    if (server_) {
+      server_->stop();
+      thread_.join();
+    }
+  }
+
+  http::server_options options() const {
+    return http::server_options().address("127.0.0.1").port(port_)
+        .reuse_address(true);
+  }
+
+  void start(http::server_options const& options,
+             handler_type handler = echo_destination) {
+    handler_ = handler;
+    server_.reset(
+        new http::async_server<handler_type>(options, handler_, pool_));
+    server_->listen();
+    thread_ = std::thread([this]() { server_->run(); });
+  }
+
+  utils::thread_pool pool_;
+  std::string port_;
+  handler_type handler_;
+  std::unique_ptr<http::async_server<handler_type>> server_;
+  std::thread thread_;
+};
+
+TEST_F(async_server_test, serves_several_requests_on_a_connection) {
+  start(options());
+  test_connection connection(port_);
+  for (auto destination : {"/first", "/second", "/third"}) {
+    std::string response = connection.get(destination);
+    EXPECT_TRUE(has_body(response, destination)) << response;
+    EXPECT_FALSE(has_header(response, "Connection: close")) << response;
+  }
+}
+
+TEST_F(async_server_test, serves_pipelined_requests_in_order) {
+  start(options());
+  test_connection connection(port_);
+  connection.send(
+      "GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+      "GET /second HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  EXPECT_TRUE(has_body(connection.read_response(), "/first"));
+  EXPECT_TRUE(has_body(connection.read_response(), "/second"));
+}
+
+TEST_F(async_server_test, closes_after_max_requests) {
+  start(options().max_requests_per_connection(2));
+  test_connection connection(port_);
+  std::string first = connection.get("/first");
+  EXPECT_FALSE(has_header(first, "Connection: close")) << first;
+  std::string second = connection.get("/second");
+  EXPECT_TRUE(has_header(second, "Connection: close")) << second;
+  EXPECT_TRUE(connection.is_closed());
+}
+
+TEST_F(async_server_test, closes_when_the_client_asks) {
+  start(options());
+  test_connection connection(port_);
+  std::string response = connection.get("/", "Connection: close\r\n");
+  EXPECT_TRUE(has_header(response, "Connection: close")) << response;
+  EXPECT_TRUE(connection.is_closed());
+}
+
+TEST_F(async_server_test, keeps_http_1_0_connections_only_when_asked) {
+  start(options());
+  test_connection kept(port_);
+  kept.send("GET /kept HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+  std::string response = kept.read_response();
+  EXPECT_TRUE(has_header(response, "Connection: keep-alive")) << response;
+  EXPECT_TRUE(has_body(kept.get("/again"), "/again"));
+
+  test_connection closed(port_);
+  closed.send("GET /closed HTTP/1.0\r\n\r\n");
+  EXPECT_TRUE(has_body(closed.read_response(), "/closed"));
+  EXPECT_TRUE(closed.is_closed());
+}
+
+TEST_F(async_server_test, keeps_the_connection_after_a_body_is_read) {
+  start(options(), echo_body);
+  test_connection connection(port_);
+  std::string const body = make_body(10000);
+  connection.send(post("/", body) + post("/", "second"));
+  std::string response = connection.read_response();
+  EXPECT_TRUE(has_body(response, body));
+  EXPECT_FALSE(has_header(response, "Connection: close")) << response;
+  EXPECT_TRUE(has_body(connection.read_response(), "second"));
+  EXPECT_TRUE(has_header(connection.get("/"), "Content-Length: 0"));
+}
+
+TEST_F(async_server_test, inline_handlers_keep_the_connection_after_a_body) {
+  start(options().inline_handlers(true), echo_body);
+  test_connection connection(port_);
+  std::string const body = make_body(10000);
+  connection.send(post("/", body));
+  EXPECT_TRUE(has_body(connection.read_response(), body));
+  connection.send(post("/", "second"));
+  EXPECT_TRUE(has_body(connection.read_response(), "second"));
+}
+
+TEST_F(async_server_test, skips_a_body_the_handler_leaves_unread) {
+  start(options());
+  test_connection connection(port_);
+  connection.send(post("/first", make_body(10000)));
+  std::string response = connection.read_response();
+  EXPECT_TRUE(has_body(response, "/first"));
+  EXPECT_FALSE(has_header(response, "Connection: close")) << response;
+  EXPECT_TRUE(has_body(connection.get("/second"), "/second"));
+}
+
+TEST_F(async_server_test, closes_when_too_much_body_is_left_unread) {
+  start(options());
+  test_connection connection(port_);
+  connection.send(
+      "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 1000000\r\n\r\n");
+  std::string response = connection.read_response();
+  EXPECT_TRUE(has_header(response, "Connection: close")) << response;
+  EXPECT_TRUE(connection.is_closed());
+}
+
+TEST_F(async_server_test, closes_after_a_chunked_body) {
+  start(options());
+  test_connection connection(port_);
+  connection.send(
+      "POST / HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n");
+  std::string response = connection.read_response();
+  EXPECT_TRUE(has_header(response, "Connection: close")) << response;
+  EXPECT_TRUE(connection.is_closed());
+}
+
+TEST_F(async_server_test, idle_timeout_closes_silent_connections) {
+  start(options().idle_timeout(1));
+  auto started = std::chrono::steady_clock::now();
+  test_connection silent(port_);
+  EXPECT_TRUE(silent.is_closed());
+  EXPECT_GT(std::chrono::seconds(3),
+            std::chrono::steady_clock::now() - started);
+}
+
+TEST_F(async_server_test, idle_timeout_closes_connections_between_requests) {
+  start(options().idle_timeout(1));
+  test_connection connection(port_);
+  EXPECT_TRUE(has_body(connection.get("/"), "/"));
+  EXPECT_TRUE(connection.is_closed());
+}
+
+TEST_F(async_server_test, writes_moved_strings) {
+  std::string const body = make_body(1 << 20);
+  start(options(), [&body](http::request const&, connection_ptr connection) {
+    set_content_length(connection, body.size());
+    connection->write(std::string(body));
+  });
+  test_connection connection(port_);
+  EXPECT_TRUE(has_body(connection.get("/"), body));
+}
+
+TEST_F(async_server_test, writes_shared_buffers) {
+  std::string const body = make_body(1 << 20);
+  start(options(), [&body](http::request const&, connection_ptr connection) {
+    std::shared_ptr<char> data(new char[body.size()],
+                               std::default_delete<char[]>());
+    std::copy(body.begin(), body.end(), data.get());
+    set_content_length(connection, body.size());
+    connection->write(std::shared_ptr<char const>(data), body.size());
+  });
+  test_connection connection(port_);
+  EXPECT_TRUE(has_body(connection.get("/"), body));
+}
+
+TEST_F(async_server_test, writes_owned_buffer_sequences) {
+  std::string const body = make_body(3 << 16);
+  std::promise<boost::system::error_code> written;
+  start(options(), [&](http::request const&, connection_ptr connection) {
+    std::shared_ptr<std::string> owner = std::make_shared<std::string>(body);
+    std::size_t third = owner->size() / 3;
+    std::vector<boost::asio::const_buffer> buffers;
+    for (std::size_t i = 0; i < 3; ++i)
+      buffers.push_back(boost::asio::buffer(owner->data() + i * third, third));
+    set_content_length(connection, body.size());
+    connection->write(buffers, owner, [&](boost::system::error_code ec) {
+      written.set_value(ec);
+    });
+  });
+  test_connection connection(port_);
+  EXPECT_TRUE(has_body(connection.get("/"), body));
+  EXPECT_FALSE(written.get_future().get());
+}
+
+TEST_F(async_server_test, writes_file_ranges) {
+  std::string const contents = make_body(1 << 20);
+  temporary_file file(contents);
+  start(options(), [&](http::request const&, connection_ptr connection) {
+    set_content_length(connection, contents.size() - 100);
+    connection->write_file(file.path(), 100, contents.size() - 100,
+                           [](boost::system::error_code) {});
+  });
+  test_connection connection(port_);
+  EXPECT_TRUE(has_body(connection.get("/"), contents.substr(100)));
+}
+
+TEST_F(async_server_test, fails_file_writes_past_the_end_of_the_file) {
+  std::string const contents = make_body(1 << 16);
+  temporary_file file(contents);
+  std::promise<boost::system::error_code> written;
+  start(options(), [&](http::request const&, connection_ptr connection) {
+    set_content_length(connection, contents.size() + 100);
+    connection->write_file(file.path(), 0, contents.size() + 100,
+                           [&](boost::system::error_code ec) {
+      written.set_value(ec);
+    });
+  });
+  test_connection connection(port_);
+  connection.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  std::future<boost::system::error_code> result = written.get_future();
+  ASSERT_EQ(std::future_status::ready,
+            result.wait_for(std::chrono::seconds(5)));
+  EXPECT_EQ(boost::asio::error::eof, result.get());
+}
+
+TEST_F(async_server_test, acceptor_shards_share_new_connections) {
+  // handlers run inline on the thread of the shard that accepted the
+  // connection
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  start(options().acceptor_shards(2).inline_handlers(true),
+        [&](http::request const& request, connection_ptr connection) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    }
+    echo_destination(request, connection);
+  });
+  for (int i = 0; i < 32; ++i) {
+    test_connection connection(port_);
+    EXPECT_TRUE(has_body(connection.get("/"), "/"));
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(2u, threads.size());
+}
+
+TEST_F(async_server_test, serves_bursts_of_new_connections) {
+  start(options().pending_accepts(4));
+  std::vector<std::unique_ptr<test_connection>> connections;
+  for (int i = 0; i < 16; ++i)
+    connections.emplace_back(new test_connection(port_));
+  for (auto it = connections.rbegin(); it != connections.rend(); ++it)
+    EXPECT_TRUE(has_body((*it)->get("/"), "/"));
+}
+
+TEST_F(async_server_test, accepts_again_after_running_out_of_descriptors) {
+  start(options().pending_accepts(2));
+  rlimit limit;
+  ASSERT_EQ(0, ::getrlimit(RLIMIT_NOFILE, &limit));
+  rlimit lowered = limit;
+  lowered.rlim_cur = std::min<rlim_t>(limit.rlim_cur, 256);
+  ASSERT_EQ(0, ::setrlimit(RLIMIT_NOFILE, &lowered));
+
+  // the connection is queued while no descriptor is left to accept it with
+  test_connection connection(port_, false);
+  std::vector<int> fillers;
+  int filler;
+  while ((filler = ::open("/dev/null", O_RDONLY)) != -1)
+    fillers.push_back(filler);
+  connection.connect();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (int fd : fillers)
+    ::close(fd);
+  ::setrlimit(RLIMIT_NOFILE, &limit);
+
+  EXPECT_TRUE(has_body(connection.get("/"), "/"));
+}
+
+TEST_F(async_server_test, runs_handlers_on_the_thread_pool) {
+  std::promise<std::thread::id> handled;
+  start(options(),
+        [&](http::request const& request, connection_ptr connection) {
+    handled.set_value(std::this_thread::get_id());
+    echo_destination(request, connection);
+  });
+  test_connection connection(port_);
+  EXPECT_TRUE(has_body(connection.get("/"), "/"));
+  EXPECT_NE(thread_.get_id(), handled.get_future().get());
+}
+
+TEST_F(async_server_test, runs_inline_handlers_on_the_server_thread) {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  auto record_thread = [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  };
+  start(options().inline_handlers(true),
+        [&](http::request const& request, connection_ptr connection) {
+    record_thread();
+    std::string destination;
+    request.get_destination(destination);
+    set_content_length(connection, destination.size());
+    connection->write(std::move(destination),
+                      [&](boost::system::error_code) { record_thread(); });
+  });
+  test_connection connection(port_);
+  for (auto destination : {"/first", "/second", "/third"})
+    EXPECT_TRUE(has_body(connection.get(destination), destination));
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(1u, threads.size());
+  EXPECT_EQ(thread_.get_id(), *threads.begin());
+}
+
+TEST_F(async_server_test, shares_read_buffers_between_connections) {
+  start(options().spare_read_buffers(1));
+  std::vector<std::unique_ptr<test_connection>> connections;
+  for (int i = 0; i < 8; ++i)
+    connections.emplace_back(new test_connection(port_));
+  // every request arrives in two parts, so that each connection holds a
+  // read buffer while the others are reading too
+  for (std::size_t i = 0; i < connections.size(); ++i)
+    connections[i]->send("GET /" + std::to_string(i) + " HTTP/1.1\r\n");
+  for (std::size_t i = 0; i < connections.size(); ++i) {
+    connections[i]->send("Host: localhost\r\n\r\n");
+    std::string response = connections[i]->read_response();
+    EXPECT_TRUE(has_body(response, "/" + std::to_string(i))) << response;
+  }
+}
+
+TEST_F(async_server_test, reads_headers_longer_than_a_read_buffer) {
+  start(options().spare_read_buffers(1));
+  test_connection connection(port_);
+  std::string const destination = "/" + std::string(6000, 'x');
+  EXPECT_TRUE(has_body(connection.get(destination, "X-Padding: " +
+                                                       std::string(6000, 'y') +
+                                                       "\r\n"),
+                       destination));
+  EXPECT_TRUE(has_body(connection.get("/next"), "/next"));
+}
+
+TEST_F(async_server_test, serves_requests_on_reused_connections) {
+  start(options().spare_connections(2),
+        [](http::request const& request, connection_ptr connection) {
+    // a reused connection mustn't keep the headers of its last request
+    std::size_t headers = 0;
+    request.get_headers(
+        [&headers](std::string const&, std::string const&) { ++headers; });
+    std::string destination;
+    request.get_destination(destination);
+    std::string body = destination + " " + std::to_string(headers);
+    set_content_length(connection, body.size());
+    connection->write(std::move(body));
+  });
+  for (int i = 0; i < 6; ++i) {
+    test_connection connection(port_);
+    std::string destination = "/" + std::to_string(i);
+    std::string response = connection.get(
+        destination,
+        "X-Request: " + destination + "\r\nConnection: close\r\n");
+    EXPECT_TRUE(has_body(response, destination + " 3")) << response;
+    EXPECT_TRUE(connection.is_closed());
+    // gives the server time to put the connection back
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+}
+
+// Counts its live instances.
+struct counted {
+  counted() { ++instances; }
+  ~counted() { --instances; }
+  static int instances;
+};
+
+int counted::instances = 0;
+
+TEST_F(async_server_test, serves_new_connections_after_a_drain) {
+  start(options());
+  {
+    test_connection connection(port_);
+    EXPECT_TRUE(has_body(connection.get("/"), "/"));
+    server_->drain();
+    EXPECT_TRUE(connection.is_closed());
+  }
+  thread_.join();
+
+  server_->listen();
+  thread_ = std::thread([this]() { server_->run(); });
+  test_connection connection(port_);
+  std::string response = connection.get("/again");
+  EXPECT_TRUE(has_body(response, "/again")) << response;
+  EXPECT_FALSE(has_header(response, "Connection: close")) << response;
+  EXPECT_TRUE(has_body(connection.get("/more"), "/more"));
+}
+
+TEST(free_list_test, keeps_objects_up_to_its_size) {
+  {
+    http::free_list<counted> spares(1);
+    counted* first = new counted;
+    spares.give(first);
+    spares.give(new counted);
+    EXPECT_EQ(1, counted::instances);
+    EXPECT_EQ(first, spares.take());
+    EXPECT_EQ(nullptr, spares.take());
+    spares.give(first);
+  }
+  EXPECT_EQ(0, counted::instances);
+}
+
+TEST(free_list_test, deletes_objects_given_after_close) {
+  http::free_list<counted> spares(4);
+  spares.give(new counted);
+  spares.close();
+  EXPECT_EQ(0, counted::instances);
+  spares.give(new counted);
+  EXPECT_EQ(0, counted::instances);
+  EXPECT_EQ(nullptr, spares.take());
+}
+
+TEST(accept_retry_delay_test, backs_off_exponentially_up_to_a_second) {
+  boost::system::error_code out_of_descriptors(
+      EMFILE, boost::system::system_category());
+  std::chrono::milliseconds delay(0);
+  delay = http::accept_retry_delay(out_of_descriptors, delay);
+  EXPECT_EQ(10, delay.count());
+  delay = http::accept_retry_delay(out_of_descriptors, delay);
+  EXPECT_EQ(20, delay.count());
+  delay = http::accept_retry_delay(out_of_descriptors,
+                                   std::chrono::milliseconds(800));
+  EXPECT_EQ(1000, delay.count());
+}
+
+TEST(accept_retry_delay_test, retries_aborted_connections_straight_away) {
+  EXPECT_EQ(0, http::accept_retry_delay(boost::asio::error::connection_aborted,
+                                        std::chrono::milliseconds(500))
+                   .count());
+}
+
+}  // namespace
@@ -0,0 +1,179 @@
+// Copyright 2013 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include <network/protocol/http/client.hpp>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace http = network::http;
+using boost::asio::ip::tcp;
+
+namespace {
+
+// Reads a request on each connection to a loopback port, then sends reply
+// and closes the connection. With an empty reply the connection is closed
+// right away, and with hold set it is left open without an answer.
+class loopback_server {
+ public:
+  explicit loopback_server(std::string const& reply, bool hold = false)
+      : acceptor_(io_service_,
+                  tcp::endpoint(
+                      boost::asio::ip::address::from_string("127.0.0.1"), 0)),
+        reply_(reply),
+        hold_(hold) {
+    accept();
+    thread_ = std::thread([this]() { io_service_.run(); });
+  }
+
+  ~loopback_server() {
+    io_service_.stop();
+    thread_.join();
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" +
+           std::to_string(acceptor_.local_endpoint().port()) + "/";
+  }
+
+ private:
+  struct exchange {
+    explicit exchange(boost::asio::io_service& io_service)
+        : socket(io_service) {}
+    tcp::socket socket;
+    boost::asio::streambuf request;
+  };
+
+  void accept() {
+    auto connection = std::make_shared<exchange>(io_service_);
+    acceptor_.async_accept(
+        connection->socket,
+        [this, connection](boost::system::error_code const& error) {
+          if (error)
+            return;
+          respond(connection);
+          accept();
+        });
+  }
+
+  void respond(std::shared_ptr<exchange> connection) {
+    boost::asio::async_read_until(
+        connection->socket,
+        connection->request,
+        "\r\n\r\n",
+        [this, connection](boost::system::error_code const& error,
+                           std::size_t) {
+          if (error)
+            return;
+          if (hold_) {
+            held_ = connection;
+            return;
+          }
+          boost::asio::async_write(
+              connection->socket,
+              boost::asio::buffer(reply_),
+              [connection](boost::system::error_code const&, std::size_t) {
+                connection->socket.close();
+              });
+        });
+  }
+
+  boost::asio::io_service io_service_;
+  tcp::acceptor acceptor_;
+  std::string reply_;
+  bool hold_;
+  std::shared_ptr<exchange> held_;
+  std::thread thread_;
+};
+
+// Keeps what a response handler was called with.
+struct completion {
+  void operator()(boost::system::error_code const& error,
+                  http::response const& response) {
+    std::string body;
+    if (!error)
+      response.get_body(body);
+    done.set_value(std::make_pair(error, body));
+  }
+
+  std::pair<boost::system::error_code, std::string> wait() {
+    std::future<std::pair<boost::system::error_code, std::string>> result =
+        done.get_future();
+    EXPECT_EQ(std::future_status::ready,
+              result.wait_for(std::chrono::seconds(5)));
+    return result.get();
+  }
+
+  std::promise<std::pair<boost::system::error_code, std::string>> done;
+};
+
+TEST(client_completion_test, calls_the_handler_with_the_response) {
+  loopback_server server("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+  http::client client;
+  completion completed;
+  client.async_get(http::client::request(server.url()), std::ref(completed));
+  auto result = completed.wait();
+  EXPECT_FALSE(result.first);
+  EXPECT_EQ("hello", result.second);
+}
+
+TEST(client_completion_test, calls_the_handler_with_connection_errors) {
+  std::string url;
+  {
+    loopback_server server("");
+    url = server.url();
+  }
+  http::client client;
+  completion completed;
+  client.async_get(http::client::request(url), std::ref(completed));
+  EXPECT_EQ(boost::asio::error::connection_refused, completed.wait().first);
+}
+
+TEST(client_completion_test, calls_the_handler_when_the_server_hangs_up) {
+  loopback_server server("");
+  http::client client;
+  completion completed;
+  client.async_get(http::client::request(server.url()), std::ref(completed));
+  EXPECT_EQ(boost::asio::error::eof, completed.wait().first);
+}
+
+TEST(client_completion_test, calls_the_handler_when_the_request_is_dropped) {
+  loopback_server server("", true);
+  completion completed;
+  {
+    boost::asio::io_service io_service;
+    http::client_options options;
+    options.io_service(&io_service);
+    http::client client(options);
+    client.async_get(http::client::request(server.url()), std::ref(completed));
+    // Gives the request time to be sent, then drops it with the
+    // io_service.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    io_service.stop();
+  }
+  EXPECT_EQ(boost::asio::error::operation_aborted, completed.wait().first);
+}
+
+TEST(client_completion_test, fails_responses_whose_request_is_dropped) {
+  loopback_server server("", true);
+  http::response response;
+  {
+    boost::asio::io_service io_service;
+    http::client_options options;
+    options.io_service(&io_service);
+    http::client client(options);
+    response = client.get(http::client::request(server.url()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    io_service.stop();
+  }
+  std::string body;
+  EXPECT_THROW(response.get_body(body), boost::system::system_error);
+}
+
+}  // namespace
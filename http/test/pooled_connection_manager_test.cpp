@@ -0,0 +1,376 @@
+// Copyright 2013 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include <network/protocol/http/client.hpp>
+#include <network/protocol/http/client/pooled_connection_manager.hpp>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace http = network::http;
+using boost::asio::ip::tcp;
+
+namespace {
+
+// A connection that doesn't connect anywhere. The tests finish its
+// responses themselves.
+struct fake_connection : http::client_connection,
+                         std::enable_shared_from_this<fake_connection> {
+  virtual http::response send_request(std::string const&,
+                                      http::request const&,
+                                      bool,
+                                      callback_type,
+                                      http::request_options const&) {
+    return http::response();
+  }
+
+  virtual client_connection* clone() const { return new fake_connection; }
+
+  virtual void reset() {}
+
+  virtual void on_release(release_callback_type callback) {
+    release_ = callback;
+  }
+
+  // Finishes a response, leaving the connection open if keep_open is set.
+  void finish(bool keep_open = true) {
+    release_(keep_open ? shared_from_this()
+                       : std::shared_ptr<fake_connection>());
+  }
+
+  release_callback_type release_;
+};
+
+struct fake_connection_factory : http::connection_factory {
+  fake_connection_factory() : created(0), follow_redirects(false) {}
+
+  virtual std::shared_ptr<http::client_connection> create_connection(
+      boost::asio::io_service&,
+      http::request_base const&,
+      http::client_options const& options) {
+    ++created;
+    follow_redirects = options.follow_redirects();
+    return std::make_shared<fake_connection>();
+  }
+
+  int created;
+  bool follow_redirects;
+};
+
+class pooled_connection_manager_test : public ::testing::Test {
+ protected:
+  pooled_connection_manager_test()
+      : factory_(std::make_shared<fake_connection_factory>()) {
+    options_.connection_factory(factory_);
+  }
+
+  std::shared_ptr<http::pooled_connection_manager> make_pool() {
+    return std::make_shared<http::pooled_connection_manager>(options_);
+  }
+
+  std::shared_ptr<fake_connection> get(
+      http::pooled_connection_manager& pool,
+      std::string const& url,
+      http::client_options const& options) {
+    http::request request(url);
+    return std::static_pointer_cast<fake_connection>(
+        pool.get_connection(io_service_, request, options));
+  }
+
+  std::shared_ptr<fake_connection> get(http::pooled_connection_manager& pool,
+                                       std::string const& url) {
+    return get(pool, url, options_);
+  }
+
+  boost::asio::io_service io_service_;
+  std::shared_ptr<fake_connection_factory> factory_;
+  http::client_options options_;
+};
+
+TEST_F(pooled_connection_manager_test, reuses_released_connections) {
+  auto pool = make_pool();
+  auto first = get(*pool, "http://example.com/a");
+  first->finish();
+  EXPECT_EQ(first, get(*pool, "http://EXAMPLE.com:80/b"));
+  EXPECT_EQ(1, factory_->created);
+  http::pooled_connection_manager::statistics stats = pool->stats();
+  EXPECT_EQ(1u, stats.created);
+  EXPECT_EQ(1u, stats.reused);
+  EXPECT_EQ(1u, stats.returned);
+  EXPECT_EQ(0u, stats.idle);
+}
+
+TEST_F(pooled_connection_manager_test, reuses_connections_per_destination) {
+  auto pool = make_pool();
+  get(*pool, "http://example.com/")->finish();
+  get(*pool, "http://example.com:8080/")->finish();
+  get(*pool, "https://example.com/")->finish();
+  EXPECT_EQ(3u, pool->stats().idle);
+  get(*pool, "http://example.org/");
+  EXPECT_EQ(4, factory_->created);
+}
+
+TEST_F(pooled_connection_manager_test, does_not_reuse_closed_connections) {
+  auto pool = make_pool();
+  get(*pool, "http://example.com/")->finish(false);
+  get(*pool, "http://example.com/");
+  EXPECT_EQ(2, factory_->created);
+  EXPECT_EQ(1u, pool->stats().discarded);
+}
+
+TEST_F(pooled_connection_manager_test, makes_connections_with_per_call_options) {
+  auto pool = make_pool();
+  http::client_options redirecting;
+  redirecting.follow_redirects(true);
+  get(*pool, "http://example.com/", redirecting)->finish();
+  EXPECT_TRUE(factory_->follow_redirects);
+  // A connection made with other options isn't reused.
+  get(*pool, "http://example.com/");
+  EXPECT_FALSE(factory_->follow_redirects);
+  EXPECT_EQ(2, factory_->created);
+  get(*pool, "http://example.com/", redirecting);
+  EXPECT_EQ(2, factory_->created);
+}
+
+TEST_F(pooled_connection_manager_test, drops_least_recently_used_per_host) {
+  options_.max_idle_connections_per_host(2);
+  auto pool = make_pool();
+  auto first = get(*pool, "http://example.com/");
+  auto second = get(*pool, "http://example.com/");
+  auto third = get(*pool, "http://example.com/");
+  first->finish();
+  second->finish();
+  third->finish();
+  EXPECT_EQ(1u, pool->stats().discarded);
+  EXPECT_EQ(third, get(*pool, "http://example.com/"));
+  EXPECT_EQ(second, get(*pool, "http://example.com/"));
+  get(*pool, "http://example.com/");
+  EXPECT_EQ(4, factory_->created);
+}
+
+TEST_F(pooled_connection_manager_test, drops_least_recently_used_overall) {
+  options_.max_idle_connections(2);
+  auto pool = make_pool();
+  auto first = get(*pool, "http://a.example.com/");
+  auto second = get(*pool, "http://b.example.com/");
+  auto third = get(*pool, "http://c.example.com/");
+  first->finish();
+  second->finish();
+  third->finish();
+  EXPECT_EQ(2u, pool->stats().idle);
+  get(*pool, "http://a.example.com/");
+  EXPECT_EQ(4, factory_->created);
+  EXPECT_EQ(second, get(*pool, "http://b.example.com/"));
+  EXPECT_EQ(third, get(*pool, "http://c.example.com/"));
+}
+
+TEST_F(pooled_connection_manager_test, expires_idle_connections) {
+  options_.idle_timeout(20);
+  auto pool = make_pool();
+  get(*pool, "http://example.com/")->finish();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  get(*pool, "http://example.com/");
+  EXPECT_EQ(2, factory_->created);
+  http::pooled_connection_manager::statistics stats = pool->stats();
+  EXPECT_EQ(1u, stats.expired);
+  EXPECT_EQ(0u, stats.reused);
+}
+
+TEST_F(pooled_connection_manager_test, outlives_connections_in_use) {
+  auto connection = get(*make_pool(), "http://example.com/");
+  connection->finish();
+}
+
+// Answers each request on a loopback port, then closes the connection
+// without saying so, the way servers close connections that stay idle.
+class closing_server {
+ public:
+  closing_server()
+      : acceptor_(io_service_,
+                  tcp::endpoint(
+                      boost::asio::ip::address::from_string("127.0.0.1"), 0)),
+        accepted_(0) {
+    accept();
+    thread_ = std::thread([this]() { io_service_.run(); });
+  }
+
+  ~closing_server() {
+    io_service_.stop();
+    thread_.join();
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" +
+           std::to_string(acceptor_.local_endpoint().port()) + "/";
+  }
+
+  int accepted() const { return accepted_; }
+
+ private:
+  struct exchange {
+    explicit exchange(boost::asio::io_service& io_service)
+        : socket(io_service) {}
+    tcp::socket socket;
+    boost::asio::streambuf request;
+  };
+
+  void accept() {
+    auto connection = std::make_shared<exchange>(io_service_);
+    acceptor_.async_accept(
+        connection->socket,
+        [this, connection](boost::system::error_code const& error) {
+          if (error)
+            return;
+          ++accepted_;
+          respond(connection);
+          accept();
+        });
+  }
+
+  static void respond(std::shared_ptr<exchange> connection) {
+    static char const response[] =
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+    boost::asio::async_read_until(
+        connection->socket,
+        connection->request,
+        "\r\n\r\n",
+        [connection](boost::system::error_code const& error, std::size_t) {
+          if (error)
+            return;
+          boost::asio::async_write(
+              connection->socket,
+              boost::asio::buffer(response, sizeof(response) - 1),
+              [connection](boost::system::error_code const&, std::size_t) {
+                connection->socket.close();
+              });
+        });
+  }
+
+  boost::asio::io_service io_service_;
+  tcp::acceptor acceptor_;
+  std::atomic<int> accepted_;
+  std::thread thread_;
+};
+
+TEST(pooled_connection_manager_stale_test, retries_on_a_new_connection) {
+  closing_server server;
+  http::client_options options;
+  auto pool = std::make_shared<http::pooled_connection_manager>(options);
+  options.connection_manager(pool);
+  http::client client(options);
+  http::client::request request(server.url());
+  for (int i = 0; i < 2; ++i) {
+    http::response response = client.get(request);
+    std::string body;
+    response.get_body(body);
+    EXPECT_EQ("hello", body);
+  }
+  // The second request went out on the connection the server had closed,
+  // and was sent again on a new one.
+  EXPECT_EQ(2, server.accepted());
+  http::pooled_connection_manager::statistics stats = pool->stats();
+  EXPECT_EQ(1u, stats.created);
+  EXPECT_EQ(1u, stats.reused);
+}
+
+// Answers each request on a loopback port with a response whose headers
+// are written in lower case, and keeps the connection open.
+class lowercase_server {
+ public:
+  lowercase_server()
+      : acceptor_(io_service_,
+                  tcp::endpoint(
+                      boost::asio::ip::address::from_string("127.0.0.1"), 0)),
+        accepted_(0) {
+    accept();
+    thread_ = std::thread([this]() { io_service_.run(); });
+  }
+
+  ~lowercase_server() {
+    io_service_.stop();
+    thread_.join();
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" +
+           std::to_string(acceptor_.local_endpoint().port()) + "/";
+  }
+
+  int accepted() const { return accepted_; }
+
+ private:
+  struct exchange {
+    explicit exchange(boost::asio::io_service& io_service)
+        : socket(io_service) {}
+    tcp::socket socket;
+    boost::asio::streambuf request;
+  };
+
+  void accept() {
+    auto connection = std::make_shared<exchange>(io_service_);
+    acceptor_.async_accept(
+        connection->socket,
+        [this, connection](boost::system::error_code const& error) {
+          if (error)
+            return;
+          ++accepted_;
+          respond(connection);
+          accept();
+        });
+  }
+
+  static void respond(std::shared_ptr<exchange> connection) {
+    static char const response[] =
+        "HTTP/1.1 200 OK\r\ncontent-length: 5\r\n\r\nhello";
+    boost::asio::async_read_until(
+        connection->socket,
+        connection->request,
+        "\r\n\r\n",
+        [connection](boost::system::error_code const& error,
+                     std::size_t length) {
+          if (error)
+            return;
+          connection->request.consume(length);
+          boost::asio::async_write(
+              connection->socket,
+              boost::asio::buffer(response, sizeof(response) - 1),
+              [connection](boost::system::error_code const& error,
+                           std::size_t) {
+                if (!error)
+                  respond(connection);
+              });
+        });
+  }
+
+  boost::asio::io_service io_service_;
+  tcp::acceptor acceptor_;
+  std::atomic<int> accepted_;
+  std::thread thread_;
+};
+
+TEST(pooled_connection_manager_lowercase_test, reuses_the_connection) {
+  lowercase_server server;
+  http::client_options options;
+  auto pool = std::make_shared<http::pooled_connection_manager>(options);
+  options.connection_manager(pool);
+  http::client client(options);
+  http::client::request request(server.url());
+  for (int i = 0; i < 2; ++i) {
+    // The body ends where content-length says, not when the server
+    // closes the connection.
+    http::response response = client.get(request);
+    std::string body;
+    response.get_body(body);
+    EXPECT_EQ("hello", body);
+  }
+  EXPECT_EQ(1, server.accepted());
+  EXPECT_EQ(1u, pool->stats().reused);
+}
+
+}  // namespace
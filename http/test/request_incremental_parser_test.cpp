@@ -6,7 +6,6 @@
 
 #include <gtest/gtest.h>
 #include <network/protocol/http/server/request_parser.hpp>
-#include <network/tags.hpp>
 #include <boost/range.hpp>
 #include <boost/logic/tribool.hpp>
 #include <string>
@@ -23,19 +22,18 @@
  *
  */
 
-namespace tags = boost::network::tags;
 namespace logic = boost::logic;
 namespace fusion = boost::fusion;
-using namespace boost::network::http;
+using namespace network::http;
 
 TEST(request_test, incremental_parser_constructor) {
-  request_parser<tags::default_string> p;  // default constructible
+  request_parser p;  // default constructible
 }
 
 TEST(request_test, incremental_parser_parse_http_method) {
-  request_parser<tags::default_string> p;
+  request_parser p;
   logic::tribool parsed_ok = false;
-  typedef request_parser<tags::default_string> request_parser_type;
+  typedef request_parser request_parser_type;
   typedef boost::iterator_range<std::string::const_iterator> range_type;
   range_type result_range;
 
@@ -59,9 +57,9 @@ TEST(request_test, incremental_parser_parse_http_method) {
 }
 
 TEST(request_test, incremental_parser_parse_http_uri) {
-  request_parser<tags::default_string> p;
+  request_parser p;
   logic::tribool parsed_ok = false;
-  typedef request_parser<tags::default_string> request_parser_type;
+  typedef request_parser request_parser_type;
   typedef boost::iterator_range<std::string::const_iterator> range_type;
   range_type result_range;
 
@@ -85,9 +83,9 @@ TEST(request_test, incremental_parser_parse_http_uri) {
 }
 
 TEST(request_test, incremental_parser_parse_http_version) {
-  request_parser<tags::default_string> p;
+  request_parser p;
   logic::tribool parsed_ok = false;
-  typedef request_parser<tags::default_string> request_parser_type;
+  typedef request_parser request_parser_type;
   typedef boost::iterator_range<std::string::const_iterator> range_type;
   range_type result_range;
 
@@ -111,9 +109,9 @@ TEST(request_test, incremental_parser_parse_http_version) {
 }
 
 TEST(request_test, incremental_parser_parse_http_headers) {
-  request_parser<tags::default_string> p;
+  request_parser p;
   logic::tribool parsed_ok = false;
-  typedef request_parser<tags::default_string> request_parser_type;
+  typedef request_parser request_parser_type;
   typedef boost::iterator_range<std::string::const_iterator> range_type;
   range_type result_range;
 
@@ -139,3 +137,65 @@ TEST(request_test, incremental_parser_parse_http_headers) {
             << std::endl;
 }
 
+TEST(request_test, incremental_parser_parse_http_version_numbers) {
+  request_parser p;
+  logic::tribool parsed_ok = false;
+  typedef boost::iterator_range<std::string::const_iterator> range_type;
+  range_type result_range;
+
+  std::string valid_http_request = "GET / HTTP/1.0\r\n";
+  fusion::tie(parsed_ok, result_range) =
+      p.parse_until(request_parser::version_done, valid_http_request);
+  ASSERT_EQ(parsed_ok, true);
+  EXPECT_EQ(1, p.version_major());
+  EXPECT_EQ(0, p.version_minor());
+}
+
+TEST(request_test, incremental_parser_header_fields) {
+  request_parser p;
+  logic::tribool parsed_ok = false;
+  typedef boost::iterator_range<std::string::const_iterator> range_type;
+  range_type result_range;
+
+  std::string request_line = "GET / HTTP/1.1\r\n";
+  std::string header_block =
+      "Host: cpp-netlib.org\r\nX-Empty: \r\nAccept: */*\r\n\r\n";
+  std::string valid_http_request = request_line + header_block;
+  fusion::tie(parsed_ok, result_range) =
+      p.parse_until(request_parser::headers_done, valid_http_request);
+  ASSERT_EQ(parsed_ok, true);
+  ASSERT_EQ(3u, p.header_fields().size());
+  char const* block = header_block.data();
+  EXPECT_EQ("Host", p.header_fields()[0].name(block));
+  EXPECT_EQ("cpp-netlib.org", p.header_fields()[0].value(block));
+  EXPECT_EQ("X-Empty", p.header_fields()[1].name(block));
+  EXPECT_EQ("", p.header_fields()[1].value(block));
+  EXPECT_EQ("Accept", p.header_fields()[2].name(block));
+  EXPECT_EQ("*/*", p.header_fields()[2].value(block));
+
+  p.reset();
+  EXPECT_TRUE(p.header_fields().empty());
+}
+
+TEST(request_test, incremental_parser_header_fields_across_ranges) {
+  request_parser p;
+  logic::tribool parsed_ok = false;
+  typedef boost::iterator_range<std::string::const_iterator> range_type;
+  range_type result_range;
+
+  std::string header_block =
+      "Host: cpp-netlib.org\r\nConnection: close\r\n\r\n";
+  std::string first = "GET / HTTP/1.1\r\nHost: cpp-",
+              second = header_block.substr(10);
+  fusion::tie(parsed_ok, result_range) =
+      p.parse_until(request_parser::headers_done, first);
+  ASSERT_TRUE(logic::indeterminate(parsed_ok));
+  fusion::tie(parsed_ok, result_range) =
+      p.parse_until(request_parser::headers_done, second);
+  ASSERT_EQ(parsed_ok, true);
+  ASSERT_EQ(2u, p.header_fields().size());
+  char const* block = header_block.data();
+  EXPECT_EQ("cpp-netlib.org", p.header_fields()[0].value(block));
+  EXPECT_EQ("Connection", p.header_fields()[1].name(block));
+  EXPECT_EQ("close", p.header_fields()[1].value(block));
+}
@@ -6,6 +6,9 @@
 
 #include <gtest/gtest.h>
 #include <network/protocol/http/response.hpp>
+#include <network/protocol/http/impl/response_state.hpp>
+#include <memory>
+#include <stdexcept>
 
 namespace http = network::http;
 
@@ -65,3 +68,78 @@ TEST(response_test, response_setters_and_getters) {
   ASSERT_EQ(version, std::string("HTTP/1.1"));
   ASSERT_TRUE(expected_headers == headers);
 }
+
+TEST(response_test, response_shares_state) {
+  auto state = std::make_shared<http::impl::response_state>();
+  http::response response;
+  http::impl::setter_access().set_state(response, state);
+  http::response copy(response);
+  std::multimap<std::string, std::string> headers;
+  headers.insert(std::make_pair("Content-Type", "text/plain"));
+  state->set_headers("HTTP/1.1", 200u, "OK", headers);
+  boost::uint16_t status;
+  std::string version, status_message;
+  copy.get_status(status);
+  copy.get_version(version);
+  copy.get_status_message(status_message);
+  ASSERT_EQ(200u, status);
+  ASSERT_EQ(std::string("HTTP/1.1"), version);
+  ASSERT_EQ(std::string("OK"), status_message);
+  std::string body = "Hello, World!";
+  state->set_body(body);
+  response.get_body(body);
+  ASSERT_EQ(std::string("Hello, World!"), body);
+  std::multimap<std::string, std::string> read_headers;
+  response.get_headers(multimap_inserter(read_headers));
+  ASSERT_EQ(1u, read_headers.count("Content-Type"));
+  copy.set_status(404u);
+  copy.get_status(status);
+  ASSERT_EQ(404u, status);
+  response.get_status(status);
+  ASSERT_EQ(200u, status);
+}
+
+TEST(response_test, response_state_error) {
+  auto state = std::make_shared<http::impl::response_state>();
+  http::response response;
+  http::impl::setter_access().set_state(response, state);
+  std::multimap<std::string, std::string> headers;
+  state->set_headers("HTTP/1.1", 200u, "OK", headers);
+  state->set_error(std::make_exception_ptr(std::runtime_error("closed")));
+  boost::uint16_t status;
+  response.get_status(status);
+  ASSERT_EQ(200u, status);
+  std::string body;
+  ASSERT_THROW(response.get_body(body), std::runtime_error);
+}
+
+TEST(response_test, response_state_completion) {
+  auto state = std::make_shared<http::impl::response_state>();
+  http::response response;
+  http::impl::setter_access().set_state(response, state);
+  ASSERT_EQ(state, http::impl::setter_access().get_state(response));
+  int completions = 0;
+  std::exception_ptr completed_with;
+  state->when_complete([&](std::exception_ptr error) {
+    ++completions;
+    completed_with = error;
+  });
+  std::multimap<std::string, std::string> headers;
+  state->set_headers("HTTP/1.1", 200u, "OK", headers);
+  ASSERT_EQ(0, completions);
+  std::string body = "Hello, World!";
+  state->set_body(body);
+  state->set_error(std::make_exception_ptr(std::runtime_error("closed")));
+  ASSERT_EQ(1, completions);
+  ASSERT_FALSE(completed_with);
+  // A handler added once the response is complete is called right away.
+  state->when_complete([&](std::exception_ptr error) { ++completions; });
+  ASSERT_EQ(2, completions);
+
+  auto failed = std::make_shared<http::impl::response_state>();
+  failed->set_error(std::make_exception_ptr(std::runtime_error("closed")));
+  failed->when_complete([&](std::exception_ptr error) {
+    completed_with = error;
+  });
+  ASSERT_THROW(std::rethrow_exception(completed_with), std::runtime_error);
+}
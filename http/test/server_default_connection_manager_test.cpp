@@ -6,6 +6,8 @@
 
 #include <gtest/gtest.h>
 #include <http/server/default_connection_manager.hpp>
+#include <memory>
+#include <vector>
 
 namespace http = network::http;
 
@@ -16,4 +18,98 @@ TEST(default_connection_manager_test, constructor_test) {
   (void)manager;
 }
 
-}  // namespace   
+TEST(default_connection_manager_test, tracks_until_released) {
+  http::default_connection_manager manager;
+  std::shared_ptr<void> first = manager.add([] {});
+  std::shared_ptr<void> second = manager.add([] {});
+  EXPECT_EQ(2u, manager.size());
+  first.reset();
+  EXPECT_EQ(1u, manager.size());
+  second.reset();
+  EXPECT_EQ(0u, manager.size());
+}
+
+TEST(default_connection_manager_test, drain_without_connections) {
+  http::default_connection_manager manager;
+  bool done = false;
+  manager.drain([&] { done = true; });
+  EXPECT_TRUE(done);
+  EXPECT_FALSE(manager.draining());
+}
+
+TEST(default_connection_manager_test, drain_closes_connections) {
+  http::default_connection_manager manager;
+  int closed = 0;
+  bool done = false;
+  std::vector<std::shared_ptr<void>> connections;
+  for (int i = 0; i < 3; ++i)
+    connections.push_back(manager.add([&] { ++closed; }));
+  manager.drain([&] { done = true; });
+  EXPECT_EQ(3, closed);
+  EXPECT_TRUE(manager.draining());
+  connections.pop_back();
+  connections.pop_back();
+  EXPECT_FALSE(done);
+  connections.pop_back();
+  EXPECT_TRUE(done);
+  EXPECT_FALSE(manager.draining());
+}
+
+TEST(default_connection_manager_test, added_after_drain_is_kept) {
+  http::default_connection_manager manager;
+  std::shared_ptr<void> first = manager.add([] {});
+  manager.drain([] {});
+  first.reset();
+  bool closed = false;
+  std::shared_ptr<void> second = manager.add([&] { closed = true; });
+  EXPECT_FALSE(closed);
+}
+
+TEST(default_connection_manager_test, resume_ends_a_drain) {
+  http::default_connection_manager manager;
+  std::shared_ptr<void> first = manager.add([] {});
+  bool done = false;
+  manager.drain([&] { done = true; });
+  manager.resume();
+  EXPECT_FALSE(manager.draining());
+  bool closed = false;
+  std::shared_ptr<void> second = manager.add([&] { closed = true; });
+  EXPECT_FALSE(closed);
+  first.reset();
+  EXPECT_FALSE(done);
+}
+
+TEST(default_connection_manager_test, close_may_release_connection) {
+  http::default_connection_manager manager;
+  std::shared_ptr<void> connection;
+  connection = manager.add([&] { connection.reset(); });
+  bool done = false;
+  manager.drain([&] { done = true; });
+  EXPECT_TRUE(done);
+  EXPECT_EQ(0u, manager.size());
+}
+
+TEST(default_connection_manager_test, added_while_draining_is_closed) {
+  http::default_connection_manager manager;
+  std::shared_ptr<void> first = manager.add([] {});
+  bool done = false;
+  manager.drain([&] { done = true; });
+  bool closed = false;
+  std::shared_ptr<void> second = manager.add([&] { closed = true; });
+  EXPECT_TRUE(closed);
+  first.reset();
+  EXPECT_FALSE(done);
+  second.reset();
+  EXPECT_TRUE(done);
+}
+
+TEST(default_connection_manager_test, handle_outlives_manager) {
+  std::shared_ptr<void> connection;
+  {
+    http::default_connection_manager manager;
+    connection = manager.add([] {});
+  }
+  connection.reset();
+}
+
+}  // namespace
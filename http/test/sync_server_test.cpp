@@ -0,0 +1,198 @@
+// Copyright 2013 (c) Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include <network/protocol/http/server.hpp>
+#include <network/protocol/http/request.hpp>
+#include <network/protocol/http/response.hpp>
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+namespace http = network::http;
+using boost::asio::ip::tcp;
+
+namespace {
+
+// Answers every request with the body it read.
+struct echo_body {
+  void operator()(http::request const& request, http::response& response) {
+    std::string body;
+    request.get_body(body);
+    response.set_status(200);
+    response.set_status_message("OK");
+    response.append_header("Content-Length", std::to_string(body.size()));
+    response.set_body(body);
+  }
+};
+
+std::string free_port() {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor(
+      io_service,
+      tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 0));
+  return std::to_string(acceptor.local_endpoint().port());
+}
+
+// A connection to the server under test. Receives give up after five
+// seconds, so that a server that doesn't answer fails the test instead of
+// hanging it.
+class test_connection {
+ public:
+  explicit test_connection(std::string const& port) : socket_(io_service_) {
+    tcp::resolver resolver(io_service_);
+    boost::asio::connect(
+        socket_, resolver.resolve(tcp::resolver::query("127.0.0.1", port)));
+    timeval timeout = {5, 0};
+    ::setsockopt(socket_.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                 sizeof(timeout));
+  }
+
+  void send(std::string const& data) {
+    boost::asio::write(socket_, boost::asio::buffer(data));
+  }
+
+  // Returns what arrives until the server closes the connection.
+  std::string receive_all() {
+    std::string received;
+    while (receive(received)) {
+    }
+    return received;
+  }
+
+  // Returns what arrives until the end of a header block.
+  std::string receive_head() {
+    std::string received;
+    while (received.find("\r\n\r\n") == std::string::npos &&
+           receive(received)) {
+    }
+    return received;
+  }
+
+ private:
+  // asio's blocking reads wait again when SO_RCVTIMEO expires, so the
+  // socket is read directly.
+  bool receive(std::string& received) {
+    char data[4096];
+    ssize_t size = ::recv(socket_.native_handle(), data, sizeof(data), 0);
+    if (size <= 0)
+      return false;
+    received.append(data, size);
+    return true;
+  }
+
+  boost::asio::io_service io_service_;
+  tcp::socket socket_;
+};
+
+bool starts_with(std::string const& response, std::string const& status_line) {
+  return response.compare(0, status_line.size(), status_line) == 0;
+}
+
+bool has_body(std::string const& response, std::string const& body) {
+  std::string::size_type head_end = response.find("\r\n\r\n");
+  return head_end != std::string::npos &&
+         response.substr(head_end + 4) == body;
+}
+
+// Runs a sync server on a loopback port for the duration of a test.
+class sync_server_test : public ::testing::Test {
+ protected:
+  sync_server_test() : port_(free_port()) {
+    http::server_options options;
+    options.address("127.0.0.1").port(port_).reuse_address(true)
+        .max_request_body_size(100);
+    server_.reset(new http::sync_server<echo_body>(options, handler_));
+    server_->listen();
+    thread_ = std::thread([this]() { server_->run(); });
+  }
+
+  ~sync_server_test() {
+    server_->stop();
+    thread_.join();
+  }
+
+  std::string roundtrip(std::string const& request) {
+    test_connection connection(port_);
+    connection.send(request);
+    return connection.receive_all();
+  }
+
+  std::string port_;
+  echo_body handler_;
+  std::unique_ptr<http::sync_server<echo_body>> server_;
+  std::thread thread_;
+};
+
+TEST_F(sync_server_test, reads_content_length_bodies) {
+  std::string response = roundtrip(
+      "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello");
+  EXPECT_TRUE(starts_with(response, "HTTP/1.1 200 OK")) << response;
+  EXPECT_TRUE(has_body(response, "hello")) << response;
+}
+
+TEST_F(sync_server_test, reads_chunked_bodies) {
+  std::string response = roundtrip(
+      "PUT / HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "5;name=value\r\nhello\r\n6\r\n world\r\n0\r\nTrailer: ignored\r\n\r\n");
+  EXPECT_TRUE(starts_with(response, "HTTP/1.1 200 OK")) << response;
+  EXPECT_TRUE(has_body(response, "hello world")) << response;
+}
+
+TEST_F(sync_server_test, rejects_chunks_not_ended_by_crlf) {
+  std::string response = roundtrip(
+      "PUT / HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "5\r\nhelloXX\r\n0\r\n\r\n");
+  EXPECT_TRUE(starts_with(response, "HTTP/1.0 400 Bad Request")) << response;
+}
+
+TEST_F(sync_server_test, rejects_malformed_chunk_sizes) {
+  std::string response = roundtrip(
+      "PUT / HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "zz\r\n");
+  EXPECT_TRUE(starts_with(response, "HTTP/1.0 400 Bad Request")) << response;
+}
+
+TEST_F(sync_server_test, refuses_declared_bodies_over_the_limit) {
+  std::string response = roundtrip(
+      "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 101\r\n\r\n");
+  EXPECT_TRUE(starts_with(response, "HTTP/1.0 413 Request Entity Too Large"))
+      << response;
+}
+
+TEST_F(sync_server_test, refuses_chunked_bodies_over_the_limit) {
+  std::string response = roundtrip(
+      "POST / HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "65\r\n" + std::string(101, 'a') + "\r\n0\r\n\r\n");
+  EXPECT_TRUE(starts_with(response, "HTTP/1.0 413 Request Entity Too Large"))
+      << response;
+}
+
+TEST_F(sync_server_test, sends_100_continue_before_reading_the_body) {
+  test_connection connection(port_);
+  connection.send(
+      "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n"
+      "Expect: 100-continue\r\n\r\n");
+  EXPECT_EQ("HTTP/1.1 100 Continue\r\n\r\n", connection.receive_head());
+  connection.send("hello");
+  std::string response = connection.receive_all();
+  EXPECT_TRUE(starts_with(response, "HTTP/1.1 200 OK")) << response;
+  EXPECT_TRUE(has_body(response, "hello")) << response;
+}
+
+TEST_F(sync_server_test, refuses_bodies_over_the_limit_without_100_continue) {
+  test_connection connection(port_);
+  connection.send(
+      "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 101\r\n"
+      "Expect: 100-continue\r\n\r\n");
+  std::string response = connection.receive_all();
+  EXPECT_TRUE(starts_with(response, "HTTP/1.0 413 Request Entity Too Large"))
+      << response;
+}
+
+}  // namespace
@@ -3,6 +3,7 @@
 // (See accompanying file LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <ctime>
 #include <igloo/igloo_alt.h>
 #include "network/http/v2/client.hpp"
 
@@ -39,6 +40,19 @@ Describe(http_client) {
     Assert::That(std::begin(headers)->first, Equals("Date"));
   }
 
+  It(times_out_resolving_a_host) {
+    // the name isn't in any cache, so its lookup takes a round trip to
+    // a name server
+    auto host = std::to_string(std::time(nullptr)) + ".example.com";
+    http::client::request request{network::uri{"http://" + host + "/"}};
+    auto future_response =
+      client_->get(request, http::client::request_options().resolve_timeout(1));
+
+    AssertThrows(http::client_exception, future_response.get());
+    Assert::That(LastException<http::client_exception>().code(),
+                 Equals(http::make_error_code(http::client_error::timeout)));
+  }
+
   std::unique_ptr<http::client> client_;
 
 };
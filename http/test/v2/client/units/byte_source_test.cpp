@@ -7,3 +7,101 @@
 #include "network/http/v2/client/request.hpp"
 
 
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "network/http/v2/client/file_byte_source.hpp"
+
+namespace http_cm = network::http::v2::client_message;
+
+TEST(byte_source_test, string_byte_source_read) {
+  http_cm::string_byte_source source("abcdefghij");
+  std::string data;
+  ASSERT_EQ(4, source.read(data, 4));
+  ASSERT_EQ(6, *source.size());
+  ASSERT_EQ(6, source.read(data, 8));
+  ASSERT_EQ(0, source.read(data, 8));
+  ASSERT_EQ("abcdefghij", data);
+}
+
+TEST(byte_source_test, string_byte_source_read_in_place) {
+  http_cm::string_byte_source source("abcdefghij");
+  const char *data = nullptr;
+  ASSERT_EQ(4, source.read_in_place(data, 4));
+  ASSERT_EQ("abcd", std::string(data, 4));
+  ASSERT_EQ(6, source.read_in_place(data, 8));
+  ASSERT_EQ("efghij", std::string(data, 6));
+  ASSERT_EQ(0, source.read_in_place(data, 8));
+}
+
+namespace {
+  class counting_byte_source : public http_cm::byte_source {
+
+  public:
+
+    explicit counting_byte_source(size_type length)
+      : length_(length) { }
+
+    virtual size_type read(string_type &source, size_type length) {
+      auto bytes_read = std::min(length, length_);
+      source.append(bytes_read, 'x');
+      length_ -= bytes_read;
+      return bytes_read;
+    }
+
+  private:
+
+    size_type length_;
+
+  };
+} // namespace
+
+TEST(byte_source_test, default_read_in_place) {
+  counting_byte_source source(6);
+  http_cm::byte_source &base = source;
+  const char *data = nullptr;
+  ASSERT_FALSE(base.size());
+  ASSERT_EQ(4, base.read_in_place(data, 4));
+  ASSERT_EQ("xxxx", std::string(data, 4));
+  ASSERT_EQ(2, base.read_in_place(data, 4));
+  ASSERT_EQ(0, base.read_in_place(data, 4));
+}
+
+TEST(byte_source_test, file_byte_source_read_in_place) {
+  char path[] = "/tmp/file_byte_source_testXXXXXX";
+  int fd = ::mkstemp(path);
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ(10, ::write(fd, "abcdefghij", 10));
+  ::close(fd);
+
+  {
+    http_cm::file_byte_source source(path);
+    ASSERT_EQ(10, *source.size());
+    const char *data = nullptr;
+    ASSERT_EQ(8, source.read_in_place(data, 8));
+    ASSERT_EQ("abcdefgh", std::string(data, 8));
+    std::string rest;
+    ASSERT_EQ(2, source.read(rest, 8));
+    ASSERT_EQ("ij", rest);
+    ASSERT_EQ(0, *source.size());
+  }
+  ::unlink(path);
+}
+
+TEST(byte_source_test, file_byte_source_missing_file) {
+  ASSERT_THROW(http_cm::file_byte_source("/nonexistent/file"), std::system_error);
+}
+
+TEST(byte_source_test, file_byte_source_not_a_regular_file) {
+  ASSERT_THROW(http_cm::file_byte_source("/tmp"), std::system_error);
+  ASSERT_THROW(http_cm::file_byte_source("/dev/null"), std::system_error);
+
+  char path[] = "/tmp/file_byte_source_testXXXXXX";
+  ASSERT_NE(nullptr, ::mkdtemp(path));
+  std::string fifo = std::string(path) + "/fifo";
+  ASSERT_EQ(0, ::mkfifo(fifo.c_str(), 0600));
+  // a FIFO without a writer isn't waited for
+  ASSERT_THROW(http_cm::file_byte_source{fifo}, std::system_error);
+  ::unlink(fifo.c_str());
+  ::rmdir(path);
+}
@@ -0,0 +1,111 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <gtest/gtest.h>
+#include "network/http/v2/client/chunked_decoder.hpp"
+
+namespace http = network::http::v2;
+
+namespace {
+  const std::string input =
+    "1a\r\n"
+    "abcdefghijklmnopqrstuvwxyz\r\n"
+    "A;name=value\r\n"
+    "0123456789\r\n"
+    "0\r\n"
+    "\r\n";
+
+  struct append_to {
+    explicit append_to(std::string &body) : body_(body) {}
+
+    void operator () (std::string::const_iterator first,
+                      std::string::const_iterator last) {
+      body_.append(first, last);
+    }
+
+    std::string &body_;
+  };
+} // namespace
+
+TEST(chunked_decoder_test, decode_body) {
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok;
+  std::string::const_iterator decoded;
+  std::tie(decoded_ok, decoded) = decoder.decode(std::begin(input), std::end(input), append_to(body));
+  ASSERT_TRUE(decoded_ok);
+  ASSERT_EQ(std::end(input), decoded);
+  ASSERT_EQ("abcdefghijklmnopqrstuvwxyz0123456789", body);
+}
+
+TEST(chunked_decoder_test, decode_body_one_byte_at_a_time) {
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok = boost::logic::indeterminate;
+  for (auto it = std::begin(input); it != std::end(input); ++it) {
+    ASSERT_TRUE(boost::logic::indeterminate(decoded_ok));
+    std::string::const_iterator decoded;
+    std::tie(decoded_ok, decoded) = decoder.decode(it, std::next(it), append_to(body));
+    ASSERT_EQ(std::next(it), decoded);
+  }
+  ASSERT_TRUE(decoded_ok);
+  ASSERT_EQ("abcdefghijklmnopqrstuvwxyz0123456789", body);
+}
+
+TEST(chunked_decoder_test, stop_at_end_of_body) {
+  const std::string pipelined = "3\r\nabc\r\n0\r\n\r\nHTTP/1.1 200 OK\r\n";
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok;
+  std::string::const_iterator decoded;
+  std::tie(decoded_ok, decoded) = decoder.decode(std::begin(pipelined), std::end(pipelined), append_to(body));
+  ASSERT_TRUE(decoded_ok);
+  ASSERT_EQ("HTTP/1.1 200 OK\r\n", std::string(decoded, std::end(pipelined)));
+  ASSERT_EQ("abc", body);
+}
+
+TEST(chunked_decoder_test, skip_trailers) {
+  const std::string trailers = "3\r\nabc\r\n0\r\nExpires: never\r\n\r\n";
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok;
+  std::string::const_iterator decoded;
+  std::tie(decoded_ok, decoded) = decoder.decode(std::begin(trailers), std::end(trailers), append_to(body));
+  ASSERT_TRUE(decoded_ok);
+  ASSERT_EQ(std::end(trailers), decoded);
+  ASSERT_EQ("abc", body);
+}
+
+TEST(chunked_decoder_test, incomplete_body) {
+  const std::string incomplete = "a\r\n01234";
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok;
+  std::string::const_iterator decoded;
+  std::tie(decoded_ok, decoded) = decoder.decode(std::begin(incomplete), std::end(incomplete), append_to(body));
+  ASSERT_TRUE(boost::logic::indeterminate(decoded_ok));
+  ASSERT_EQ("01234", body);
+}
+
+TEST(chunked_decoder_test, invalid_chunk_size) {
+  const std::string invalid = "xyz\r\nabc\r\n";
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok;
+  std::string::const_iterator decoded;
+  std::tie(decoded_ok, decoded) = decoder.decode(std::begin(invalid), std::end(invalid), append_to(body));
+  ASSERT_FALSE(decoded_ok);
+}
+
+TEST(chunked_decoder_test, missing_chunk_terminator) {
+  const std::string invalid = "3\r\nabcd\r\n";
+  http::chunked_decoder decoder;
+  std::string body;
+  boost::logic::tribool decoded_ok;
+  std::string::const_iterator decoded;
+  std::tie(decoded_ok, decoded) = decoder.decode(std::begin(invalid), std::end(invalid), append_to(body));
+  ASSERT_FALSE(decoded_ok);
+}
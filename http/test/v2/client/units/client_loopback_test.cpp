@@ -0,0 +1,444 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include "network/http/v2/client.hpp"
+
+namespace http = network::http::v2;
+using boost::asio::ip::tcp;
+using boost::asio::ip::address;
+
+namespace {
+  // A server on the loopback interface, which hands each connection it
+  // accepts to a session function running on a thread of its own.
+  class loopback_server {
+
+  public:
+
+    typedef std::function<void (tcp::socket &)> session_type;
+
+    explicit loopback_server(session_type session)
+      : acceptor_(io_service_, tcp::endpoint(address::from_string("127.0.0.1"), 0))
+      , session_(session)
+      , is_stopped_(false)
+      , connections_(0) {
+      thread_ = std::thread([=] () {
+          while (true) {
+            auto socket = std::make_shared<tcp::socket>(io_service_);
+            boost::system::error_code ec;
+            acceptor_.accept(*socket, ec);
+            if (ec || is_stopped_) {
+              return;
+            }
+
+            ++connections_;
+            std::lock_guard<std::mutex> lock(mutex_);
+            sockets_.push_back(socket);
+            sessions_.emplace_back([=] () { session_(*socket); });
+          }
+        });
+    }
+
+    ~loopback_server() {
+      // the acceptor is woken up with a connection of its own, and the
+      // sessions by shutting their connections down
+      is_stopped_ = true;
+      boost::system::error_code ignore;
+      tcp::socket(io_service_).connect(acceptor_.local_endpoint(), ignore);
+      thread_.join();
+      for (auto &socket : sockets_) {
+        socket->shutdown(tcp::socket::shutdown_both, ignore);
+      }
+      for (auto &session : sessions_) {
+        session.join();
+      }
+    }
+
+    std::string url(const std::string &path = "/") const {
+      return "http://127.0.0.1:" + std::to_string(acceptor_.local_endpoint().port()) + path;
+    }
+
+    std::size_t connections() const {
+      return connections_;
+    }
+
+  private:
+
+    boost::asio::io_service io_service_;
+    tcp::acceptor acceptor_;
+    session_type session_;
+    std::atomic<bool> is_stopped_;
+    std::atomic<std::size_t> connections_;
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<tcp::socket>> sockets_;
+    std::vector<std::thread> sessions_;
+    std::thread thread_;
+
+  };
+
+  // Reads the head of the next request on a connection, and returns
+  // its request line, or an empty string if the connection was closed.
+  std::string read_request(tcp::socket &socket, boost::asio::streambuf &buffer) {
+    boost::system::error_code ec;
+    auto length = boost::asio::read_until(socket, buffer, "\r\n\r\n", ec);
+    if (ec) {
+      return std::string();
+    }
+
+    std::string head(boost::asio::buffers_begin(buffer.data()),
+                     boost::asio::buffers_begin(buffer.data()) + length);
+    buffer.consume(length);
+    return head.substr(0, head.find("\r\n"));
+  }
+
+  void write_response(tcp::socket &socket, const std::string &response) {
+    boost::system::error_code ignore;
+    boost::asio::write(socket, boost::asio::buffer(response), ignore);
+  }
+
+  std::string ok(const std::string &body) {
+    return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  }
+
+  // Returns the error a request failed with.
+  std::error_code error_of(std::future<http::client::response> &future) {
+    try {
+      future.get();
+    }
+    catch (const std::system_error &e) {
+      return e.code();
+    }
+    return std::error_code();
+  }
+
+  // Tests if the client closes a connection, once the request on it
+  // has been read.
+  bool is_closed_by_client(tcp::socket &socket, boost::asio::streambuf &buffer) {
+    boost::system::error_code ec;
+    boost::asio::read(socket, buffer, boost::asio::transfer_at_least(1), ec);
+    return ec == boost::asio::error::eof;
+  }
+} // namespace
+
+TEST(client_loopback_test, interim_responses_are_skipped) {
+  loopback_server server([] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      if (!read_request(socket, buffer).empty()) {
+        write_response(socket,
+                       "HTTP/1.1 100 Continue\r\n\r\n"
+                       "HTTP/1.1 103 Early Hints\r\nLink: </style.css>; rel=preload\r\n\r\n" +
+                       ok("first"));
+      }
+      if (!read_request(socket, buffer).empty()) {
+        write_response(socket, ok("second"));
+      }
+    });
+
+  http::client client;
+  http::client::request request{network::uri{server.url()}};
+  auto first = client.get(request).get();
+  ASSERT_EQ(http::status::code::ok, first.status());
+  ASSERT_EQ("first", first.body());
+
+  // the connection is reused, and nothing of the first response is left
+  // on it
+  auto second = client.get(request).get();
+  ASSERT_EQ(http::status::code::ok, second.status());
+  ASSERT_EQ("second", second.body());
+  ASSERT_EQ(1u, server.connections());
+}
+
+TEST(client_loopback_test, read_timeout) {
+  std::promise<bool> is_closed;
+  loopback_server server([&] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      read_request(socket, buffer);
+      is_closed.set_value(is_closed_by_client(socket, buffer));
+    });
+
+  http::client client;
+  http::client::request request{network::uri{server.url()}};
+  auto future = client.get(request, http::client::request_options().read_timeout(100));
+  ASSERT_EQ(http::make_error_code(http::client_error::timeout), error_of(future));
+
+  // the connection the request timed out on isn't used again
+  ASSERT_TRUE(is_closed.get_future().get());
+}
+
+TEST(client_loopback_test, read_timeout_is_restarted_by_each_read) {
+  // the response takes longer than the read timeout, but each part of
+  // it arrives in time
+  loopback_server server([] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      read_request(socket, buffer);
+      write_response(socket, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n");
+      for (auto c : std::string("hello")) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        write_response(socket, std::string(1, c));
+      }
+    });
+
+  http::client client;
+  http::client::request request{network::uri{server.url()}};
+  auto response = client.get(request, http::client::request_options().read_timeout(200)).get();
+  ASSERT_EQ("hello", response.body());
+}
+
+TEST(client_loopback_test, malformed_content_length_is_rejected) {
+  for (const auto &content_length : {"Content-Length: \r\n",
+                                     "Content-Length: abc\r\n",
+                                     "Content-Length: 5x\r\n",
+                                     "Content-Length: 184467440737095516160\r\n",
+                                     "Content-Length: 5\r\nContent-Length: 6\r\n",
+                                     "Content-Length: 5, 6\r\n"}) {
+    std::promise<bool> is_closed;
+    loopback_server server([&] (tcp::socket &socket) {
+        boost::asio::streambuf buffer;
+        read_request(socket, buffer);
+        write_response(socket, std::string("HTTP/1.1 200 OK\r\n") + content_length + "\r\nhello");
+        is_closed.set_value(is_closed_by_client(socket, buffer));
+      });
+
+    http::client client;
+    http::client::request request{network::uri{server.url()}};
+    auto future = client.get(request);
+    ASSERT_EQ(http::make_error_code(http::client_error::invalid_response), error_of(future))
+      << content_length;
+
+    // whatever follows on the connection can't be told apart from the
+    // body, so the connection isn't used again
+    ASSERT_TRUE(is_closed.get_future().get()) << content_length;
+  }
+}
+
+TEST(client_loopback_test, repeated_content_length_is_accepted) {
+  loopback_server server([] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      read_request(socket, buffer);
+      write_response(socket,
+                     "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nContent-Length: 5, 5\r\n\r\nhello");
+    });
+
+  http::client client;
+  http::client::request request{network::uri{server.url()}};
+  ASSERT_EQ("hello", client.get(request).get().body());
+}
+
+TEST(client_loopback_test, close_in_a_connection_list_is_honoured) {
+  loopback_server server([] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      while (!read_request(socket, buffer).empty()) {
+        write_response(socket,
+                       "HTTP/1.1 200 OK\r\nConnection: close, TE\r\nContent-Length: 5\r\n\r\nhello");
+      }
+    });
+
+  http::client client;
+  http::client::request request{network::uri{server.url()}};
+  ASSERT_EQ("hello", client.get(request).get().body());
+  ASSERT_EQ("hello", client.get(request).get().body());
+  ASSERT_EQ(2u, server.connections());
+}
+
+TEST(client_loopback_test, total_timeout) {
+  loopback_server server([] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      read_request(socket, buffer);
+      write_response(socket, "HTTP/1.1 200 OK\r\nContent-Length: 1000\r\n\r\n");
+      for (int i = 0; i < 1000; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        boost::system::error_code ec;
+        boost::asio::write(socket, boost::asio::buffer("x", 1), ec);
+        if (ec) {
+          return;
+        }
+      }
+    });
+
+  http::client client;
+  http::client::request request{network::uri{server.url()}};
+  auto started = std::chrono::steady_clock::now();
+  auto future = client.get(request, http::client::request_options()
+                           .read_timeout(1000)
+                           .total_timeout(200));
+  ASSERT_EQ(http::make_error_code(http::client_error::timeout), error_of(future));
+  ASSERT_GT(std::chrono::milliseconds(2000), std::chrono::steady_clock::now() - started);
+}
+
+TEST(client_loopback_test, connect_timeout) {
+  // The listen queue only has room for the first connection, so the
+  // handshake of the client's is never completed.
+  boost::asio::io_service io_service;
+  tcp::endpoint endpoint(address::from_string("127.0.0.1"), 0);
+  tcp::acceptor acceptor(io_service);
+  acceptor.open(endpoint.protocol());
+  acceptor.bind(endpoint);
+  acceptor.listen(0);
+  tcp::socket queued(io_service);
+  queued.connect(acceptor.local_endpoint());
+
+  http::client client(http::client_options().timeout(std::chrono::milliseconds(100)));
+  http::client::request request{network::uri{
+      "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/"}};
+  auto future = client.get(request);
+  ASSERT_EQ(http::make_error_code(http::client_error::timeout), error_of(future));
+}
+
+#ifdef NETWORK_ENABLE_HTTPS
+TEST(client_loopback_test, unloadable_certificate_fails_the_request) {
+  http::client client(http::client_options()
+                      .openssl_certificate_path("client_loopback_test.missing.pem"));
+  http::client::request request{network::uri{"https://127.0.0.1:1/"}};
+  auto future = client.get(request);
+  ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+  ASSERT_THROW(future.get(), boost::system::system_error);
+}
+#endif // NETWORK_ENABLE_HTTPS
+
+namespace {
+  http::client_options pipelining() {
+    return http::client_options().pipelining(true);
+  }
+
+  // only HTTP/1.1 requests are pipelined
+  http::client::request get_request(const std::string &url) {
+    http::client::request request{network::uri{url}};
+    request.version("1.1");
+    return request;
+  }
+
+  // Reads the given number of requests before any is answered, which
+  // only succeeds if they are pipelined, and returns their paths.
+  std::vector<std::string> read_pipelined(tcp::socket &socket,
+                                          boost::asio::streambuf &buffer,
+                                          std::size_t count) {
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < count; ++i) {
+      auto request_line = read_request(socket, buffer);
+      if (request_line.empty()) {
+        break;
+      }
+      paths.push_back(request_line.substr(4, request_line.find(' ', 4) - 4));
+    }
+    return paths;
+  }
+} // namespace
+
+TEST(client_loopback_test, pipelined_responses_are_read_in_order) {
+  loopback_server server([] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      std::string responses;
+      for (const auto &path : read_pipelined(socket, buffer, 3)) {
+        responses += ok(path);
+      }
+      write_response(socket, responses);
+      read_request(socket, buffer);
+    });
+
+  http::client client(pipelining());
+  http::client::request_options options;
+  options.read_timeout(5000);
+  std::vector<std::future<http::client::response>> futures;
+  for (const auto &path : {"/a", "/b", "/c"}) {
+    futures.push_back(client.get(get_request(server.url(path)), options));
+  }
+
+  ASSERT_EQ("/a", futures[0].get().body());
+  ASSERT_EQ("/b", futures[1].get().body());
+  ASSERT_EQ("/c", futures[2].get().body());
+  ASSERT_EQ(1u, server.connections());
+}
+
+TEST(client_loopback_test, pipelined_requests_are_retried_when_the_server_closes) {
+  // The first connection is closed after its first response. The later
+  // ones answer requests one at a time, and note if a request arrives
+  // before the previous one has been answered.
+  std::atomic<std::size_t> sessions(0);
+  std::atomic<bool> is_pipelined(false);
+  loopback_server server([&] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      if (sessions++ == 0) {
+        auto paths = read_pipelined(socket, buffer, 3);
+        if (!paths.empty()) {
+          write_response(socket, ok(paths.front()));
+        }
+        boost::system::error_code ignore;
+        socket.shutdown(tcp::socket::shutdown_both, ignore);
+        return;
+      }
+
+      std::string request_line;
+      while (!(request_line = read_request(socket, buffer)).empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if ((buffer.size() != 0) || (socket.available() != 0)) {
+          is_pipelined = true;
+        }
+        write_response(socket, ok(request_line.substr(4, request_line.find(' ', 4) - 4)));
+      }
+    });
+
+  http::client client(pipelining());
+  http::client::request_options options;
+  options.read_timeout(5000);
+  std::vector<std::future<http::client::response>> futures;
+  for (const auto &path : {"/a", "/b", "/c"}) {
+    futures.push_back(client.get(get_request(server.url(path)), options));
+  }
+
+  // the unanswered requests are sent again, each on a connection of
+  // its own
+  ASSERT_EQ("/a", futures[0].get().body());
+  ASSERT_EQ("/b", futures[1].get().body());
+  ASSERT_EQ("/c", futures[2].get().body());
+  ASSERT_EQ(3u, server.connections());
+
+  // and the host is no longer sent pipelined requests
+  auto d = client.get(get_request(server.url("/d")), options);
+  auto e = client.get(get_request(server.url("/e")), options);
+  ASSERT_EQ("/d", d.get().body());
+  ASSERT_EQ("/e", e.get().body());
+  ASSERT_FALSE(is_pipelined);
+}
+
+TEST(client_loopback_test, pipelined_request_timeout_closes_the_connection) {
+  std::promise<bool> is_closed;
+  std::atomic<std::size_t> sessions(0);
+  loopback_server server([&] (tcp::socket &socket) {
+      boost::asio::streambuf buffer;
+      if (sessions++ == 0) {
+        read_pipelined(socket, buffer, 3);
+        is_closed.set_value(is_closed_by_client(socket, buffer));
+        return;
+      }
+
+      // the requests sent again aren't answered either
+      read_request(socket, buffer);
+      is_closed_by_client(socket, buffer);
+    });
+
+  http::client client(pipelining());
+  http::client::request_options options;
+  options.read_timeout(100);
+  std::vector<std::future<http::client::response>> futures;
+  for (const auto &path : {"/a", "/b", "/c"}) {
+    futures.push_back(client.get(get_request(server.url(path)), options));
+  }
+
+  for (auto &future : futures) {
+    ASSERT_EQ(http::make_error_code(http::client_error::timeout), error_of(future));
+  }
+  ASSERT_TRUE(is_closed.get_future().get());
+}
@@ -60,3 +60,49 @@ TEST(client_options_test, set_option_openssl_verify_path) {
   opts.openssl_verify_path("openssl_verify");
   ASSERT_EQ(std::vector<std::string>{"openssl_verify"}, opts.openssl_verify_paths());
 }
+
+TEST(client_options_test, default_options_max_idle_connections) {
+  network::http::v2::client_options opts;
+  ASSERT_EQ(64, opts.max_idle_connections());
+}
+
+TEST(client_options_test, default_options_idle_timeout) {
+  network::http::v2::client_options opts;
+  ASSERT_EQ(std::chrono::milliseconds(30000), opts.idle_timeout());
+}
+
+TEST(client_options_test, set_option_max_idle_connections_per_host) {
+  network::http::v2::client_options opts;
+  opts.max_idle_connections_per_host(2);
+  ASSERT_EQ(2, opts.max_idle_connections_per_host());
+}
+
+TEST(client_options_test, default_options_num_threads) {
+  network::http::v2::client_options opts;
+  ASSERT_EQ(1, opts.num_threads());
+}
+
+TEST(client_options_test, set_option_num_threads) {
+  network::http::v2::client_options opts;
+  opts.num_threads(4);
+  ASSERT_EQ(4, opts.num_threads());
+}
+
+TEST(client_options_test, default_options_cache_resolved_ttl) {
+  network::http::v2::client_options opts;
+  ASSERT_EQ(std::chrono::milliseconds(300000), opts.cache_resolved_ttl());
+  ASSERT_EQ(1024, opts.max_cache_resolved());
+}
+
+TEST(client_options_test, default_options_pipelining) {
+  network::http::v2::client_options opts;
+  ASSERT_FALSE(opts.pipelining());
+  ASSERT_EQ(8, opts.max_pipelined_requests());
+}
+
+TEST(client_options_test, set_option_pipelining) {
+  network::http::v2::client_options opts;
+  opts.pipelining(true).max_pipelined_requests(16);
+  ASSERT_TRUE(opts.pipelining());
+  ASSERT_EQ(16, opts.max_pipelined_requests());
+}
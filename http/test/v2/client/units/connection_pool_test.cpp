@@ -0,0 +1,97 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include "network/http/v2/client/connection/connection_pool.hpp"
+
+namespace http_cc = network::http::v2::client_connection;
+
+namespace {
+  class fake_connection : public http_cc::async_connection {
+
+  public:
+
+    explicit fake_connection(bool open = true)
+      : open_(open) { }
+
+    virtual void async_connect(const boost::asio::ip::tcp::endpoint &,
+                               connect_callback) { }
+
+    virtual void async_connect(const std::vector<boost::asio::ip::tcp::endpoint> &,
+                               connect_callback) { }
+
+    virtual void async_write(boost::asio::streambuf &, write_callback) { }
+
+    virtual void async_write(const std::vector<boost::asio::const_buffer> &, write_callback) { }
+
+    virtual void async_read_until(boost::asio::streambuf &, const std::string &,
+                                  read_callback) { }
+
+    virtual void async_read(boost::asio::streambuf &, read_callback) { }
+
+    virtual void cancel() { }
+
+    virtual bool is_open() const { return open_; }
+
+    virtual void close() { open_ = false; }
+
+  private:
+
+    bool open_;
+
+  };
+
+  http_cc::connection_pool::connection_ptr make_connection(bool open = true) {
+    return http_cc::connection_pool::connection_ptr(new fake_connection(open));
+  }
+} // namespace
+
+TEST(connection_pool_test, acquire_from_empty_pool) {
+  http_cc::connection_pool pool(8, 2, std::chrono::milliseconds(30000));
+  ASSERT_FALSE(pool.acquire("http://example.com:80"));
+}
+
+TEST(connection_pool_test, release_and_acquire) {
+  http_cc::connection_pool pool(8, 2, std::chrono::milliseconds(30000));
+  pool.release("http://example.com:80", make_connection());
+  ASSERT_EQ(1, pool.size());
+  ASSERT_TRUE(!!pool.acquire("http://example.com:80"));
+  ASSERT_EQ(0, pool.size());
+}
+
+TEST(connection_pool_test, connections_are_keyed_by_origin) {
+  http_cc::connection_pool pool(8, 2, std::chrono::milliseconds(30000));
+  pool.release("http://example.com:80", make_connection());
+  ASSERT_FALSE(pool.acquire("https://example.com:443"));
+}
+
+TEST(connection_pool_test, closed_connections_are_not_kept) {
+  http_cc::connection_pool pool(8, 2, std::chrono::milliseconds(30000));
+  pool.release("http://example.com:80", make_connection(false));
+  ASSERT_EQ(0, pool.size());
+}
+
+TEST(connection_pool_test, max_idle_per_host) {
+  http_cc::connection_pool pool(8, 2, std::chrono::milliseconds(30000));
+  pool.release("http://example.com:80", make_connection());
+  pool.release("http://example.com:80", make_connection());
+  pool.release("http://example.com:80", make_connection());
+  ASSERT_EQ(2, pool.size());
+}
+
+TEST(connection_pool_test, max_idle) {
+  http_cc::connection_pool pool(2, 2, std::chrono::milliseconds(30000));
+  pool.release("http://a.example.com:80", make_connection());
+  pool.release("http://b.example.com:80", make_connection());
+  pool.release("http://c.example.com:80", make_connection());
+  ASSERT_EQ(2, pool.size());
+  ASSERT_FALSE(pool.acquire("http://a.example.com:80"));
+}
+
+TEST(connection_pool_test, idle_connections_expire) {
+  http_cc::connection_pool pool(8, 2, std::chrono::milliseconds(0));
+  pool.release("http://example.com:80", make_connection());
+  ASSERT_FALSE(pool.acquire("http://example.com:80"));
+}
@@ -0,0 +1,81 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include <boost/asio/error.hpp>
+#include "network/http/v2/client/connection/endpoint_cache.hpp"
+
+namespace http_cc = network::http::v2::client_connection;
+
+TEST(endpoint_cache_test, find_in_empty_cache) {
+  http_cc::endpoint_cache cache;
+  ASSERT_FALSE(cache.find("www.example.com", 80));
+  ASSERT_EQ(0, cache.hits());
+  ASSERT_EQ(1, cache.misses());
+}
+
+TEST(endpoint_cache_test, find_inserted_host) {
+  http_cc::endpoint_cache cache;
+  cache.insert("www.example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  auto cached = cache.find("www.example.com", 80);
+  ASSERT_TRUE(cached);
+  ASSERT_FALSE(cached->first);
+  ASSERT_EQ(1, cache.hits());
+  ASSERT_EQ(0, cache.misses());
+}
+
+TEST(endpoint_cache_test, host_names_are_case_insensitive) {
+  http_cc::endpoint_cache cache;
+  cache.insert("WWW.Example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  ASSERT_TRUE(cache.find("www.example.COM", 80));
+}
+
+TEST(endpoint_cache_test, ports_are_cached_separately) {
+  http_cc::endpoint_cache cache;
+  cache.insert("www.example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  ASSERT_FALSE(cache.find("www.example.com", 8080));
+}
+
+TEST(endpoint_cache_test, expired_entries_are_not_found) {
+  http_cc::endpoint_cache cache;
+  cache.insert("www.example.com", 80, http_cc::endpoint_cache::resolver_iterator(),
+               std::chrono::milliseconds(0));
+  ASSERT_FALSE(cache.find("www.example.com", 80));
+  ASSERT_EQ(0, cache.size());
+}
+
+TEST(endpoint_cache_test, failed_lookups_are_cached) {
+  http_cc::endpoint_cache cache;
+  cache.insert_error("www.example.invalid", 80, boost::asio::error::host_not_found);
+  auto cached = cache.find("www.example.invalid", 80);
+  ASSERT_TRUE(cached);
+  ASSERT_EQ(boost::system::error_code(boost::asio::error::host_not_found), cached->first);
+}
+
+TEST(endpoint_cache_test, failed_lookups_expire_sooner) {
+  http_cc::endpoint_cache cache(16, std::chrono::milliseconds(60000), std::chrono::milliseconds(0));
+  cache.insert_error("www.example.invalid", 80, boost::asio::error::host_not_found);
+  ASSERT_FALSE(cache.find("www.example.invalid", 80));
+}
+
+TEST(endpoint_cache_test, least_recently_used_entry_is_evicted) {
+  http_cc::endpoint_cache cache(2);
+  cache.insert("a.example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  cache.insert("b.example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  ASSERT_TRUE(cache.find("a.example.com", 80));
+  cache.insert("c.example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  ASSERT_EQ(2, cache.size());
+  ASSERT_TRUE(cache.find("a.example.com", 80));
+  ASSERT_FALSE(cache.find("b.example.com", 80));
+  ASSERT_TRUE(cache.find("c.example.com", 80));
+}
+
+TEST(endpoint_cache_test, clear) {
+  http_cc::endpoint_cache cache;
+  cache.insert("www.example.com", 80, http_cc::endpoint_cache::resolver_iterator());
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+  ASSERT_FALSE(cache.find("www.example.com", 80));
+}
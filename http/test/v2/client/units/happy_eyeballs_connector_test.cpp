@@ -0,0 +1,119 @@
+// Copyright (C) 2013 by Glyn Matthews
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <gtest/gtest.h>
+#include "network/http/v2/client/connection/happy_eyeballs_connector.hpp"
+
+namespace http_cc = network::http::v2::client_connection;
+using boost::asio::ip::tcp;
+using boost::asio::ip::address;
+
+TEST(happy_eyeballs_connector_test, interleave_address_families) {
+  std::vector<tcp::endpoint> endpoints{
+    tcp::endpoint(address::from_string("::1"), 80),
+    tcp::endpoint(address::from_string("::2"), 80),
+    tcp::endpoint(address::from_string("::3"), 80),
+    tcp::endpoint(address::from_string("127.0.0.1"), 80),
+  };
+  auto interleaved = http_cc::happy_eyeballs_connector::interleave(endpoints);
+  ASSERT_EQ(4, interleaved.size());
+  ASSERT_EQ(endpoints[0], interleaved[0]);
+  ASSERT_EQ(endpoints[3], interleaved[1]);
+  ASSERT_EQ(endpoints[1], interleaved[2]);
+  ASSERT_EQ(endpoints[2], interleaved[3]);
+}
+
+TEST(happy_eyeballs_connector_test, interleave_starts_with_first_family) {
+  std::vector<tcp::endpoint> endpoints{
+    tcp::endpoint(address::from_string("127.0.0.1"), 80),
+    tcp::endpoint(address::from_string("127.0.0.2"), 80),
+    tcp::endpoint(address::from_string("::1"), 80),
+  };
+  auto interleaved = http_cc::happy_eyeballs_connector::interleave(endpoints);
+  ASSERT_EQ(3, interleaved.size());
+  ASSERT_EQ(endpoints[0], interleaved[0]);
+  ASSERT_EQ(endpoints[2], interleaved[1]);
+  ASSERT_EQ(endpoints[1], interleaved[2]);
+}
+
+TEST(happy_eyeballs_connector_test, connect_after_failed_attempt) {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor(io_service, tcp::endpoint(address::from_string("127.0.0.1"), 0));
+
+  // nothing is listening on the first endpoint's port any more
+  tcp::acceptor closed(io_service, tcp::endpoint(address::from_string("127.0.0.1"), 0));
+  auto closed_endpoint = closed.local_endpoint();
+  closed.close();
+
+  std::vector<tcp::endpoint> endpoints{closed_endpoint, acceptor.local_endpoint()};
+  auto connector = std::make_shared<http_cc::happy_eyeballs_connector>(io_service,
+                                                                       std::chrono::milliseconds(10000));
+  boost::system::error_code result = boost::asio::error::would_block;
+  http_cc::happy_eyeballs_connector::socket_ptr connected;
+  connector->async_connect(endpoints,
+                           [&] (const boost::system::error_code &ec,
+                                http_cc::happy_eyeballs_connector::socket_ptr socket) {
+                             result = ec;
+                             connected = std::move(socket);
+                           });
+  io_service.run();
+  ASSERT_FALSE(result);
+  ASSERT_TRUE(static_cast<bool>(connected));
+  ASSERT_EQ(acceptor.local_endpoint(), connected->remote_endpoint());
+}
+
+TEST(happy_eyeballs_connector_test, all_attempts_fail) {
+  boost::asio::io_service io_service;
+  tcp::acceptor closed(io_service, tcp::endpoint(address::from_string("127.0.0.1"), 0));
+  auto closed_endpoint = closed.local_endpoint();
+  closed.close();
+
+  auto connector = std::make_shared<http_cc::happy_eyeballs_connector>(io_service,
+                                                                       std::chrono::milliseconds(250));
+  boost::system::error_code result;
+  bool has_socket = true;
+  connector->async_connect(std::vector<tcp::endpoint>{closed_endpoint, closed_endpoint},
+                           [&] (const boost::system::error_code &ec,
+                                http_cc::happy_eyeballs_connector::socket_ptr socket) {
+                             result = ec;
+                             has_socket = static_cast<bool>(socket);
+                           });
+  io_service.run();
+  ASSERT_EQ(boost::system::error_code(boost::asio::error::connection_refused), result);
+  ASSERT_FALSE(has_socket);
+}
+
+TEST(happy_eyeballs_connector_test, no_endpoints) {
+  boost::asio::io_service io_service;
+  auto connector = std::make_shared<http_cc::happy_eyeballs_connector>(io_service,
+                                                                       std::chrono::milliseconds(250));
+  boost::system::error_code result;
+  connector->async_connect(std::vector<tcp::endpoint>(),
+                           [&] (const boost::system::error_code &ec,
+                                http_cc::happy_eyeballs_connector::socket_ptr) {
+                             result = ec;
+                           });
+  io_service.run();
+  ASSERT_EQ(boost::system::error_code(boost::asio::error::host_not_found), result);
+}
+
+TEST(happy_eyeballs_connector_test, cancel) {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor(io_service, tcp::endpoint(address::from_string("127.0.0.1"), 0));
+  auto connector = std::make_shared<http_cc::happy_eyeballs_connector>(io_service,
+                                                                       std::chrono::milliseconds(250));
+  boost::system::error_code result;
+  int calls = 0;
+  connector->async_connect(std::vector<tcp::endpoint>{acceptor.local_endpoint()},
+                           [&] (const boost::system::error_code &ec,
+                                http_cc::happy_eyeballs_connector::socket_ptr) {
+                             result = ec;
+                             ++calls;
+                           });
+  connector->cancel();
+  io_service.run();
+  ASSERT_EQ(1, calls);
+  ASSERT_EQ(boost::system::error_code(boost::asio::error::operation_aborted), result);
+}
@@ -34,3 +34,26 @@ TEST(request_options_test, set_max_redirects) {
   opts.max_redirects(5);
   ASSERT_EQ(5, opts.max_redirects());
 }
+
+TEST(request_options_test, default_options_body_handler) {
+  http_cm::request_options opts;
+  ASSERT_FALSE(opts.body_handler());
+}
+
+TEST(request_options_test, set_body_handler) {
+  http_cm::request_options opts;
+  std::size_t received = 0;
+  opts.body_handler([&received] (const char *, std::size_t length) { received += length; });
+  ASSERT_TRUE(static_cast<bool>(opts.body_handler()));
+  opts.body_handler()("abc", 3);
+  ASSERT_EQ(3, received);
+}
+
+TEST(request_options_test, copy_body_handler) {
+  http_cm::request_options opts;
+  opts.body_handler([] (const char *, std::size_t) { });
+  http_cm::request_options copy;
+  copy = opts;
+  ASSERT_TRUE(static_cast<bool>(copy.body_handler()));
+  ASSERT_EQ(10, copy.max_redirects());
+}
@@ -150,3 +150,56 @@ TEST(response_parser_test, parse_headers) {
     ASSERT_EQ(http::response_parser::http_header_line_done, parser.state());
   }
 }
+
+TEST(response_parser_test, parse_empty_header_value) {
+  const std::string empty_value =
+    "HTTP/1.1 200 OK\r\n"
+    "X-Empty:\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n";
+
+  http::response_parser parser;
+
+  boost::logic::tribool parsed_ok = false;
+  boost::iterator_range<std::string::const_iterator> header;
+  std::tie(parsed_ok, header) = parser.parse_until(http::response_parser::http_status_message_done,
+                                                   empty_value);
+  ASSERT_TRUE(parsed_ok);
+
+  std::tie(parsed_ok, header) = parser.parse_until(http::response_parser::http_header_colon,
+                                                   boost::make_iterator_range(std::end(header),
+                                                                              std::end(empty_value)));
+  ASSERT_TRUE(parsed_ok);
+  ASSERT_EQ("X-Empty:", trimmed_string(header));
+
+  std::tie(parsed_ok, header) = parser.parse_until(http::response_parser::http_header_line_done,
+                                                   boost::make_iterator_range(std::end(header),
+                                                                              std::end(empty_value)));
+  ASSERT_TRUE(parsed_ok);
+  ASSERT_EQ("", trimmed_string(header));
+
+  std::tie(parsed_ok, header) = parser.parse_until(http::response_parser::http_header_colon,
+                                                   boost::make_iterator_range(std::end(header),
+                                                                              std::end(empty_value)));
+  ASSERT_TRUE(parsed_ok);
+  ASSERT_EQ("Content-Length:", trimmed_string(header));
+}
+
+TEST(response_parser_test, parse_in_pieces) {
+  // the client parses the contiguous data of a streambuf as it arrives
+  const char *data = input.data();
+  const char *split = data + 5;
+
+  http::response_parser parser;
+
+  boost::logic::tribool parsed_ok = false;
+  boost::iterator_range<const char *> version;
+  std::tie(parsed_ok, version) = parser.parse_until(http::response_parser::http_version_done,
+                                                    boost::make_iterator_range(data, split));
+  ASSERT_TRUE(boost::logic::indeterminate(parsed_ok));
+
+  std::tie(parsed_ok, version) = parser.parse_until(http::response_parser::http_version_done,
+                                                    boost::make_iterator_range(split, data + input.size()));
+  ASSERT_TRUE(parsed_ok);
+  ASSERT_EQ("HTTP/1.0", trimmed_string(data, std::end(version)));
+}